@@ -369,44 +369,15 @@ up_and_down_scale (ThreadData *data, gpointer buffer)
 static void
 get_statistics (ThreadData *data, gdouble *mean, gdouble *sigma, guint *_max, guint *_min, gpointer buffer)
 {
-    gdouble sum = 0.0;
-    gdouble squared_sum = 0.0;
-    guint min = G_MAXUINT;
-    guint max = 0;
+    UcaFrameStatistics statistics;
+    guint pixel_size = data->pixel_size == 1 ? 1 : 2;
+    gdouble sum;
+    gdouble squared_sum;
     guint n = data->width * data->height;
 
-    if (data->pixel_size == 1) {
-        guint8 *input = (guint8 *) buffer;
-
-        for (gint i = 0; i < n; i++) {
-            guint8 val = input[i];
-
-            if (val > max)
-                max = val;
-
-            if (val < min)
-                min = val;
-
-            sum += val;
-            squared_sum += val * val;
-        }
-    }
-    else {
-        guint16 *input = (guint16 *) buffer;
-
-        for (gint i = 0; i < n; i++) {
-            guint16 val = input[i];
-
-            if (val > max)
-                max = val;
-
-            if (val < min)
-                min = val;
-
-            sum += val;
-            squared_sum += val * val;
-        }
-    }
+    uca_transform_statistics (buffer, data->width, data->height, pixel_size, 8 * pixel_size, 1, &statistics);
+    sum = (gdouble) statistics.sum;
+    squared_sum = (gdouble) statistics.sum_squares;
 
     if (gtk_toggle_button_get_active (data->log_button)) {
         *mean = log (sum/n);
@@ -417,8 +388,8 @@ get_statistics (ThreadData *data, gdouble *mean, gdouble *sigma, guint *_max, gu
         *sigma = sqrt ((squared_sum - sum*sum/n) / (n - 1));
     }
 
-    *_min = min;
-    *_max = max;
+    *_min = statistics.min;
+    *_max = statistics.max;
 }
 
 static void
@@ -970,12 +941,12 @@ update_current_frame (ThreadData *data)
     n_max = uca_ring_buffer_get_num_blocks (data->buffer);
 
     if (n_max > 0 && data->n_recorded > 0) {
-        /* Shift index so that we always show the oldest frames first */
-        index = (index + data->n_recorded - n_max) % n_max;
+        /* Indices are relative to the oldest frame in the buffer */
         buffer = uca_ring_buffer_get_pointer (data->buffer, index);
     }
     else {
         /* we were in preview mode. Grab the 'next' frame in the buffer */
+        uca_ring_buffer_get_write_pointer (data->buffer);
         uca_ring_buffer_write_advance (data->buffer);
         buffer = uca_ring_buffer_get_read_pointer (data->buffer);
     }
@@ -1279,6 +1250,9 @@ update_ring_buffer_dimensions (ThreadData *data)
         g_object_unref (data->buffer);
 
     data->buffer = uca_ring_buffer_new (image_size, num_frames);
+
+    /* Ring buffer memory is uninitialized, show a black frame until we have one */
+    memset (uca_ring_buffer_peek_pointer (data->buffer), 0, image_size);
     g_message ("Allocated memory for %d frames", num_frames);
 }
 
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include "uca-camera.h"
 #include "uca-plugin-manager.h"
+#include "uca-box-filter.h"
 #include "common.h"
 
 
@@ -32,6 +33,12 @@ typedef struct {
     gboolean test_software;
     gboolean test_external;
     gboolean test_readout;
+    gint batch_size;
+    gboolean test_allocation;
+    gint n_start_stop;
+    gint n_accessor_calls;
+    gboolean test_transform;
+    gint filter_radius;
 
     gsize n_bytes;
 } Options;
@@ -39,6 +46,7 @@ typedef struct {
 typedef guint (*GrabFrameFunc) (UcaCamera *, gpointer, guint, UcaCameraTriggerSource, GTimer *);
 
 static UcaCamera *camera = NULL;
+static guint batch_size = 0;
 
 static void
 sigint_handler(int signal)
@@ -114,6 +122,38 @@ grab_frames_sync (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraT
     return total;
 }
 
+static guint
+grab_frames_batched (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
+{
+    GError *error = NULL;
+    guint total;
+
+    g_object_set (camera, "trigger-source", trigger_source, NULL);
+    uca_camera_start_recording (camera, &error);
+    total = 0;
+
+    g_timer_start (timer);
+    while (total < n_frames) {
+        guint n_got = 0;
+
+        uca_camera_grab_many (camera, buffer, MIN (batch_size, n_frames - total), &n_got, -1.0, &error);
+        total += n_got;
+
+        if (error != NULL) {
+            g_warning ("Error grabbing batch at frame %i/%i: `%s'", total, n_frames, error->message);
+            g_error_free (error);
+            error = NULL;
+
+            if (n_got == 0)
+                break;
+        }
+    }
+    g_timer_stop (timer);
+
+    uca_camera_stop_recording (camera, &error);
+    return total;
+}
+
 static guint
 grab_frames_readout (UcaCamera *camera, gpointer buffer, guint n_frames, UcaCameraTriggerSource trigger_source, GTimer *timer)
 {
@@ -202,6 +242,8 @@ benchmark_method (UcaCamera *camera, gpointer buffer, GrabFrameFunc func, Option
         g_print ("sync   ");
     else if (func == grab_frames_readout)
         g_print ("rout   ");
+    else if (func == grab_frames_batched)
+        g_print ("batch  ");
     else
         g_print ("async  ");
 
@@ -239,6 +281,284 @@ benchmark_method (UcaCamera *camera, gpointer buffer, GrabFrameFunc func, Option
     g_timer_destroy (timer);
 }
 
+static void
+benchmark_start_latency (UcaCamera *camera, gpointer buffer, Options *options)
+{
+    GTimer *timer;
+    GError *error = NULL;
+    gdouble total = 0.0;
+    gdouble min_latency = G_MAXDOUBLE;
+    gdouble max_latency = 0.0;
+
+    timer = g_timer_new ();
+    g_print ("start  auto  ");
+
+    for (gint i = 0; i < options->n_start_stop; i++) {
+        gdouble latency;
+
+        g_timer_start (timer);
+        uca_camera_start_recording (camera, &error);
+
+        if (error == NULL)
+            uca_camera_grab (camera, buffer, &error);
+
+        latency = g_timer_elapsed (timer, NULL);
+        uca_camera_stop_recording (camera, error == NULL ? &error : NULL);
+
+        if (error != NULL) {
+            g_warning ("Error in start/stop cycle %i: `%s'", i, error->message);
+            g_error_free (error);
+            break;
+        }
+
+        total += latency;
+        min_latency = MIN (min_latency, latency);
+        max_latency = MAX (max_latency, latency);
+    }
+
+    if (total > 0.0) {
+        g_print (" %8.3f ms  %8.3f ms min  %8.3f ms max  start to first frame\n",
+                 total / options->n_start_stop * 1000, min_latency * 1000, max_latency * 1000);
+    }
+
+    g_timer_destroy (timer);
+}
+
+static void
+benchmark_accessors (UcaCamera *camera, Options *options)
+{
+    GTimer *timer;
+    gdouble property_time;
+    gdouble accessor_time;
+    gboolean recording;
+    UcaCameraTriggerSource trigger_source;
+    guint width, height, bits;
+
+    timer = g_timer_new ();
+
+    for (gint i = 0; i < options->n_accessor_calls; i++) {
+        g_object_get (camera,
+                      "is-recording", &recording,
+                      "trigger-source", &trigger_source,
+                      "roi-width", &width,
+                      "roi-height", &height,
+                      "sensor-bitdepth", &bits,
+                      NULL);
+    }
+
+    property_time = g_timer_elapsed (timer, NULL);
+    g_timer_start (timer);
+
+    for (gint i = 0; i < options->n_accessor_calls; i++) {
+        recording = uca_camera_is_recording (camera);
+        trigger_source = uca_camera_get_trigger_source (camera);
+        uca_camera_get_roi (camera, NULL, NULL, &width, &height);
+        bits = uca_camera_get_bitdepth (camera);
+    }
+
+    accessor_time = g_timer_elapsed (timer, NULL);
+
+    g_print ("props        %8.1f ns per g_object_get  %8.1f ns per accessors\n",
+             property_time / options->n_accessor_calls * 1e9,
+             accessor_time / options->n_accessor_calls * 1e9);
+
+    g_timer_destroy (timer);
+}
+
+static void
+benchmark_transform (Options *options)
+{
+    static const guint sizes[][2] = { { 1280, 1024 }, { 2048, 2048 }, { 2560, 2160 }, { 5120, 5120 } };
+    GTimer *timer;
+
+    timer = g_timer_new ();
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            gsize size;
+            gpointer src;
+            gpointer dst;
+
+            size = (gsize) sizes[i][0] * sizes[i][1] * pixel_size;
+            src = g_malloc0 (size);
+            dst = g_malloc0 (size);
+
+            g_print ("transform  %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], pixel_size * 8);
+
+            for (guint mirror = 0; mirror < 2; mirror++) {
+                for (guint rotate = 0; rotate < 4; rotate++) {
+                    g_timer_start (timer);
+
+                    for (gint run = 0; run < options->n_runs; run++)
+                        uca_transform_frame (src, dst, sizes[i][0], sizes[i][1], pixel_size, mirror, rotate);
+
+                    g_print (" %c%3u: %5.2f GB/s", mirror ? 'm' : ' ', rotate * 90,
+                             size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+                }
+            }
+
+            g_print ("\n");
+            g_free (src);
+            g_free (dst);
+        }
+
+        for (guint bits = 10; bits <= 12; bits += 2) {
+            gsize n_pixels;
+            gsize size;
+            guint16 *unpacked;
+            gpointer packed;
+
+            n_pixels = (gsize) sizes[i][0] * sizes[i][1];
+            size = n_pixels * sizeof (guint16);
+            unpacked = g_malloc0 (size);
+            packed = g_malloc0 (uca_transform_get_packed_size (n_pixels, bits));
+
+            g_print ("packing    %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], bits);
+            g_timer_start (timer);
+
+            for (gint run = 0; run < options->n_runs; run++)
+                uca_transform_unpack (packed, unpacked, n_pixels, bits);
+
+            g_print ("  unpack: %5.2f GB/s", size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            g_timer_start (timer);
+
+            for (gint run = 0; run < options->n_runs; run++)
+                uca_transform_pack (unpacked, packed, n_pixels, bits);
+
+            g_print ("  pack: %5.2f GB/s\n", size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            g_free (unpacked);
+            g_free (packed);
+        }
+
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            gsize size;
+            gpointer src;
+            gpointer dst;
+
+            size = (gsize) sizes[i][0] * sizes[i][1] * pixel_size;
+            src = g_malloc0 (size);
+            dst = g_malloc0 (size);
+
+            g_print ("binning    %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], pixel_size * 8);
+
+            for (guint factor = 2; factor <= 4; factor += 2) {
+                g_timer_start (timer);
+
+                for (gint run = 0; run < options->n_runs; run++)
+                    uca_transform_bin (src, sizes[i][0] * pixel_size, dst,
+                                       sizes[i][0] / factor, sizes[i][1] / factor,
+                                       factor, factor, pixel_size, FALSE);
+
+                g_print ("  %ux%u: %5.2f GB/s", factor, factor,
+                         size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            }
+
+            g_print ("\n");
+            g_free (src);
+            g_free (dst);
+        }
+
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            gsize n_pixels;
+            gsize size;
+            gpointer frame;
+            guint16 *dark;
+            guint16 *gain;
+
+            n_pixels = (gsize) sizes[i][0] * sizes[i][1];
+            size = n_pixels * pixel_size;
+            frame = g_malloc0 (size);
+            dark = g_malloc0 (n_pixels * sizeof (guint16));
+            gain = g_malloc0 (n_pixels * sizeof (guint16));
+
+            g_print ("correction %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], pixel_size * 8);
+            g_timer_start (timer);
+
+            for (gint run = 0; run < options->n_runs; run++)
+                uca_transform_correct (frame, frame, dark, gain, n_pixels, 15, pixel_size);
+
+            g_print ("  in place: %5.2f GB/s\n", size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            g_free (frame);
+            g_free (dark);
+            g_free (gain);
+        }
+
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            gsize n_pixels;
+            gsize size;
+            gpointer frame;
+            guint32 *sums;
+
+            n_pixels = (gsize) sizes[i][0] * sizes[i][1];
+            size = n_pixels * pixel_size;
+            frame = g_malloc0 (size);
+            sums = g_malloc0 (n_pixels * sizeof (guint32));
+
+            g_print ("accumulate %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], pixel_size * 8);
+            g_timer_start (timer);
+
+            for (gint run = 0; run < options->n_runs; run++)
+                uca_transform_accumulate (frame, sums, n_pixels, pixel_size);
+
+            g_print ("  add: %5.2f GB/s\n", size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            g_free (frame);
+            g_free (sums);
+        }
+
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            UcaFrameStatistics statistics;
+            gsize size;
+            gpointer frame;
+
+            size = (gsize) sizes[i][0] * sizes[i][1] * pixel_size;
+            frame = g_malloc0 (size);
+
+            g_print ("statistics %4ux%-4u %2u bit ", sizes[i][0], sizes[i][1], pixel_size * 8);
+            g_timer_start (timer);
+
+            for (gint run = 0; run < options->n_runs; run++)
+                uca_transform_statistics (frame, sizes[i][0], sizes[i][1], pixel_size, 8 * pixel_size, 1, &statistics);
+
+            g_print ("  scan: %5.2f GB/s\n", size * options->n_runs / g_timer_elapsed (timer, NULL) / 1e9);
+            g_free (frame);
+        }
+    }
+
+    g_timer_destroy (timer);
+}
+
+/*
+ * Buffered acquisition through a box filter with a growing number of workers,
+ * which shows how far the filter pipeline scales on this machine.
+ */
+static void
+benchmark_filters (UcaCamera *camera, gpointer buffer, Options *options)
+{
+    UcaFilter *filter;
+    gboolean buffered;
+    guint n_processors;
+
+    filter = uca_box_filter_new (options->filter_radius);
+    n_processors = g_get_num_processors ();
+
+    g_object_get (camera, "buffered", &buffered, NULL);
+    g_object_set (camera, "buffered", TRUE, NULL);
+    uca_camera_add_filter (camera, filter);
+
+    for (guint n_workers = 1; ; n_workers = MIN (2 * n_workers, n_processors)) {
+        g_print ("box%-2d %2u  ", options->filter_radius, n_workers);
+        g_object_set (camera, "filter-workers", n_workers, NULL);
+        benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+
+        if (n_workers == n_processors)
+            break;
+    }
+
+    uca_camera_clear_filters (camera);
+    g_object_set (camera, "buffered", buffered, "filter-workers", 0, NULL);
+    g_object_unref (filter);
+}
+
 static void
 benchmark (UcaCamera *camera, Options *options)
 {
@@ -247,8 +567,6 @@ benchmark (UcaCamera *camera, Options *options)
     guint sensor_height;
     guint roi_width;
     guint roi_height;
-    guint bits;
-    gsize n_bytes_per_pixel;
     gdouble exposure_time;
     gpointer buffer;
 
@@ -256,7 +574,6 @@ benchmark (UcaCamera *camera, Options *options)
                   "name", &name,
                   "sensor-width", &sensor_width,
                   "sensor-height", &sensor_height,
-                  "sensor-bitdepth", &bits,
                   "roi-width", &roi_width,
                   "roi-height", &roi_height,
                   "exposure-time", &exposure_time,
@@ -268,8 +585,7 @@ benchmark (UcaCamera *camera, Options *options)
     g_free (name);
 
     /* Synchronous frame acquisition */
-    n_bytes_per_pixel = bits > 8 ? 2 : 1;
-    options->n_bytes = roi_width * roi_height * n_bytes_per_pixel;
+    options->n_bytes = uca_camera_get_frame_size (camera);
     buffer = g_malloc0 (options->n_bytes);
 
     g_object_set (G_OBJECT(camera), "transfer-asynchronously", FALSE, NULL);
@@ -285,6 +601,73 @@ benchmark (UcaCamera *camera, Options *options)
     if (options->test_external)
         benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_EXTERNAL);
 
+    /*
+     * First pass through a fresh ring buffer, once with lazily faulted pages
+     * and once with prefaulted, locked huge pages
+     */
+    if (options->test_allocation) {
+        gboolean buffered;
+        gboolean huge_pages;
+        gboolean lock_memory;
+        gboolean prefault;
+        guint num_buffers;
+        guint alignment;
+
+        g_object_get (camera,
+                      "buffered", &buffered,
+                      "num-buffers", &num_buffers,
+                      "buffer-alignment", &alignment,
+                      "buffer-huge-pages", &huge_pages,
+                      "buffer-lock-memory", &lock_memory,
+                      "buffer-prefault", &prefault,
+                      NULL);
+
+        for (guint i = 0; i < 2; i++) {
+            g_print ("%s", i == 0 ? "lazy   " : "fault  ");
+            g_object_set (camera,
+                          "buffered", TRUE,
+                          "num-buffers", options->n_frames,
+                          "buffer-alignment", 4096,
+                          "buffer-huge-pages", i == 1,
+                          "buffer-lock-memory", i == 1,
+                          "buffer-prefault", i == 1,
+                          NULL);
+
+            benchmark_method (camera, buffer, grab_frames_sync, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+        }
+
+        g_object_set (camera,
+                      "buffered", buffered,
+                      "num-buffers", num_buffers,
+                      "buffer-alignment", alignment,
+                      "buffer-huge-pages", huge_pages,
+                      "buffer-lock-memory", lock_memory,
+                      "buffer-prefault", prefault,
+                      NULL);
+    }
+
+    if (options->n_start_stop > 0)
+        benchmark_start_latency (camera, buffer, options);
+
+    if (options->n_accessor_calls > 0)
+        benchmark_accessors (camera, options);
+
+    if (options->test_transform)
+        benchmark_transform (options);
+
+    if (options->filter_radius > 0)
+        benchmark_filters (camera, buffer, options);
+
+    /* Batched frame acquisition, compare with the per-frame sync results */
+    if (options->batch_size > 0) {
+        gpointer batch_buffer;
+
+        batch_size = options->batch_size;
+        batch_buffer = g_malloc0 (options->n_bytes * batch_size);
+        benchmark_method (camera, batch_buffer, grab_frames_batched, options, UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+        g_free (batch_buffer);
+    }
+
     /* Asynchronous frame acquisition */
     if (options->test_async) {
         g_object_set (G_OBJECT(camera), "transfer-asynchronously", TRUE, NULL);
@@ -316,6 +699,12 @@ main (int argc, char *argv[])
         .test_software = FALSE,
         .test_external = FALSE,
         .test_readout = FALSE,
+        .batch_size = 0,
+        .test_allocation = FALSE,
+        .n_start_stop = 0,
+        .n_accessor_calls = 0,
+        .test_transform = FALSE,
+        .filter_radius = 0,
     };
 
     static GOptionEntry entries[] = {
@@ -325,6 +714,12 @@ main (int argc, char *argv[])
         { "software", 0, 0, G_OPTION_ARG_NONE, &options.test_software, "Test software trigger mode", NULL },
         { "external", 0, 0, G_OPTION_ARG_NONE, &options.test_external, "Test external trigger mode", NULL },
         { "readout", 0, 0, G_OPTION_ARG_NONE, &options.test_readout, "Test readout from camRAM instead of sync acquisition", NULL},
+        { "batch", 'b', 0, G_OPTION_ARG_INT, &options.batch_size, "Also grab frames in batches of N with uca_camera_grab_many", "N" },
+        { "allocation", 0, 0, G_OPTION_ARG_NONE, &options.test_allocation, "Compare first-pass throughput of default and prefaulted ring buffers", NULL },
+        { "start-stop", 0, 0, G_OPTION_ARG_INT, &options.n_start_stop, "Measure start to first frame latency over N start/stop cycles", "N" },
+        { "accessors", 0, 0, G_OPTION_ARG_INT, &options.n_accessor_calls, "Compare N g_object_get calls with the typed accessors", "N" },
+        { "transform", 0, 0, G_OPTION_ARG_NONE, &options.test_transform, "Measure mirror, rotate, packing, binning, correction, accumulation and statistics throughput for typical sensor sizes", NULL },
+        { "filters", 0, 0, G_OPTION_ARG_INT, &options.filter_radius, "Measure buffered throughput through a box filter of radius N with 1, 2, 4, ... workers", "N" },
         { NULL }
     };
 
@@ -34,18 +34,13 @@
 typedef struct {
     gint n_frames;
     gchar *filename;
+    gchar *mapped;
 #ifdef HAVE_LIBTIFF
     gboolean write_tiff;
 #endif
 } Options;
 
 
-static guint
-get_bytes_per_pixel (guint bits_per_pixel)
-{
-    return bits_per_pixel > 8 ? 2 : 1;
-}
-
 static guint
 count_format_specifiers (const gchar *template)
 {
@@ -73,13 +68,14 @@ write_tiff (UcaRingBuffer *buffer,
             Options *opts,
             guint width,
             guint height,
-            guint bits_per_pixel)
+            UcaCameraPixelFormat format)
 {
     TIFF *tif;
     guint32 rows_per_strip;
     guint n_frames;
     guint bits_per_sample;
     gsize bytes_per_pixel;
+    guint16 *unpacked = NULL;
 
     if (count_format_specifiers (opts->filename) > 0)
         g_warning ("Can only write multi-page TIFF, format specifier is ignored.\n");
@@ -87,8 +83,13 @@ write_tiff (UcaRingBuffer *buffer,
     tif = TIFFOpen (opts->filename, "w");
     n_frames = uca_ring_buffer_get_num_blocks (buffer);
     rows_per_strip = TIFFDefaultStripSize (tif, (guint32) - 1);
-    bytes_per_pixel = get_bytes_per_pixel (bits_per_pixel);
-    bits_per_sample = bits_per_pixel > 8 ? 16 : 8;
+    bytes_per_pixel = format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 :
+                      format == UCA_CAMERA_PIXEL_FORMAT_MONO32 ? 4 : 2;
+    bits_per_sample = bytes_per_pixel * 8;
+
+    /* TIFF has no packed 10 and 12 bit samples, so expand them to 16 bit */
+    if (format == UCA_CAMERA_PIXEL_FORMAT_MONO10P || format == UCA_CAMERA_PIXEL_FORMAT_MONO12P)
+        unpacked = g_malloc ((gsize) width * height * sizeof (guint16));
 
     /* Write multi page TIFF file */
     TIFFSetField (tif, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE);
@@ -99,6 +100,12 @@ write_tiff (UcaRingBuffer *buffer,
 
         data = uca_ring_buffer_get_read_pointer (buffer);
 
+        if (unpacked != NULL) {
+            uca_transform_unpack (data, unpacked, (gsize) width * height,
+                                  uca_camera_pixel_format_get_bits (format));
+            data = unpacked;
+        }
+
         TIFFSetField (tif, TIFFTAG_IMAGEWIDTH, width);
         TIFFSetField (tif, TIFFTAG_IMAGELENGTH, height);
         TIFFSetField (tif, TIFFTAG_BITSPERSAMPLE, bits_per_sample);
@@ -115,6 +122,7 @@ write_tiff (UcaRingBuffer *buffer,
     }
 
     TIFFClose (tif);
+    g_free (unpacked);
 }
 #endif
 
@@ -169,7 +177,9 @@ record_frames (UcaCamera *camera, Options *opts)
     guint roi_width;
     guint roi_height;
     guint bits;
-    guint pixel_size;
+    guint frame_width;
+    guint frame_height;
+    UcaCameraPixelFormat format;
     gsize size;
     gint n_frames;
     guint n_allocated;
@@ -187,10 +197,22 @@ record_frames (UcaCamera *camera, Options *opts)
                   "sensor-bitdepth", &bits,
                   NULL);
 
-    pixel_size = get_bytes_per_pixel (bits);
-    size = roi_width * roi_height * pixel_size;
+    /* Packed frames stay packed in memory and in raw files */
+    uca_camera_get_frame_geometry (camera, &frame_width, &frame_height, &format);
+    size = uca_camera_get_frame_size (camera);
     n_allocated = opts->n_frames > 0 ? opts->n_frames : 256;
-    buffer = uca_ring_buffer_new (size, n_allocated);
+
+    if (opts->mapped != NULL) {
+        /* Frames go straight to the page cache and are written back while recording */
+        buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                               "block-size", (guint64) size,
+                               "num-blocks", n_allocated,
+                               "file-name", opts->mapped,
+                               NULL);
+    }
+    else
+        buffer = uca_ring_buffer_new (size, n_allocated);
+
     total_timer = g_timer_new();
     frame_timer = g_timer_new();
     g_timer_stop (frame_timer);
@@ -235,12 +257,17 @@ record_frames (UcaCamera *camera, Options *opts)
 
     uca_camera_stop_recording (camera, &error);
 
-    if (opts->filename == NULL)
-        g_print ("No filename given, not writing data.\n");
+    if (opts->mapped != NULL)
+        g_print ("Frames recorded to %s\n", opts->mapped);
+
+    if (opts->filename == NULL) {
+        if (opts->mapped == NULL)
+            g_print ("No filename given, not writing data.\n");
+    }
     else {
 #ifdef HAVE_LIBTIFF
         if (g_str_has_suffix (opts->filename, ".tif") || g_str_has_suffix (opts->filename, ".tiff"))
-            write_tiff (buffer, opts, roi_width, roi_height, bits);
+            write_tiff (buffer, opts, frame_width, frame_height, format);
         else
             write_raw (buffer, opts);
 #else
@@ -266,11 +293,13 @@ main (int argc, char *argv[])
     static Options opts = {
         .n_frames = -1,
         .filename = NULL,
+        .mapped = NULL,
     };
 
     static GOptionEntry entries[] = {
         { "num-frames", 'n', 0, G_OPTION_ARG_INT, &opts.n_frames, "Number of frames to acquire", "N" },
         { "output", 'o', 0, G_OPTION_ARG_STRING, &opts.filename, "Output file name template", "FILE" },
+        { "mapped", 'm', 0, G_OPTION_ARG_FILENAME, &opts.mapped, "Record into a memory-mapped ring buffer file", "FILE" },
         { NULL }
     };
 
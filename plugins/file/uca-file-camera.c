@@ -58,6 +58,7 @@ struct _UcaFileCameraPrivate {
     guint bitdepth;
     GList *fnames;
     GList *current;
+    guint current_index;
 };
 
 static gboolean
@@ -184,6 +185,7 @@ uca_file_camera_start_recording(UcaCamera *camera, GError **error)
     }
 
     priv->current = priv->fnames;
+    priv->current_index = 0;
 }
 
 static void
@@ -197,7 +199,7 @@ uca_file_camera_trigger (UcaCamera *camera, GError **error)
 }
 
 static gboolean
-uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+uca_file_camera_grab_full (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
 {
     UcaFileCameraPrivate *priv;
     g_return_val_if_fail (UCA_IS_FILE_CAMERA (camera), FALSE);
@@ -216,10 +218,24 @@ uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
         return FALSE;
     }
 
+    /* Use the position in the file list as the camera's frame counter */
+    info->capture_time = g_get_monotonic_time ();
+    info->hardware_counter = priv->current_index;
+    info->has_hardware_counter = TRUE;
+
     priv->current = g_list_next (priv->current);
+    priv->current_index++;
     return TRUE;
 }
 
+static gboolean
+uca_file_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+{
+    UcaFrameInfo info;
+
+    return uca_file_camera_grab_full (camera, data, &info, error);
+}
+
 static void
 uca_file_camera_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
 {
@@ -338,6 +354,7 @@ uca_file_camera_class_init(UcaFileCameraClass *klass)
     camera_class->start_recording = uca_file_camera_start_recording;
     camera_class->stop_recording = uca_file_camera_stop_recording;
     camera_class->grab = uca_file_camera_grab;
+    camera_class->grab_full = uca_file_camera_grab_full;
     camera_class->trigger = uca_file_camera_trigger;
 
     for (guint i = 0; file_overrideables[i] != 0; i++)
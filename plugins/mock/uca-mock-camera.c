@@ -48,6 +48,7 @@ static const gint mock_overrideables[] = {
     PROP_ROI_HEIGHT,
     PROP_HAS_STREAMING,
     PROP_HAS_CAMRAM_RECORDING,
+    PROP_PIXEL_FORMAT,
     0,
 };
 
@@ -62,10 +63,12 @@ struct _UcaMockCameraPrivate {
     guint bits;
     guint bytes;
     guint max_val;
+    UcaCameraPixelFormat pixel_format;
     guint roi_x, roi_y, roi_width, roi_height;
     gfloat max_frame_rate;
     gdouble exposure_time;
     guint8 *dummy_data;
+    guint8 *packed_data;
     guint current_frame;
     guint readout_index;
     gboolean fill_data;
@@ -241,6 +244,39 @@ print_current_frame (UcaMockCameraPrivate *priv, guint8 *buffer, gboolean prefix
     }
 }
 
+static gboolean
+is_packed (UcaMockCameraPrivate *priv)
+{
+    return priv->pixel_format == UCA_CAMERA_PIXEL_FORMAT_MONO10P ||
+           priv->pixel_format == UCA_CAMERA_PIXEL_FORMAT_MONO12P;
+}
+
+/*
+ * The frame is always rendered with one or two bytes per pixel and packed
+ * afterwards like the camera would send it.
+ */
+static void
+copy_current_frame (UcaMockCameraPrivate *priv, gpointer data)
+{
+    gsize n_pixels = (gsize) priv->roi_width * priv->roi_height;
+
+    if (is_packed (priv))
+        uca_transform_pack ((const guint16 *) priv->dummy_data, data, n_pixels, priv->bits);
+    else
+        g_memmove (data, priv->dummy_data, n_pixels * priv->bytes);
+}
+
+static void
+update_bits (UcaMockCameraPrivate *priv)
+{
+    priv->bytes = ceil (priv->bits / 8.);
+    priv->max_val = 0;
+
+    for (guint i = 0; i < priv->bits; i++) {
+        priv->max_val |= 1 << i;
+    }
+}
+
 static gpointer
 mock_grab_func(gpointer data)
 {
@@ -254,7 +290,13 @@ mock_grab_func(gpointer data)
     const gulong sleep_time = (gulong) G_USEC_PER_SEC / fps;
 
     while (priv->thread_running) {
-        camera->grab_func(priv->dummy_data, camera->user_data);
+        if (is_packed (priv)) {
+            copy_current_frame (priv, priv->packed_data);
+            camera->grab_func(priv->packed_data, camera->user_data);
+        }
+        else
+            camera->grab_func(priv->dummy_data, camera->user_data);
+
         g_usleep(sleep_time);
     }
 
@@ -274,6 +316,9 @@ uca_mock_camera_start_recording(UcaCamera *camera, GError **error)
     /* TODO: check that roi_x + roi_width < priv->width */
     priv->dummy_data = (guint8 *) g_malloc0(priv->roi_width * priv->roi_height * priv->bytes);
 
+    if (is_packed (priv))
+        priv->packed_data = g_malloc0 (uca_camera_get_frame_size (camera));
+
     g_object_get(G_OBJECT(camera), "transfer-asynchronously", &transfer_async, NULL);
 
     /*
@@ -315,6 +360,9 @@ uca_mock_camera_stop_recording(UcaCamera *camera, GError **error)
         priv->thread_running = FALSE;
         g_thread_join(priv->grab_thread);
     }
+
+    g_free (priv->packed_data);
+    priv->packed_data = NULL;
 }
 
 static void
@@ -328,31 +376,82 @@ uca_mock_camera_trigger (UcaCamera *camera, GError **error)
     g_async_queue_push (priv->trigger_queue, g_malloc0 (1));
 }
 
+/* Pushed into the trigger queue to wake up a cancelled grab */
+static gchar cancel_marker;
+
+static void
+push_cancel_marker (GCancellable *cancellable, GAsyncQueue *queue)
+{
+    g_async_queue_push (queue, &cancel_marker);
+}
+
 static gboolean
-uca_mock_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+wait_for_trigger (UcaCamera *camera, UcaMockCameraPrivate *priv, GError **error)
+{
+    GCancellable *cancellable;
+    gpointer trigger = NULL;
+    gint64 end_time;
+    gulong handler;
+
+    cancellable = uca_camera_get_grab_cancellable (camera);
+    end_time = uca_camera_get_grab_end_time (camera);
+    handler = g_cancellable_connect (cancellable, G_CALLBACK (push_cancel_marker), priv->trigger_queue, NULL);
+
+    /* Markers of earlier cancellations are ignored */
+    while (trigger == NULL || trigger == &cancel_marker) {
+        if (g_cancellable_set_error_if_cancelled (cancellable, error))
+            break;
+
+        if (end_time < 0) {
+            trigger = g_async_queue_pop (priv->trigger_queue);
+        }
+        else {
+            gint64 now = g_get_monotonic_time ();
+
+            if (now >= end_time) {
+                g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_TIMEOUT,
+                             "No software trigger arrived in time");
+                break;
+            }
+
+            trigger = g_async_queue_timeout_pop (priv->trigger_queue, end_time - now);
+        }
+    }
+
+    g_cancellable_disconnect (cancellable, handler);
+
+    if (trigger == NULL || trigger == &cancel_marker)
+        return FALSE;
+
+    g_free (trigger);
+    return TRUE;
+}
+
+static gboolean
+uca_mock_camera_grab_full (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
 {
     UcaMockCameraPrivate *priv;
-    UcaCameraTriggerSource trigger_source;
-    gdouble exposure_time;
 
     g_return_val_if_fail (UCA_IS_MOCK_CAMERA(camera), FALSE);
 
 
     priv = UCA_MOCK_CAMERA_GET_PRIVATE (camera);
 
-    g_object_get (G_OBJECT (camera),
-                  "exposure-time", &exposure_time,
-                  "trigger-source", &trigger_source, NULL);
+    if (uca_camera_get_trigger_source (camera) == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE &&
+        !wait_for_trigger (camera, priv, error))
+        return FALSE;
 
-    if (trigger_source == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE)
-        g_free (g_async_queue_pop (priv->trigger_queue));
 
+    g_usleep (G_USEC_PER_SEC * priv->exposure_time);
 
-    g_usleep (G_USEC_PER_SEC * exposure_time);
+    /* The frame is complete at the end of the exposure */
+    info->capture_time = g_get_monotonic_time ();
+    info->hardware_counter = priv->current_frame;
+    info->has_hardware_counter = TRUE;
 
     if (priv->fill_data) {
         print_current_frame (priv, priv->dummy_data, FALSE);
-        g_memmove (data, priv->dummy_data, priv->roi_width * priv->roi_height * priv->bytes);
+        copy_current_frame (priv, data);
     }
 
     priv->current_frame++;
@@ -360,6 +459,14 @@ uca_mock_camera_grab (UcaCamera *camera, gpointer data, GError **error)
     return TRUE;
 }
 
+static gboolean
+uca_mock_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+{
+    UcaFrameInfo info;
+
+    return uca_mock_camera_grab_full (camera, data, &info, error);
+}
+
 static gboolean
 uca_mock_camera_readout (UcaCamera *camera, gpointer data, guint index, GError **error)
 {
@@ -371,7 +478,92 @@ uca_mock_camera_readout (UcaCamera *camera, gpointer data, guint index, GError *
 
     if (priv->fill_data) {
         print_current_frame (priv, priv->dummy_data, TRUE);
-        g_memmove (data, priv->dummy_data, priv->roi_width * priv->roi_height * priv->bytes);
+        copy_current_frame (priv, data);
+    }
+
+    return TRUE;
+}
+
+/*
+ * Properties that a real device would accept in one configuration message.
+ */
+static const gint mock_batched[] = {
+    PROP_EXPOSURE_TIME,
+    PROP_ROI_X,
+    PROP_ROI_Y,
+    PROP_ROI_WIDTH,
+    PROP_ROI_HEIGHT,
+    0,
+};
+
+static gint
+batched_property_id (GParamSpec *pspec)
+{
+    for (guint i = 0; mock_batched[i] != 0; i++) {
+        if (g_strcmp0 (pspec->name, uca_camera_props[mock_batched[i]]) == 0)
+            return mock_batched[i];
+    }
+
+    return 0;
+}
+
+static gboolean
+uca_mock_camera_apply_properties (UcaCamera *camera, guint n_properties, GParamSpec **pspecs, const GValue *values, GError **error)
+{
+    UcaMockCameraPrivate *priv;
+    gdouble exposure_time;
+    guint roi_x, roi_y, roi_width, roi_height;
+
+    g_return_val_if_fail (UCA_IS_MOCK_CAMERA (camera), FALSE);
+    priv = UCA_MOCK_CAMERA_GET_PRIVATE (camera);
+
+    exposure_time = priv->exposure_time;
+    roi_x = priv->roi_x;
+    roi_y = priv->roi_y;
+    roi_width = priv->roi_width;
+    roi_height = priv->roi_height;
+
+    for (guint i = 0; i < n_properties; i++) {
+        switch (batched_property_id (pspecs[i])) {
+            case PROP_EXPOSURE_TIME:
+                exposure_time = g_value_get_double (&values[i]);
+                break;
+            case PROP_ROI_X:
+                roi_x = g_value_get_uint (&values[i]);
+                break;
+            case PROP_ROI_Y:
+                roi_y = g_value_get_uint (&values[i]);
+                break;
+            case PROP_ROI_WIDTH:
+                roi_width = g_value_get_uint (&values[i]);
+                break;
+            case PROP_ROI_HEIGHT:
+                roi_height = g_value_get_uint (&values[i]);
+                break;
+        }
+    }
+
+    /*
+     * Unlike single property changes, the whole ROI is known here and can be
+     * checked against the sensor before anything is applied.
+     */
+    if (roi_width == 0 || roi_height == 0 ||
+        roi_x + roi_width > priv->width || roi_y + roi_height > priv->height) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "ROI %ux%u at (%u, %u) does not fit on the %ux%u sensor",
+                     roi_width, roi_height, roi_x, roi_y, priv->width, priv->height);
+        return FALSE;
+    }
+
+    priv->exposure_time = exposure_time;
+    priv->roi_x = roi_x;
+    priv->roi_y = roi_y;
+    priv->roi_width = roi_width;
+    priv->roi_height = roi_height;
+
+    for (guint i = 0; i < n_properties; i++) {
+        if (batched_property_id (pspecs[i]) == 0)
+            g_object_set_property (G_OBJECT (camera), pspecs[i]->name, &values[i]);
     }
 
     return TRUE;
@@ -413,6 +605,17 @@ uca_mock_camera_set_property (GObject *object, guint property_id, const GValue *
         case PROP_TEST_ENUM:
             g_debug ("Set test-enum to `%i'", g_value_get_enum (value));
             break;
+        case PROP_PIXEL_FORMAT:
+            if (g_value_get_enum (value) == UCA_CAMERA_PIXEL_FORMAT_MONO32) {
+                g_warning ("Mock camera cannot deliver 32 bit pixels");
+                break;
+            }
+
+            priv->pixel_format = g_value_get_enum (value);
+            priv->bits = uca_camera_pixel_format_get_bits (priv->pixel_format);
+            update_bits (priv);
+            g_object_notify (object, uca_camera_props[PROP_SENSOR_BITDEPTH]);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
             return;
@@ -458,6 +661,9 @@ uca_mock_camera_get_property(GObject *object, guint property_id, GValue *value,
         case PROP_HAS_CAMRAM_RECORDING:
             g_value_set_boolean(value, FALSE);
             break;
+        case PROP_PIXEL_FORMAT:
+            g_value_set_enum (value, priv->pixel_format);
+            break;
         case PROP_FILL_DATA:
             g_value_set_boolean (value, priv->fill_data);
             break;
@@ -486,6 +692,7 @@ uca_mock_camera_finalize(GObject *object)
     }
 
     g_free (priv->dummy_data);
+    g_free (priv->packed_data);
     g_async_queue_unref (priv->trigger_queue);
 
     G_OBJECT_CLASS (uca_mock_camera_parent_class)->finalize(object);
@@ -501,12 +708,7 @@ ufo_mock_camera_initable_init (GInitable *initable,
     g_return_val_if_fail (UCA_IS_MOCK_CAMERA (initable), FALSE);
     priv = UCA_MOCK_CAMERA_GET_PRIVATE (UCA_MOCK_CAMERA (initable));
 
-    priv->bytes = ceil (priv->bits / 8.);
-    priv->max_val = 0;
-
-    for (guint i = 0; i < priv->bits; i++) {
-        priv->max_val |= 1 << i;
-    }
+    update_bits (priv);
 
     return TRUE;
 }
@@ -538,8 +740,10 @@ uca_mock_camera_class_init(UcaMockCameraClass *klass)
     camera_class->start_recording = uca_mock_camera_start_recording;
     camera_class->stop_recording = uca_mock_camera_stop_recording;
     camera_class->grab = uca_mock_camera_grab;
+    camera_class->grab_full = uca_mock_camera_grab_full;
     camera_class->readout = uca_mock_camera_readout;
     camera_class->trigger = uca_mock_camera_trigger;
+    camera_class->apply_properties = uca_mock_camera_apply_properties;
 
     for (guint i = 0; mock_overrideables[i] != 0; i++)
         g_object_class_override_property(gobject_class, mock_overrideables[i], uca_camera_props[mock_overrideables[i]]);
@@ -601,6 +805,7 @@ uca_mock_camera_init(UcaMockCamera *self)
     self->priv->roi_width = 512;
     self->priv->roi_height = 512;
     self->priv->bits = 8;
+    self->priv->pixel_format = UCA_CAMERA_PIXEL_FORMAT_MONO8;
     self->priv->bytes = 0;
     self->priv->max_val = 0;
     self->priv->trigger_queue = g_async_queue_new ();
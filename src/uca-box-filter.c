@@ -0,0 +1,269 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-box-filter
+ * @Short_description: Mean filter
+ * @Title: UcaBoxFilter
+ *
+ * #UcaBoxFilter replaces every pixel by the rounded mean of the square of
+ * #UcaBoxFilter:radius pixels around it. Near the border of the frame, only
+ * the pixels inside the frame are averaged.
+ */
+
+#include <string.h>
+#include "uca-box-filter.h"
+
+#define UCA_BOX_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_BOX_FILTER, UcaBoxFilterPrivate))
+
+static void uca_box_filter_iface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaBoxFilter, uca_box_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_box_filter_iface_init))
+
+/* Keeps the sums of (2 * radius + 1)^2 16-bit pixels within 32 bits */
+#define MAX_RADIUS  100
+
+enum {
+    PROP_0,
+    PROP_RADIUS,
+    N_PROPERTIES
+};
+
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+struct _UcaBoxFilterPrivate {
+    guint radius;
+};
+
+/*
+ * Filters run on several worker threads at once, so every thread keeps its
+ * own scratch memory across frames.
+ */
+typedef struct {
+    gsize size;
+    gpointer data;
+} Scratch;
+
+static void
+scratch_free (Scratch *scratch)
+{
+    g_free (scratch->data);
+    g_free (scratch);
+}
+
+static GPrivate scratch_key = G_PRIVATE_INIT ((GDestroyNotify) scratch_free);
+
+static gpointer
+get_scratch (gsize size)
+{
+    Scratch *scratch;
+
+    scratch = g_private_get (&scratch_key);
+
+    if (scratch == NULL) {
+        scratch = g_new0 (Scratch, 1);
+        g_private_set (&scratch_key, scratch);
+    }
+
+    if (scratch->size < size) {
+        g_free (scratch->data);
+        scratch->data = g_malloc (size);
+        scratch->size = size;
+    }
+
+    return scratch->data;
+}
+
+/*
+ * The frame is processed top to bottom in one pass. col_sum holds the sums of
+ * the current vertical window for every column, over which a horizontal window
+ * slides to produce the output row. Output rows overwrite the input, hence the
+ * last radius + 1 input rows are saved to be subtracted from col_sum later.
+ */
+#define DEFINE_BOX_FILTER(suffix, type)                                         \
+static void                                                                     \
+box_filter_##suffix (type *data, guint width, guint height, guint radius,      \
+                     guint32 *col_sum, type *saved)                             \
+{                                                                               \
+    guint n_saved = radius + 1;                                                 \
+                                                                                \
+    memset (col_sum, 0, width * sizeof (guint32));                              \
+                                                                                \
+    for (guint y = 0; y < MIN (radius, height); y++)                           \
+        for (guint x = 0; x < width; x++)                                       \
+            col_sum[x] += data[(gsize) y * width + x];                          \
+                                                                                \
+    for (guint y = 0; y < height; y++) {                                        \
+        type *row = data + (gsize) y * width;                                   \
+        guint ny;                                                               \
+        guint64 sum = 0;                                                        \
+                                                                                \
+        if (y + radius < height) {                                              \
+            const type *next = data + (gsize) (y + radius) * width;             \
+                                                                                \
+            for (guint x = 0; x < width; x++)                                   \
+                col_sum[x] += next[x];                                          \
+        }                                                                       \
+                                                                                \
+        ny = MIN (y + radius, height - 1) - (y > radius ? y - radius : 0) + 1;  \
+        memcpy (saved + (gsize) (y % n_saved) * width, row, width * sizeof (type)); \
+                                                                                \
+        for (guint x = 0; x < MIN (radius, width); x++)                        \
+            sum += col_sum[x];                                                  \
+                                                                                \
+        for (guint x = 0; x < width; x++) {                                     \
+            guint n;                                                            \
+                                                                                \
+            if (x + radius < width)                                             \
+                sum += col_sum[x + radius];                                     \
+                                                                                \
+            if (x > radius)                                                     \
+                sum -= col_sum[x - radius - 1];                                 \
+                                                                                \
+            n = (MIN (x + radius, width - 1) - (x > radius ? x - radius : 0) + 1) * ny; \
+            row[x] = (type) ((sum + n / 2) / n);                                \
+        }                                                                       \
+                                                                                \
+        if (y >= radius) {                                                      \
+            const type *old = saved + (gsize) ((y - radius) % n_saved) * width; \
+                                                                                \
+            for (guint x = 0; x < width; x++)                                   \
+                col_sum[x] -= old[x];                                           \
+        }                                                                       \
+    }                                                                           \
+}
+
+DEFINE_BOX_FILTER (8, guint8)
+DEFINE_BOX_FILTER (16, guint16)
+
+static gboolean
+uca_box_filter_setup (UcaFilter *filter, guint width, guint height, guint pixel_size, GError **error)
+{
+    if (pixel_size != 1 && pixel_size != 2) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_UNSUPPORTED,
+                     "Box filter only supports 8 and 16 bit pixels");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+uca_box_filter_process (UcaFilter *filter, gpointer data, guint width, guint height,
+                        guint pixel_size, GError **error)
+{
+    guint radius;
+    guint8 *scratch;
+
+    radius = g_atomic_int_get (&UCA_BOX_FILTER (filter)->priv->radius);
+
+    if (radius == 0 || width == 0 || height == 0)
+        return TRUE;
+
+    scratch = get_scratch (width * sizeof (guint32) + (gsize) (radius + 1) * width * pixel_size);
+
+    if (pixel_size == 1)
+        box_filter_8 (data, width, height, radius, (guint32 *) scratch, scratch + width * sizeof (guint32));
+    else
+        box_filter_16 (data, width, height, radius, (guint32 *) scratch, (guint16 *) (scratch + width * sizeof (guint32)));
+
+    return TRUE;
+}
+
+/**
+ * uca_box_filter_new:
+ * @radius: Number of pixels averaged on each side of a pixel
+ *
+ * Create a new mean filter.
+ *
+ * Return value: (transfer full): A new #UcaFilter
+ * Since: 2.5
+ */
+UcaFilter *
+uca_box_filter_new (guint radius)
+{
+    return g_object_new (UCA_TYPE_BOX_FILTER, "radius", radius, NULL);
+}
+
+static void
+uca_box_filter_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaBoxFilterPrivate *priv = UCA_BOX_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_RADIUS:
+            g_value_set_uint (value, g_atomic_int_get (&priv->radius));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_box_filter_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaBoxFilterPrivate *priv = UCA_BOX_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_RADIUS:
+            /* Frames that are being processed keep the old radius */
+            g_atomic_int_set (&priv->radius, g_value_get_uint (value));
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_box_filter_iface_init (UcaFilterInterface *iface)
+{
+    iface->setup = uca_box_filter_setup;
+    iface->process = uca_box_filter_process;
+}
+
+static void
+uca_box_filter_class_init (UcaBoxFilterClass *klass)
+{
+    GObjectClass *oclass;
+
+    oclass = G_OBJECT_CLASS (klass);
+    oclass->get_property = uca_box_filter_get_property;
+    oclass->set_property = uca_box_filter_set_property;
+
+    properties[PROP_RADIUS] =
+        g_param_spec_uint ("radius",
+                           "Radius in pixels",
+                           "Number of pixels averaged on each side of a pixel",
+                           0, MAX_RADIUS, 1,
+                           G_PARAM_READWRITE);
+
+    for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
+        g_object_class_install_property (oclass, i, properties[i]);
+
+    g_type_class_add_private (klass, sizeof (UcaBoxFilterPrivate));
+}
+
+static void
+uca_box_filter_init (UcaBoxFilter *filter)
+{
+    filter->priv = UCA_BOX_FILTER_GET_PRIVATE (filter);
+    filter->priv->radius = 1;
+}
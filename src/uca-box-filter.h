@@ -0,0 +1,55 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef UCA_BOX_FILTER_H
+#define UCA_BOX_FILTER_H
+
+#include <glib-object.h>
+#include "uca-api.h"
+#include "uca-filter.h"
+
+#define UCA_TYPE_BOX_FILTER             (uca_box_filter_get_type())
+#define UCA_BOX_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_BOX_FILTER, UcaBoxFilter))
+#define UCA_IS_BOX_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_BOX_FILTER))
+#define UCA_BOX_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_BOX_FILTER, UcaBoxFilterClass))
+#define UCA_IS_BOX_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_BOX_FILTER))
+#define UCA_BOX_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_BOX_FILTER, UcaBoxFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaBoxFilter           UcaBoxFilter;
+typedef struct _UcaBoxFilterClass      UcaBoxFilterClass;
+typedef struct _UcaBoxFilterPrivate    UcaBoxFilterPrivate;
+
+struct _UcaBoxFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaBoxFilterPrivate *priv;
+};
+
+struct _UcaBoxFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UCA_API UcaFilter * uca_box_filter_new      (guint radius);
+UCA_API GType       uca_box_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
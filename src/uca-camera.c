@@ -30,11 +30,22 @@
 #endif
 
 #include <glib.h>
+#include <gio/gio.h>
+#include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 #include "compat.h"
 #include "uca-camera.h"
 #include "uca-ring-buffer.h"
+#include "uca-transform.h"
 #include "uca-enums.h"
 
 #define G_LOG_LEVEL_DOMAIN "uca"
@@ -136,11 +147,38 @@ const gchar *uca_camera_props[N_BASE_PROPERTIES] = {
     "buffered",
     "num-buffers",
     "mirror",
-    "rotate"
+    "rotate",
+    "ring-policy",
+    "dropped-frames",
+    "async-workers",
+    "async-preserve-order",
+    "buffer-alignment",
+    "buffer-huge-pages",
+    "buffer-lock-memory",
+    "buffer-prefault",
+    "buffer-numa-node",
+    "buffer-file",
+    "spill-directory",
+    "max-buffer-memory",
+    "buffer-capacity",
+    "buffer-peak-fill",
+    "apply-transform",
+    "pixel-format",
+    "software-horizontal-binning",
+    "software-vertical-binning",
+    "software-binning-mode",
+    "software-roi-x0",
+    "software-roi-y0",
+    "software-roi-width",
+    "software-roi-height",
+    "filter-workers",
+    "accumulate-frames",
+    "accumulate-mode",
+    "statistics",
+    "statistics-step"
 };
 
 static GParamSpec *camera_properties[N_BASE_PROPERTIES] = { NULL, };
-static GMutex access_lock;
 static gboolean str_to_boolean (const gchar *s);
 
 #define DEFINE_CAST(suffix, trans_func)                 \
@@ -164,7 +202,178 @@ DEFINE_CAST (enum,      atoi)
 DEFINE_CAST (boolean,   str_to_boolean)
 
 
+/*
+ * Geometry of the software binning stage. The plugin delivers src_width times
+ * src_height pixels, of which the region starting at x, y is binned into width
+ * times height pixels.
+ */
+typedef struct {
+    guint src_width;
+    guint src_height;
+    guint src_pixel_size;
+    guint x;
+    guint y;
+    guint horizontal;
+    guint vertical;
+    guint width;
+    guint height;
+    gboolean widen;
+} Binning;
+
+/*
+ * Filters as of the start of the recording and the geometry of the frames they
+ * process.
+ */
+typedef struct {
+    GPtrArray *filters;
+    guint width;
+    guint height;
+    guint pixel_size;
+} FilterChain;
+
+/*
+ * Sums of consecutive stored frames as of the start of the recording. frame
+ * holds the frame that is added next. Partial sums survive failed grabs, so
+ * that a grab retried after a timeout completes the frame.
+ */
+typedef struct {
+    guint n_frames;
+    gboolean mean;
+    gsize n_pixels;
+    guint pixel_size;
+    gpointer frame;
+    guint32 *sums;
+    guint n_summed;
+    UcaFrameInfo info;
+} Accumulation;
+
+static void accumulation_free (Accumulation *accumulation);
+
+/*
+ * In asynchronous mode with worker threads, the plugin calls async_pool_push()
+ * instead of the user's grab function. It copies the frame into one of a fixed
+ * number of buffers and queues it for the workers, which call the user's grab
+ * function. free_buffers and pending are protected by lock.
+ */
+typedef struct {
+    UcaCameraGrabFunc func;
+    gpointer user_data;
+    const Binning *binning;
+    const FilterChain *chain;
+    Accumulation *accumulation;
+    UcaCameraRingPolicy policy;
+    gboolean preserve_order;
+    gsize frame_size;
+    guint8 *memory;
+    GQueue free_buffers;
+    GQueue pending;
+    GMutex lock;
+    GCond cond;
+    gboolean stopping;
+    guint64 next_ticket;
+    guint64 next_callback;
+    guint64 n_dropped;
+    guint n_threads;
+    GThread **threads;
+} AsyncPool;
+
+/*
+ * With UCA_CAMERA_RING_POLICY_SPILL, frames that arrive while the ring buffer
+ * is full are grabbed into staging buffers and appended to a scratch file by a
+ * writer thread. Consumers read them back once the ring buffer is empty. The
+ * read thread only writes to the ring buffer again after the file has been
+ * drained, hence all frames in the ring buffer are older than the spilled ones.
+ *
+ * Records consist of the UcaFrameInfo followed by the frame. n_queued counts
+ * records handed to the writer, n_written those in the file and n_read those
+ * claimed by consumers, so n_read <= n_written <= n_queued. n_reading of the
+ * claimed records are still being read without buffer_lock and must not be
+ * overwritten. Reads share the input stream and are serialized by read_lock.
+ */
+typedef struct {
+    UcaCameraPrivate *priv;
+    GFile *file;
+    GFileIOStream *output;
+    GFileInputStream *input;
+    gsize record_size;
+    guint8 *memory;
+    GQueue free_buffers;
+    GQueue pending;
+    GQueue borrowed;
+    GMutex lock;
+    GMutex read_lock;
+    GCond cond;
+    gboolean stopping;
+    gboolean failed;
+    guint64 n_queued;
+    guint64 n_written;
+    guint64 n_read;
+    guint n_reading;
+    GThread *thread;
+} SpillQueue;
+
+/* Frames the read thread can grab ahead of the spill writer */
+#define SPILL_STAGING_FRAMES    8
+
+/*
+ * In buffered mode with filters, the read thread grabs frames into free blocks
+ * ahead of the ring buffer's write location and queues them for the workers,
+ * which run the filters in place. Frames may finish in any order, but whoever
+ * finishes the oldest one publishes it together with all finished frames
+ * behind it, so consumers see them in order. Jobs are indexed by their
+ * sequence number modulo n_jobs and n_published <= n_started <= n_submitted.
+ * All fields are protected by lock.
+ */
+typedef struct {
+    gpointer data;
+    UcaFrameInfo *info;
+    gboolean done;
+} PipelineJob;
+
+typedef struct {
+    UcaCameraPrivate *priv;
+    const FilterChain *chain;
+    PipelineJob *jobs;
+    guint n_jobs;
+    guint64 n_submitted;
+    guint64 n_started;
+    guint64 n_published;
+    GMutex lock;
+    GCond cond;
+    gboolean stopping;
+    guint n_threads;
+    GThread **threads;
+} Pipeline;
+
+/*
+ * Locking is done per camera instance so that independent cameras never
+ * serialize on each other:
+ *
+ * - control_lock serializes state transitions, i.e. starting and stopping
+ *   recording and readout.
+ * - grab_lock serializes consumers calling uca_camera_grab() and
+ *   uca_camera_readout() on the same camera in unbuffered mode.
+ * - buffer_lock protects the reading side of the ring buffer and the dropped
+ *   frame counter in buffered mode and is used together with buffer_cond to
+ *   wait for frames, free blocks and cancellation. Consumers sleep on it without holding grab_lock, so that
+ *   other threads can still release borrowed frames.
+ * - trigger_lock serializes software triggers. It is independent of the other
+ *   locks because a grab may block until a trigger arrives.
+ * - device_lock serializes calls into the plugin's virtual functions.
+ * - The async pool, the spill queue and the filter pipeline have their own
+ *   locks which may be taken after buffer_lock.
+ *
+ * If more than one lock is needed, control_lock and grab_lock must be taken
+ * before device_lock.
+ */
 struct _UcaCameraPrivate {
+    GMutex control_lock;
+    GMutex grab_lock;
+    GMutex trigger_lock;
+    GMutex device_lock;
+    GMutex buffer_lock;
+    GCond buffer_cond;
+    gint n_buffer_waiters;
     gboolean cancelling_recording;
     gboolean cancelling_grab;
     gboolean is_recording;
@@ -174,10 +383,98 @@ struct _UcaCameraPrivate {
     guint num_buffers;
     GThread *read_thread;
     UcaRingBuffer *ring_buffer;
+    UcaRingBuffer *spare_ring_buffer;
+    GHashTable *consumers;
+    gint frame_fd;
+    gint frame_fd_write;
+    gint frame_fd_signalled;
+    gint frames_pending;
+    GQueue borrowed_frames;
+    GQueue released_frames;
+    guint n_copying;
+    GCancellable *grab_cancellable;
+    gint64 grab_end_time;
+
+    UcaCameraRingPolicy ring_policy;
+    guint64 dropped_frames;
+    gpointer drop_buffer;
+    guint64 frame_sequence;
+    guint async_workers;
+    gboolean async_preserve_order;
+    AsyncPool *async_pool;
+    SpillQueue *spill_queue;
+    gchar *spill_directory;
+    guint64 max_buffer_memory;
+    gboolean ring_growable;
+    gint64 ring_busy_time;
+    guint peak_buffer_fill;
+    guint buffer_alignment;
+    gboolean buffer_huge_pages;
+    gboolean buffer_lock_memory;
+    gboolean buffer_prefault;
+    gint buffer_numa_node;
+    gchar *buffer_file;
     UcaCameraTriggerSource trigger_source;
     UcaCameraTriggerType trigger_type;
     gboolean mirror;
     guint rotate;
+    gboolean apply_transform;
+
+    /* Mirror and rotate as of the start of the recording */
+    gboolean transform;
+    gboolean transform_mirror;
+    guint transform_rotate;
+    guint transform_width;
+    guint transform_height;
+    guint transform_pixel_size;
+    gpointer transform_buffer;
+    gsize transform_buffer_size;
+
+    guint software_horizontal_binning;
+    guint software_vertical_binning;
+    UcaCameraBinningMode software_binning_mode;
+    guint software_roi_x;
+    guint software_roi_y;
+    guint software_roi_width;
+    guint software_roi_height;
+
+    /* Software binning as of the start of the recording */
+    gboolean bin;
+    Binning binning;
+    gpointer bin_buffer;
+    gsize bin_buffer_size;
+
+    /* Filters as of the start of the recording, protected by control_lock */
+    GPtrArray *filters;
+    guint filter_workers;
+    FilterChain *filter_chain;
+    Pipeline *pipeline;
+
+    guint accumulate_frames;
+    UcaCameraAccumulateMode accumulate_mode;
+
+    /* Accumulation as of the start of the recording */
+    Accumulation *accumulation;
+
+    gboolean statistics;
+    guint statistics_step;
+
+    /* Frame statistics as of the start of the recording */
+    gboolean stats;
+    guint stats_width;
+    guint stats_height;
+    guint stats_pixel_size;
+    guint stats_bits;
+    guint stats_step;
+
+    /* Copies of properties that plugins may override, see cache_property() */
+    gint cached_trigger_source;
+    gint cached_roi_x;
+    gint cached_roi_y;
+    gint cached_roi_width;
+    gint cached_roi_height;
+    gint cached_bitdepth;
+    gint cached_pixel_format;
 };
 
 static gboolean
@@ -199,6 +496,19 @@ uca_camera_set_property_unit (GParamSpec *pspec, UcaUnit unit)
         g_param_spec_set_qdata (pspec, UCA_UNIT_QUARK, GINT_TO_POINTER (unit));
 }
 
+/*
+ * Plugins that do not override #UcaCamera:pixel-format deliver unpacked frames
+ * with as many bytes as the bit depth needs.
+ */
+static UcaCameraPixelFormat
+get_native_pixel_format (GObject *object)
+{
+    guint bitdepth;
+
+    g_object_get (object, "sensor-bitdepth", &bitdepth, NULL);
+    return bitdepth <= 8 ? UCA_CAMERA_PIXEL_FORMAT_MONO8 : UCA_CAMERA_PIXEL_FORMAT_MONO16;
+}
+
 static void
 uca_camera_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
 {
@@ -232,6 +542,12 @@ uca_camera_set_property (GObject *object, guint property_id, const GValue *value
 
         case PROP_BUFFERED:
             priv->buffered = g_value_get_boolean (value);
+
+            /* Release the memory kept for the next buffered recording */
+            if (!priv->buffered && priv->spare_ring_buffer != NULL) {
+                g_object_unref (priv->spare_ring_buffer);
+                priv->spare_ring_buffer = NULL;
+            }
             break;
 
         case PROP_NUM_BUFFERS:
@@ -244,6 +560,109 @@ uca_camera_set_property (GObject *object, guint property_id, const GValue *value
         case PROP_ROTATE:
             priv->rotate = g_value_get_uint (value);
         break;
+        case PROP_APPLY_TRANSFORM:
+            priv->apply_transform = g_value_get_boolean (value);
+            break;
+
+        case PROP_RING_POLICY:
+            priv->ring_policy = g_value_get_enum (value);
+            break;
+
+        case PROP_ASYNC_WORKERS:
+            priv->async_workers = g_value_get_uint (value);
+            break;
+
+        case PROP_ASYNC_PRESERVE_ORDER:
+            priv->async_preserve_order = g_value_get_boolean (value);
+            break;
+
+        case PROP_BUFFER_ALIGNMENT:
+            priv->buffer_alignment = g_value_get_uint (value);
+            break;
+
+        case PROP_BUFFER_HUGE_PAGES:
+            priv->buffer_huge_pages = g_value_get_boolean (value);
+            break;
+
+        case PROP_BUFFER_LOCK_MEMORY:
+            priv->buffer_lock_memory = g_value_get_boolean (value);
+            break;
+
+        case PROP_BUFFER_PREFAULT:
+            priv->buffer_prefault = g_value_get_boolean (value);
+            break;
+
+        case PROP_BUFFER_NUMA_NODE:
+            priv->buffer_numa_node = g_value_get_int (value);
+            break;
+
+        case PROP_BUFFER_FILE:
+            g_free (priv->buffer_file);
+            priv->buffer_file = g_value_dup_string (value);
+            break;
+
+        case PROP_SPILL_DIRECTORY:
+            g_free (priv->spill_directory);
+            priv->spill_directory = g_value_dup_string (value);
+            break;
+
+        case PROP_MAX_BUFFER_MEMORY:
+            priv->max_buffer_memory = g_value_get_uint64 (value);
+            break;
+
+        case PROP_PIXEL_FORMAT:
+            if (g_value_get_enum (value) != get_native_pixel_format (object))
+                g_warning ("%s does not support packed pixel formats",
+                           G_OBJECT_TYPE_NAME (object));
+            break;
+
+        case PROP_SOFTWARE_HORIZONTAL_BINNING:
+            priv->software_horizontal_binning = g_value_get_uint (value);
+            break;
+
+        case PROP_SOFTWARE_VERTICAL_BINNING:
+            priv->software_vertical_binning = g_value_get_uint (value);
+            break;
+
+        case PROP_SOFTWARE_BINNING_MODE:
+            priv->software_binning_mode = g_value_get_enum (value);
+            break;
+
+        case PROP_SOFTWARE_ROI_X:
+            priv->software_roi_x = g_value_get_uint (value);
+            break;
+
+        case PROP_SOFTWARE_ROI_Y:
+            priv->software_roi_y = g_value_get_uint (value);
+            break;
+
+        case PROP_SOFTWARE_ROI_WIDTH:
+            priv->software_roi_width = g_value_get_uint (value);
+            break;
+
+        case PROP_SOFTWARE_ROI_HEIGHT:
+            priv->software_roi_height = g_value_get_uint (value);
+            break;
+
+        case PROP_FILTER_WORKERS:
+            priv->filter_workers = g_value_get_uint (value);
+            break;
+
+        case PROP_ACCUMULATE_FRAMES:
+            priv->accumulate_frames = g_value_get_uint (value);
+            break;
+
+        case PROP_ACCUMULATE_MODE:
+            priv->accumulate_mode = g_value_get_enum (value);
+            break;
+
+        case PROP_STATISTICS:
+            priv->statistics = g_value_get_boolean (value);
+            break;
+
+        case PROP_STATISTICS_STEP:
+            priv->statistics_step = g_value_get_uint (value);
+            break;
 
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -332,6 +751,136 @@ uca_camera_get_property(GObject *object, guint property_id, GValue *value, GPara
         case PROP_ROTATE:
             g_value_set_uint(value, priv->rotate);
         break;
+        case PROP_APPLY_TRANSFORM:
+            g_value_set_boolean (value, priv->apply_transform);
+            break;
+
+        case PROP_PIXEL_FORMAT:
+            g_value_set_enum (value, get_native_pixel_format (object));
+            break;
+
+        case PROP_SOFTWARE_HORIZONTAL_BINNING:
+            g_value_set_uint (value, priv->software_horizontal_binning);
+            break;
+
+        case PROP_SOFTWARE_VERTICAL_BINNING:
+            g_value_set_uint (value, priv->software_vertical_binning);
+            break;
+
+        case PROP_SOFTWARE_BINNING_MODE:
+            g_value_set_enum (value, priv->software_binning_mode);
+            break;
+
+        case PROP_SOFTWARE_ROI_X:
+            g_value_set_uint (value, priv->software_roi_x);
+            break;
+
+        case PROP_SOFTWARE_ROI_Y:
+            g_value_set_uint (value, priv->software_roi_y);
+            break;
+
+        case PROP_SOFTWARE_ROI_WIDTH:
+            g_value_set_uint (value, priv->software_roi_width);
+            break;
+
+        case PROP_SOFTWARE_ROI_HEIGHT:
+            g_value_set_uint (value, priv->software_roi_height);
+            break;
+
+        case PROP_FILTER_WORKERS:
+            g_value_set_uint (value, priv->filter_workers);
+            break;
+
+        case PROP_ACCUMULATE_FRAMES:
+            g_value_set_uint (value, priv->accumulate_frames);
+            break;
+
+        case PROP_ACCUMULATE_MODE:
+            g_value_set_enum (value, priv->accumulate_mode);
+            break;
+
+        case PROP_STATISTICS:
+            g_value_set_boolean (value, priv->statistics);
+            break;
+
+        case PROP_STATISTICS_STEP:
+            g_value_set_uint (value, priv->statistics_step);
+            break;
+
+        case PROP_RING_POLICY:
+            g_value_set_enum (value, priv->ring_policy);
+            break;
+
+        case PROP_DROPPED_FRAMES:
+            {
+                guint64 dropped;
+
+                g_mutex_lock (&priv->buffer_lock);
+                dropped = priv->dropped_frames;
+
+                if (priv->ring_buffer != NULL)
+                    dropped += uca_ring_buffer_get_num_dropped (priv->ring_buffer);
+
+                if (priv->async_pool != NULL) {
+                    g_mutex_lock (&priv->async_pool->lock);
+                    dropped += priv->async_pool->n_dropped;
+                    g_mutex_unlock (&priv->async_pool->lock);
+                }
+
+                g_mutex_unlock (&priv->buffer_lock);
+                g_value_set_uint64 (value, dropped);
+            }
+            break;
+
+        case PROP_ASYNC_WORKERS:
+            g_value_set_uint (value, priv->async_workers);
+            break;
+
+        case PROP_ASYNC_PRESERVE_ORDER:
+            g_value_set_boolean (value, priv->async_preserve_order);
+            break;
+
+        case PROP_BUFFER_ALIGNMENT:
+            g_value_set_uint (value, priv->buffer_alignment);
+            break;
+
+        case PROP_BUFFER_HUGE_PAGES:
+            g_value_set_boolean (value, priv->buffer_huge_pages);
+            break;
+
+        case PROP_BUFFER_LOCK_MEMORY:
+            g_value_set_boolean (value, priv->buffer_lock_memory);
+            break;
+
+        case PROP_BUFFER_PREFAULT:
+            g_value_set_boolean (value, priv->buffer_prefault);
+            break;
+
+        case PROP_BUFFER_NUMA_NODE:
+            g_value_set_int (value, priv->buffer_numa_node);
+            break;
+
+        case PROP_BUFFER_FILE:
+            g_value_set_string (value, priv->buffer_file);
+            break;
+
+        case PROP_SPILL_DIRECTORY:
+            g_value_set_string (value, priv->spill_directory);
+            break;
+
+        case PROP_MAX_BUFFER_MEMORY:
+            g_value_set_uint64 (value, priv->max_buffer_memory);
+            break;
+
+        case PROP_BUFFER_CAPACITY:
+            g_mutex_lock (&priv->buffer_lock);
+            g_value_set_uint (value, priv->ring_buffer != NULL ? uca_ring_buffer_get_capacity (priv->ring_buffer) : 0);
+            g_mutex_unlock (&priv->buffer_lock);
+            break;
+
+        case PROP_BUFFER_PEAK_FILL:
+            g_value_set_uint (value, (guint) g_atomic_int_get (&priv->peak_buffer_fill));
+            break;
 
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -360,15 +909,23 @@ uca_camera_dispose (GObject *object)
         priv->ring_buffer = NULL;
     }
 
+    if (priv->spare_ring_buffer != NULL) {
+        g_object_unref (priv->spare_ring_buffer);
+        priv->spare_ring_buffer = NULL;
+    }
+
     G_OBJECT_CLASS (uca_camera_parent_class)->dispose (object);
 }
 
 static void
 uca_camera_finalize (GObject *object)
 {
+    UcaCameraPrivate *priv;
     GParamSpec **props;
     guint n_props;
 
+    priv = UCA_CAMERA_GET_PRIVATE (object);
+
     /* We will reset property units of all subclassed objects  */
     props = g_object_class_list_properties (G_OBJECT_GET_CLASS (object), &n_props);
 
@@ -378,9 +935,93 @@ uca_camera_finalize (GObject *object)
 
     g_free (props);
 
+    g_mutex_clear (&priv->control_lock);
+    g_mutex_clear (&priv->grab_lock);
+    g_mutex_clear (&priv->trigger_lock);
+    g_mutex_clear (&priv->device_lock);
+    g_mutex_clear (&priv->buffer_lock);
+    g_cond_clear (&priv->buffer_cond);
+    g_queue_clear (&priv->borrowed_frames);
+    g_queue_clear (&priv->released_frames);
+    g_free (priv->buffer_file);
+    g_free (priv->spill_directory);
+    g_free (priv->transform_buffer);
+    g_free (priv->bin_buffer);
+    g_ptr_array_unref (priv->filters);
+    accumulation_free (priv->accumulation);
+    g_hash_table_destroy (priv->consumers);
+    g_object_unref (priv->grab_cancellable);
+
+#ifdef G_OS_UNIX
+    if (priv->frame_fd_write >= 0 && priv->frame_fd_write != priv->frame_fd)
+        g_close (priv->frame_fd_write, NULL);
+
+    if (priv->frame_fd >= 0)
+        g_close (priv->frame_fd, NULL);
+#endif
+
     G_OBJECT_CLASS (uca_camera_parent_class)->finalize (object);
 }
 
+/*
+ * Update the cached copy of @pspec if hot paths read it. Plugins may override
+ * these properties, so we must go through the property system once.
+ */
+static void
+cache_property (GObject *object, GParamSpec *pspec)
+{
+    UcaCameraPrivate *priv;
+    gint *cached = NULL;
+    GValue value = G_VALUE_INIT;
+
+    priv = UCA_CAMERA_GET_PRIVATE (object);
+
+    if (pspec == camera_properties[PROP_TRIGGER_SOURCE])
+        cached = &priv->cached_trigger_source;
+    else if (pspec == camera_properties[PROP_ROI_X])
+        cached = &priv->cached_roi_x;
+    else if (pspec == camera_properties[PROP_ROI_Y])
+        cached = &priv->cached_roi_y;
+    else if (pspec == camera_properties[PROP_ROI_WIDTH])
+        cached = &priv->cached_roi_width;
+    else if (pspec == camera_properties[PROP_ROI_HEIGHT])
+        cached = &priv->cached_roi_height;
+    else if (pspec == camera_properties[PROP_SENSOR_BITDEPTH])
+        cached = &priv->cached_bitdepth;
+    else if (pspec == camera_properties[PROP_PIXEL_FORMAT])
+        cached = &priv->cached_pixel_format;
+
+    if (cached == NULL)
+        return;
+
+    g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+    g_object_get_property (object, pspec->name, &value);
+
+    if (G_VALUE_HOLDS_ENUM (&value))
+        g_atomic_int_set (cached, g_value_get_enum (&value));
+    else
+        g_atomic_int_set (cached, (gint) g_value_get_uint (&value));
+
+    g_value_unset (&value);
+
+    /* The default pixel format follows the bit depth without notification */
+    if (pspec == camera_properties[PROP_SENSOR_BITDEPTH])
+        cache_property (object, camera_properties[PROP_PIXEL_FORMAT]);
+}
+
+/*
+ * Property changes are announced through here, so this keeps the cached
+ * properties coherent with those set by the user or the plugin.
+ */
+static void
+uca_camera_dispatch_properties_changed (GObject *object, guint n_pspecs, GParamSpec **pspecs)
+{
+    for (guint i = 0; i < n_pspecs; i++)
+        cache_property (object, pspecs[i]);
+
+    G_OBJECT_CLASS (uca_camera_parent_class)->dispatch_properties_changed (object, n_pspecs, pspecs);
+}
+
 /*
  * Make sure the camera reads the actual device state once the child plugin has
  * been constructed. This allows us to use the camera even if e.g. the actual
@@ -396,6 +1037,14 @@ uca_camera_constructed (GObject *object)
 
     g_object_get (object, "is-recording", &priv->is_recording, NULL);
     g_object_get (object, "is-readout", &priv->is_readout, NULL);
+
+    cache_property (object, camera_properties[PROP_TRIGGER_SOURCE]);
+    cache_property (object, camera_properties[PROP_ROI_X]);
+    cache_property (object, camera_properties[PROP_ROI_Y]);
+    cache_property (object, camera_properties[PROP_ROI_WIDTH]);
+    cache_property (object, camera_properties[PROP_ROI_HEIGHT]);
+    cache_property (object, camera_properties[PROP_SENSOR_BITDEPTH]);
+    cache_property (object, camera_properties[PROP_PIXEL_FORMAT]);
 }
 
 static void
@@ -407,12 +1056,15 @@ uca_camera_class_init (UcaCameraClass *klass)
     gobject_class->dispose = uca_camera_dispose;
     gobject_class->finalize = uca_camera_finalize;
     gobject_class->constructed = uca_camera_constructed;
+    gobject_class->dispatch_properties_changed = uca_camera_dispatch_properties_changed;
 
     klass->start_recording = NULL;
     klass->stop_recording = NULL;
     klass->grab = NULL;
+    klass->grab_full = NULL;
     klass->readout = NULL;
     klass->write = NULL;
+    klass->apply_properties = NULL;
 
     camera_properties[PROP_NAME] =
         g_param_spec_string("name",
@@ -609,658 +1261,4198 @@ uca_camera_class_init (UcaCameraClass *klass)
             0, 3, 0,
             G_PARAM_READWRITE);
 
+    /**
+     * UcaCamera:apply-transform:
+     *
+     * Apply #UcaCamera:mirror and #UcaCamera:rotate to frames grabbed while
+     * recording. Frames are mirrored horizontally first and then rotated
+     * clockwise, so an odd number of rotations swaps the width and height of
+     * the frame. Borrowed frames and frames passed to the grab callback are not
+     * transformed.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_APPLY_TRANSFORM] =
+        g_param_spec_boolean(uca_camera_props[PROP_APPLY_TRANSFORM],
+            "Apply mirror and rotate to grabbed frames",
+            "Apply mirror and rotate to grabbed frames",
+            FALSE, G_PARAM_READWRITE);
 
-    for (guint id = PROP_0 + 1; id < N_BASE_PROPERTIES; id++)
-        g_object_class_install_property(gobject_class, id, camera_properties[id]);
-
-    g_type_class_add_private(klass, sizeof(UcaCameraPrivate));
-}
+    /**
+     * UcaCamera:pixel-format:
+     *
+     * Memory layout of grabbed frames. Packed formats are kept packed in the
+     * ring buffer, so frames need less memory and bandwidth, see
+     * uca_camera_get_frame_size(). Plugins that cannot pack frames only
+     * support the unpacked format matching #UcaCamera:sensor-bitdepth.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_PIXEL_FORMAT] =
+        g_param_spec_enum(uca_camera_props[PROP_PIXEL_FORMAT],
+            "Pixel format",
+            "Memory layout of grabbed frames",
+            UCA_TYPE_CAMERA_PIXEL_FORMAT, UCA_CAMERA_PIXEL_FORMAT_MONO16,
+            G_PARAM_READWRITE);
 
-static void
-uca_camera_init (UcaCamera *camera)
-{
-    GValue val = {0};
+    /**
+     * UcaCamera:software-horizontal-binning:
+     *
+     * Number of pixels that libuca sums horizontally before frames are stored.
+     * Unlike #UcaCamera:sensor-horizontal-binning this works with every
+     * camera but the full frame is still transferred from the device.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_SOFTWARE_HORIZONTAL_BINNING] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_HORIZONTAL_BINNING],
+            "Horizontal software binning",
+            "Number of pixels combined to one pixel in horizontal direction after readout",
+            1, 64, 1,
+            G_PARAM_READWRITE);
 
-    camera->grab_func = NULL;
+    /**
+     * UcaCamera:software-vertical-binning:
+     *
+     * Vertical counterpart of #UcaCamera:software-horizontal-binning.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_SOFTWARE_VERTICAL_BINNING] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_VERTICAL_BINNING],
+            "Vertical software binning",
+            "Number of pixels combined to one pixel in vertical direction after readout",
+            1, 64, 1,
+            G_PARAM_READWRITE);
 
-    camera->priv = UCA_CAMERA_GET_PRIVATE(camera);
-    camera->priv->cancelling_recording = FALSE;
-    camera->priv->cancelling_grab = FALSE;
-    camera->priv->is_recording = FALSE;
-    camera->priv->is_readout = FALSE;
-    camera->priv->transfer_async = FALSE;
-    camera->priv->trigger_source = UCA_CAMERA_TRIGGER_SOURCE_AUTO;
-    camera->priv->trigger_type = UCA_CAMERA_TRIGGER_TYPE_EDGE;
-    camera->priv->buffered = FALSE;
-    camera->priv->num_buffers = 4;
-    camera->priv->ring_buffer = NULL;
+    /**
+     * UcaCamera:software-binning-mode:
+     *
+     * Whether software binning saturates or widens the pixels.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_SOFTWARE_BINNING_MODE] =
+        g_param_spec_enum(uca_camera_props[PROP_SOFTWARE_BINNING_MODE],
+            "Software binning mode",
+            "How software binning treats sums that exceed the pixel range",
+            UCA_TYPE_CAMERA_BINNING_MODE, UCA_CAMERA_BINNING_MODE_SATURATE,
+            G_PARAM_READWRITE);
 
-    g_value_init (&val, G_TYPE_UINT);
-    g_value_set_uint (&val, 1);
+    /**
+     * UcaCamera:software-roi-x0:
+     *
+     * Left edge of the region that is cut from the frames delivered by the
+     * camera before they are binned and stored. The region is relative to the
+     * hardware region of interest.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_SOFTWARE_ROI_X] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_ROI_X],
+            "Horizontal software ROI origin",
+            "Left edge of the region cut from grabbed frames",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
 
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_WIDTH], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_HEIGHT], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_PIXEL_WIDTH], UCA_UNIT_METER);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_PIXEL_HEIGHT], UCA_UNIT_METER);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_BITDEPTH], UCA_UNIT_COUNT);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_HORIZONTAL_BINNING], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_VERTICAL_BINNING], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_EXPOSURE_TIME], UCA_UNIT_SECOND);
-    uca_camera_set_property_unit (camera_properties[PROP_FRAMES_PER_SECOND], UCA_UNIT_COUNT);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_X], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_Y], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_WIDTH], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_HEIGHT], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_WIDTH_MULTIPLIER], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_ROI_HEIGHT_MULTIPLIER], UCA_UNIT_PIXEL);
-    uca_camera_set_property_unit (camera_properties[PROP_RECORDED_FRAMES], UCA_UNIT_COUNT);
+    camera_properties[PROP_SOFTWARE_ROI_Y] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_ROI_Y],
+            "Vertical software ROI origin",
+            "Top edge of the region cut from grabbed frames",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
 
-#ifdef WITH_PYTHON_MULTITHREADING
-    g_log (G_LOG_LEVEL_DOMAIN, G_LOG_LEVEL_DEBUG, "Camera initialized with Python support");
+    /**
+     * UcaCamera:software-roi-width:
+     *
+     * Width of the region cut from grabbed frames or 0 to keep everything
+     * right of #UcaCamera:software-roi-x0.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_SOFTWARE_ROI_WIDTH] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_ROI_WIDTH],
+            "Software ROI width",
+            "Width of the region cut from grabbed frames, 0 for the rest of the frame",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_SOFTWARE_ROI_HEIGHT] =
+        g_param_spec_uint(uca_camera_props[PROP_SOFTWARE_ROI_HEIGHT],
+            "Software ROI height",
+            "Height of the region cut from grabbed frames, 0 for the rest of the frame",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    /**
+     * UcaCamera:filter-workers:
+     *
+     * Number of threads that run the filters added with
+     * uca_camera_add_filter() in buffered mode, 0 for one per processor.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_FILTER_WORKERS] =
+        g_param_spec_uint(uca_camera_props[PROP_FILTER_WORKERS],
+            "Number of filter threads",
+            "Number of threads processing frames in buffered mode, 0 for one per processor",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    /**
+     * UcaCamera:accumulate-frames:
+     *
+     * Number of consecutive frames summed into every stored frame, 1 to store
+     * every frame. The sums are stored according to #UcaCamera:accumulate-mode
+     * and #UcaFrameInfo.n_accumulated tells how many frames contributed. The
+     * limit keeps sums of 16-bit pixels within 32 bits.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_ACCUMULATE_FRAMES] =
+        g_param_spec_uint(uca_camera_props[PROP_ACCUMULATE_FRAMES],
+            "Number of accumulated frames",
+            "Number of consecutive frames summed into every stored frame",
+            1, 65536, 1,
+            G_PARAM_READWRITE);
+
+    /**
+     * UcaCamera:accumulate-mode:
+     *
+     * Whether accumulated frames are stored as mean or as 32-bit sums.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_ACCUMULATE_MODE] =
+        g_param_spec_enum(uca_camera_props[PROP_ACCUMULATE_MODE],
+            "Accumulation mode",
+            "Store the mean or the sum of accumulated frames",
+            UCA_TYPE_CAMERA_ACCUMULATE_MODE, UCA_CAMERA_ACCUMULATE_MODE_MEAN,
+            G_PARAM_READWRITE);
+
+    /**
+     * UcaCamera:statistics:
+     *
+     * Compute the statistics of every stored frame once, after all filters
+     * ran, and hand them out in #UcaFrameInfo.statistics. In buffered mode,
+     * the statistics are computed on #UcaCamera:filter-workers threads.
+     * Changes take effect with the next recording.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_STATISTICS] =
+        g_param_spec_boolean(uca_camera_props[PROP_STATISTICS],
+            "Compute frame statistics",
+            "Compute minimum, maximum, sums and histogram of every stored frame",
+            FALSE,
+            G_PARAM_READWRITE);
+
+    /**
+     * UcaCamera:statistics-step:
+     *
+     * Distance between the pixels from which #UcaCamera:statistics are
+     * computed in both directions, 1 to use every pixel.
+     *
+     * Since: 2.5
+     */
+    camera_properties[PROP_STATISTICS_STEP] =
+        g_param_spec_uint(uca_camera_props[PROP_STATISTICS_STEP],
+            "Statistics step",
+            "Use every n-th pixel of every n-th row for the statistics",
+            1, G_MAXUINT, 1,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_RING_POLICY] =
+        g_param_spec_enum(uca_camera_props[PROP_RING_POLICY],
+            "Ring buffer policy",
+            "What to do with new frames if the ring buffer is full",
+            UCA_TYPE_CAMERA_RING_POLICY, UCA_CAMERA_RING_POLICY_DROP_OLDEST,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_DROPPED_FRAMES] =
+        g_param_spec_uint64(uca_camera_props[PROP_DROPPED_FRAMES],
+            "Number of dropped frames",
+            "Number of frames dropped by the ring buffer since recording started",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_ASYNC_WORKERS] =
+        g_param_spec_uint(uca_camera_props[PROP_ASYNC_WORKERS],
+            "Number of threads calling the grab function",
+            "Number of threads calling the grab function in asynchronous mode, 0 calls it from the acquisition thread",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_ASYNC_PRESERVE_ORDER] =
+        g_param_spec_boolean(uca_camera_props[PROP_ASYNC_PRESERVE_ORDER],
+            "Call the grab function in frame order",
+            "Call the grab function in frame order even with more than one worker",
+            FALSE, G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_ALIGNMENT] =
+        g_param_spec_uint(uca_camera_props[PROP_BUFFER_ALIGNMENT],
+            "Alignment of the ring buffer in bytes",
+            "Alignment of the ring buffer in bytes, 0 for the default",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_HUGE_PAGES] =
+        g_param_spec_boolean(uca_camera_props[PROP_BUFFER_HUGE_PAGES],
+            "Back the ring buffer with huge pages",
+            "Back the ring buffer with huge pages",
+            FALSE, G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_LOCK_MEMORY] =
+        g_param_spec_boolean(uca_camera_props[PROP_BUFFER_LOCK_MEMORY],
+            "Lock the ring buffer in memory",
+            "Lock the ring buffer in memory",
+            FALSE, G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_PREFAULT] =
+        g_param_spec_boolean(uca_camera_props[PROP_BUFFER_PREFAULT],
+            "Fault in ring buffer pages before recording",
+            "Fault in ring buffer pages before recording",
+            FALSE, G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_NUMA_NODE] =
+        g_param_spec_int(uca_camera_props[PROP_BUFFER_NUMA_NODE],
+            "NUMA node of the ring buffer",
+            "NUMA node of the ring buffer, -1 for no preference",
+            -1, G_MAXINT, -1,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_FILE] =
+        g_param_spec_string(uca_camera_props[PROP_BUFFER_FILE],
+            "File backing the ring buffer",
+            "File that is mapped to store the ring buffer, NULL for memory",
+            NULL, G_PARAM_READWRITE);
+
+    camera_properties[PROP_SPILL_DIRECTORY] =
+        g_param_spec_string(uca_camera_props[PROP_SPILL_DIRECTORY],
+            "Directory for spilled frames",
+            "Directory of the scratch file used by the spill ring policy, NULL for the temporary directory",
+            NULL, G_PARAM_READWRITE);
+
+    camera_properties[PROP_MAX_BUFFER_MEMORY] =
+        g_param_spec_uint64(uca_camera_props[PROP_MAX_BUFFER_MEMORY],
+            "Memory budget of the ring buffer in bytes",
+            "Memory the ring buffer may grow to if the consumer lags behind, 0 for a fixed size",
+            0, G_MAXUINT64, 0,
+            G_PARAM_READWRITE);
+
+    camera_properties[PROP_BUFFER_CAPACITY] =
+        g_param_spec_uint(uca_camera_props[PROP_BUFFER_CAPACITY],
+            "Current capacity of the ring buffer",
+            "Number of frames the ring buffer of the current recording can hold",
+            0, G_MAXUINT, 0,
+            G_PARAM_READABLE);
+
+    camera_properties[PROP_BUFFER_PEAK_FILL] =
+        g_param_spec_uint(uca_camera_props[PROP_BUFFER_PEAK_FILL],
+            "Peak fill level of the ring buffer",
+            "Largest number of frames held by the ring buffer since recording started",
+            0, G_MAXUINT, 0,
+            G_PARAM_READABLE);
+
+    for (guint id = PROP_0 + 1; id < N_BASE_PROPERTIES; id++)
+        g_object_class_install_property(gobject_class, id, camera_properties[id]);
+
+    g_type_class_add_private(klass, sizeof(UcaCameraPrivate));
+}
+
+static void
+uca_camera_init (UcaCamera *camera)
+{
+    GValue val = {0};
+
+    camera->grab_func = NULL;
+
+    camera->priv = UCA_CAMERA_GET_PRIVATE(camera);
+    camera->priv->cancelling_recording = FALSE;
+    camera->priv->cancelling_grab = FALSE;
+    camera->priv->is_recording = FALSE;
+    camera->priv->is_readout = FALSE;
+    camera->priv->transfer_async = FALSE;
+    camera->priv->trigger_source = UCA_CAMERA_TRIGGER_SOURCE_AUTO;
+    camera->priv->trigger_type = UCA_CAMERA_TRIGGER_TYPE_EDGE;
+    camera->priv->buffered = FALSE;
+    camera->priv->num_buffers = 4;
+    camera->priv->ring_buffer = NULL;
+    camera->priv->spare_ring_buffer = NULL;
+    camera->priv->consumers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    camera->priv->frame_fd = -1;
+    camera->priv->frame_fd_write = -1;
+    camera->priv->frame_fd_signalled = FALSE;
+    camera->priv->frames_pending = FALSE;
+    g_queue_init (&camera->priv->borrowed_frames);
+    g_queue_init (&camera->priv->released_frames);
+    camera->priv->n_copying = 0;
+    camera->priv->grab_cancellable = g_cancellable_new ();
+    camera->priv->grab_end_time = -1;
+    camera->priv->cached_trigger_source = UCA_CAMERA_TRIGGER_SOURCE_AUTO;
+    camera->priv->cached_roi_x = 0;
+    camera->priv->cached_roi_y = 0;
+    camera->priv->cached_roi_width = 0;
+    camera->priv->cached_roi_height = 0;
+    camera->priv->cached_bitdepth = 0;
+    camera->priv->cached_pixel_format = UCA_CAMERA_PIXEL_FORMAT_MONO16;
+    camera->priv->ring_policy = UCA_CAMERA_RING_POLICY_DROP_OLDEST;
+    camera->priv->dropped_frames = 0;
+    camera->priv->drop_buffer = NULL;
+    camera->priv->async_workers = 0;
+    camera->priv->async_preserve_order = FALSE;
+    camera->priv->async_pool = NULL;
+    camera->priv->buffer_alignment = 0;
+    camera->priv->buffer_huge_pages = FALSE;
+    camera->priv->buffer_lock_memory = FALSE;
+    camera->priv->buffer_prefault = FALSE;
+    camera->priv->buffer_numa_node = -1;
+    camera->priv->buffer_file = NULL;
+    camera->priv->spill_queue = NULL;
+    camera->priv->spill_directory = NULL;
+    camera->priv->max_buffer_memory = 0;
+    camera->priv->peak_buffer_fill = 0;
+    camera->priv->software_horizontal_binning = 1;
+    camera->priv->software_vertical_binning = 1;
+    camera->priv->software_binning_mode = UCA_CAMERA_BINNING_MODE_SATURATE;
+    camera->priv->software_roi_x = 0;
+    camera->priv->software_roi_y = 0;
+    camera->priv->software_roi_width = 0;
+    camera->priv->software_roi_height = 0;
+    camera->priv->bin = FALSE;
+    camera->priv->bin_buffer = NULL;
+    camera->priv->bin_buffer_size = 0;
+    camera->priv->filters = g_ptr_array_new_with_free_func (g_object_unref);
+    camera->priv->filter_workers = 0;
+    camera->priv->filter_chain = NULL;
+    camera->priv->pipeline = NULL;
+    camera->priv->accumulate_frames = 1;
+    camera->priv->accumulate_mode = UCA_CAMERA_ACCUMULATE_MODE_MEAN;
+    camera->priv->accumulation = NULL;
+    camera->priv->statistics = FALSE;
+    camera->priv->statistics_step = 1;
+    camera->priv->stats = FALSE;
+
+    g_mutex_init (&camera->priv->control_lock);
+    g_mutex_init (&camera->priv->grab_lock);
+    g_mutex_init (&camera->priv->trigger_lock);
+    g_mutex_init (&camera->priv->device_lock);
+    g_mutex_init (&camera->priv->buffer_lock);
+    g_cond_init (&camera->priv->buffer_cond);
+    camera->priv->n_buffer_waiters = 0;
+
+    g_value_init (&val, G_TYPE_UINT);
+    g_value_set_uint (&val, 1);
+
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_WIDTH], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_HEIGHT], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_PIXEL_WIDTH], UCA_UNIT_METER);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_PIXEL_HEIGHT], UCA_UNIT_METER);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_BITDEPTH], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_HORIZONTAL_BINNING], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SENSOR_VERTICAL_BINNING], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_EXPOSURE_TIME], UCA_UNIT_SECOND);
+    uca_camera_set_property_unit (camera_properties[PROP_FRAMES_PER_SECOND], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_X], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_Y], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_WIDTH], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_HEIGHT], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_HORIZONTAL_BINNING], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_VERTICAL_BINNING], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_ROI_X], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_ROI_Y], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_ROI_WIDTH], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_SOFTWARE_ROI_HEIGHT], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_WIDTH_MULTIPLIER], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_ROI_HEIGHT_MULTIPLIER], UCA_UNIT_PIXEL);
+    uca_camera_set_property_unit (camera_properties[PROP_RECORDED_FRAMES], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_DROPPED_FRAMES], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_ASYNC_WORKERS], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_FILTER_WORKERS], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_ACCUMULATE_FRAMES], UCA_UNIT_COUNT);
+    uca_camera_set_property_unit (camera_properties[PROP_STATISTICS_STEP], UCA_UNIT_PIXEL);
+
+#ifdef WITH_PYTHON_MULTITHREADING
+    g_log (G_LOG_LEVEL_DOMAIN, G_LOG_LEVEL_DEBUG, "Camera initialized with Python support");
+#endif
+}
+
+/*
+ * Wake up threads sleeping on buffer_cond. The waiter count is read with a full
+ * barrier after the state change has been published, so we only pay for the
+ * lock if somebody is actually waiting.
+ */
+static void
+wake_buffer_waiters (UcaCameraPrivate *priv)
+{
+    if (g_atomic_int_get (&priv->n_buffer_waiters) > 0) {
+        g_mutex_lock (&priv->buffer_lock);
+        g_cond_broadcast (&priv->buffer_cond);
+        g_mutex_unlock (&priv->buffer_lock);
+    }
+}
+
+/*
+ * Make the descriptor returned by uca_camera_get_fd() readable unless it is
+ * already, so that we make at most one system call per burst of frames.
+ */
+static void
+signal_frame_fd (UcaCameraPrivate *priv)
+{
+#ifdef G_OS_UNIX
+    gint fd;
+
+    fd = g_atomic_int_get (&priv->frame_fd_write);
+
+    if (fd >= 0 && g_atomic_int_compare_and_exchange (&priv->frame_fd_signalled, FALSE, TRUE)) {
+        guint64 one = 1;
+
+        if (write (fd, &one, sizeof (one)) != sizeof (one))
+            g_warning ("Could not signal frame descriptor: %s", g_strerror (errno));
+    }
+#endif
+}
+
+/*
+ * Announce new frames in the ring buffer or the spill queue to readers that
+ * spin, sleep on buffer_cond or poll the frame descriptor.
+ */
+static void
+publish_frames (UcaCameraPrivate *priv)
+{
+    g_atomic_int_set (&priv->frames_pending, TRUE);
+    signal_frame_fd (priv);
+    wake_buffer_waiters (priv);
+}
+
+static void
+cancel_buffered_grab (UcaCameraPrivate *priv)
+{
+    g_mutex_lock (&priv->buffer_lock);
+    priv->cancelling_grab = TRUE;
+    g_cond_broadcast (&priv->buffer_cond);
+    g_mutex_unlock (&priv->buffer_lock);
+}
+
+static void
+chain_cancel (GCancellable *cancellable, GCancellable *target)
+{
+    g_cancellable_cancel (target);
+}
+
+/*
+ * Arm the cancellable that the plugin sees during an unbuffered grab and chain
+ * it to the caller's @cancellable. Must be called with device_lock held.
+ */
+static gulong
+begin_device_grab (UcaCameraPrivate *priv, GCancellable *cancellable, gint64 end_time)
+{
+    g_cancellable_reset (priv->grab_cancellable);
+    priv->grab_end_time = end_time;
+
+    /* uca_camera_stop_recording() may have cancelled before the reset */
+    if (priv->cancelling_recording)
+        g_cancellable_cancel (priv->grab_cancellable);
+
+    if (cancellable == NULL)
+        return 0;
+
+    return g_cancellable_connect (cancellable, G_CALLBACK (chain_cancel), priv->grab_cancellable, NULL);
+}
+
+static void
+end_device_grab (UcaCameraPrivate *priv, GCancellable *cancellable, gulong handler)
+{
+    if (cancellable != NULL)
+        g_cancellable_disconnect (cancellable, handler);
+
+    priv->grab_end_time = -1;
+}
+
+/*
+ * Compute the software binning stage for the current properties. Returns
+ * %FALSE if frames are stored as the plugin delivers them, which is always the
+ * case for packed pixel formats. The region may not fit into the frame, which
+ * begin_binning() checks.
+ */
+static gboolean
+get_binning (UcaCamera *camera, Binning *binning)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    UcaCameraPixelFormat format;
+    guint width, height;
+
+    if (priv->software_horizontal_binning == 1 && priv->software_vertical_binning == 1 &&
+        priv->software_roi_x == 0 && priv->software_roi_y == 0 &&
+        priv->software_roi_width == 0 && priv->software_roi_height == 0)
+        return FALSE;
+
+    format = uca_camera_get_pixel_format (camera);
+
+    if (format != UCA_CAMERA_PIXEL_FORMAT_MONO8 && format != UCA_CAMERA_PIXEL_FORMAT_MONO16)
+        return FALSE;
+
+    uca_camera_get_roi (camera, NULL, NULL, &binning->src_width, &binning->src_height);
+    binning->src_pixel_size = format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+    binning->x = priv->software_roi_x;
+    binning->y = priv->software_roi_y;
+    binning->horizontal = priv->software_horizontal_binning;
+    binning->vertical = priv->software_vertical_binning;
+    binning->widen = priv->software_binning_mode == UCA_CAMERA_BINNING_MODE_WIDEN;
+
+    width = priv->software_roi_width;
+    height = priv->software_roi_height;
+
+    if (width == 0)
+        width = binning->src_width > binning->x ? binning->src_width - binning->x : 0;
+
+    if (height == 0)
+        height = binning->src_height > binning->y ? binning->src_height - binning->y : 0;
+
+    /* Incomplete blocks at the right and bottom edge are discarded */
+    binning->width = width / binning->horizontal;
+    binning->height = height / binning->vertical;
+
+    return TRUE;
+}
+
+/*
+ * Geometry of the frames after binning, which are summed if frames are
+ * accumulated.
+ */
+static void
+get_binned_geometry (UcaCamera *camera, guint *width, guint *height, UcaCameraPixelFormat *format)
+{
+    Binning binning;
+
+    if (get_binning (camera, &binning)) {
+        if (width != NULL)
+            *width = binning.width;
+
+        if (height != NULL)
+            *height = binning.height;
+
+        if (format != NULL) {
+            *format = binning.src_pixel_size == 1 && !binning.widen ?
+                UCA_CAMERA_PIXEL_FORMAT_MONO8 : UCA_CAMERA_PIXEL_FORMAT_MONO16;
+        }
+    }
+    else {
+        uca_camera_get_roi (camera, NULL, NULL, width, height);
+
+        if (format != NULL)
+            *format = uca_camera_get_pixel_format (camera);
+    }
+}
+
+static void
+bin_frame (const Binning *binning, gconstpointer src, gpointer dst)
+{
+    const guint8 *origin;
+    gsize stride;
+
+    stride = (gsize) binning->src_width * binning->src_pixel_size;
+    origin = (const guint8 *) src + binning->y * stride + binning->x * binning->src_pixel_size;
+
+    if (binning->horizontal == 1 && binning->vertical == 1 && !binning->widen) {
+        gsize row_size = (gsize) binning->width * binning->src_pixel_size;
+
+        for (guint y = 0; y < binning->height; y++)
+            memcpy ((guint8 *) dst + y * row_size, origin + y * stride, row_size);
+    }
+    else {
+        uca_transform_bin (origin, stride, dst, binning->width, binning->height,
+                           binning->horizontal, binning->vertical,
+                           binning->src_pixel_size, binning->widen);
+    }
+}
+
+/*
+ * Run all filters of @chain on a frame. A filter that fails leaves the frame
+ * to the next one, we do not lose frames because of processing errors.
+ */
+static void
+filter_frame (const FilterChain *chain, gpointer data)
+{
+    if (chain == NULL)
+        return;
+
+    for (guint i = 0; i < chain->filters->len; i++) {
+        GError *error = NULL;
+
+        if (!uca_filter_process (g_ptr_array_index (chain->filters, i), data,
+                                 chain->width, chain->height, chain->pixel_size, &error)) {
+            g_warning ("Could not filter frame: %s", error != NULL ? error->message : "unknown error");
+            g_clear_error (&error);
+        }
+    }
+}
+
+/*
+ * Attach the statistics of a stored frame to @info. Frames are analysed after
+ * the filters, so the statistics describe what consumers get.
+ */
+static void
+analyse_frame (UcaCameraPrivate *priv, gconstpointer data, UcaFrameInfo *info)
+{
+    if (!priv->stats)
+        return;
+
+    uca_transform_statistics (data, priv->stats_width, priv->stats_height, priv->stats_pixel_size,
+                              priv->stats_bits, priv->stats_step, &info->statistics);
+    info->has_statistics = TRUE;
+}
+
+static Accumulation *
+accumulation_new (guint n_frames, gboolean mean, gsize n_pixels, guint pixel_size)
+{
+    Accumulation *accumulation;
+
+    accumulation = g_new0 (Accumulation, 1);
+    accumulation->n_frames = n_frames;
+    accumulation->mean = mean;
+    accumulation->n_pixels = n_pixels;
+    accumulation->pixel_size = pixel_size;
+    accumulation->frame = g_malloc (n_pixels * pixel_size);
+    accumulation->sums = g_new (guint32, n_pixels);
+    return accumulation;
+}
+
+static void
+accumulation_free (Accumulation *accumulation)
+{
+    if (accumulation == NULL)
+        return;
+
+    g_free (accumulation->frame);
+    g_free (accumulation->sums);
+    g_free (accumulation);
+}
+
+/*
+ * Add a stored frame to the sums. Returns %TRUE once the sums are complete.
+ */
+static gboolean
+accumulation_add (Accumulation *accumulation, gconstpointer frame, const UcaFrameInfo *info)
+{
+    if (accumulation->n_summed == 0) {
+        memset (accumulation->sums, 0, accumulation->n_pixels * sizeof (guint32));
+
+        if (info != NULL)
+            accumulation->info = *info;
+    }
+
+    uca_transform_accumulate (frame, accumulation->sums, accumulation->n_pixels,
+                              accumulation->pixel_size);
+
+    /* The sum is complete when the last frame is */
+    if (info != NULL)
+        accumulation->info.capture_time = info->capture_time;
+
+    accumulation->n_summed++;
+    return accumulation->n_summed == accumulation->n_frames;
+}
+
+/*
+ * Store the sums or their mean in @data and start over. The division happens
+ * once per accumulated frame, so it is not worth vectorizing.
+ */
+static void
+accumulation_store (Accumulation *accumulation, gpointer data, UcaFrameInfo *info)
+{
+    const guint32 *sums = accumulation->sums;
+    guint32 n = accumulation->n_summed;
+
+    if (!accumulation->mean)
+        memcpy (data, sums, accumulation->n_pixels * sizeof (guint32));
+    else if (accumulation->pixel_size == 1) {
+        guint8 *pixels = data;
+
+        for (gsize i = 0; i < accumulation->n_pixels; i++)
+            pixels[i] = (guint8) ((sums[i] + n / 2) / n);
+    }
+    else {
+        guint16 *pixels = data;
+
+        for (gsize i = 0; i < accumulation->n_pixels; i++)
+            pixels[i] = (guint16) ((sums[i] + n / 2) / n);
+    }
+
+    if (info != NULL) {
+        *info = accumulation->info;
+        info->n_accumulated = n;
+    }
+
+    accumulation->n_summed = 0;
+}
+
+/*
+ * Grab a frame from the plugin and bin it. Binned frames are grabbed into
+ * bin_buffer first.
+ */
+static gboolean
+grab_stored_frame (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    gpointer frame;
+    gboolean result;
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+    priv = camera->priv;
+    frame = priv->bin ? priv->bin_buffer : data;
+    memset (info, 0, sizeof (UcaFrameInfo));
+
+    if (klass->grab_full != NULL)
+        result = (*klass->grab_full) (camera, frame, info, error);
+    else
+        result = (*klass->grab) (camera, frame, error);
+
+    if (result && priv->bin)
+        bin_frame (&priv->binning, frame, data);
+
+    /* Plugins that know better may set the capture time themselves */
+    if (result && info->capture_time == 0)
+        info->capture_time = g_get_monotonic_time ();
+
+    return result;
+}
+
+/*
+ * Sum frames until the accumulation is complete. If the plugin provides
+ * hardware counters, a frame beyond the window of the current sum means that
+ * the camera dropped frames. The incomplete sum is stored and the frame starts
+ * the next one, so that every stored frame covers the same time span.
+ */
+static gboolean
+grab_accumulated_frame (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    Accumulation *accumulation;
+    UcaFrameInfo frame_info;
+
+    accumulation = camera->priv->accumulation;
+
+    while (TRUE) {
+        if (!grab_stored_frame (camera, accumulation->frame, &frame_info, error))
+            return FALSE;
+
+        if (accumulation->n_summed > 0 && frame_info.has_hardware_counter &&
+            accumulation->info.has_hardware_counter &&
+            frame_info.hardware_counter - accumulation->info.hardware_counter >= accumulation->n_frames) {
+            accumulation_store (accumulation, data, info);
+            accumulation_add (accumulation, accumulation->frame, &frame_info);
+            return TRUE;
+        }
+
+        if (accumulation_add (accumulation, accumulation->frame, &frame_info)) {
+            accumulation_store (accumulation, data, info);
+            return TRUE;
+        }
+    }
+}
+
+/*
+ * Grab a stored frame and fill in @info. Only one thread at a time may call
+ * this, either the read thread or a consumer holding grab_lock.
+ */
+static gboolean
+grab_frame (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    UcaCameraPrivate *priv;
+    gboolean result;
+
+    priv = camera->priv;
+
+    if (priv->accumulation != NULL)
+        result = grab_accumulated_frame (camera, data, info, error);
+    else {
+        result = grab_stored_frame (camera, data, info, error);
+        info->n_accumulated = 1;
+    }
+
+    if (result)
+        info->sequence = priv->frame_sequence++;
+
+    return result;
+}
+
+static gpointer
+spill_queue_writer (SpillQueue *spill)
+{
+    GOutputStream *output;
+
+    output = g_io_stream_get_output_stream (G_IO_STREAM (spill->output));
+    g_mutex_lock (&spill->lock);
+
+    while (TRUE) {
+        guint8 *record;
+        guint64 index;
+        gboolean written;
+        GError *error = NULL;
+
+        while (g_queue_is_empty (&spill->pending) && !spill->stopping)
+            g_cond_wait (&spill->cond, &spill->lock);
+
+        /* Frames that have not been written yet would never be read anyway */
+        if (spill->stopping)
+            break;
+
+        record = g_queue_peek_head (&spill->pending);
+        index = spill->n_written;
+        g_mutex_unlock (&spill->lock);
+
+        written = g_seekable_seek (G_SEEKABLE (spill->output), (goffset) (index * spill->record_size),
+                                   G_SEEK_SET, NULL, &error) &&
+                  g_output_stream_write_all (output, record, spill->record_size, NULL, NULL, &error);
+
+        g_mutex_lock (&spill->lock);
+        g_queue_pop_head (&spill->pending);
+        g_queue_push_tail (&spill->free_buffers, record);
+
+        if (written) {
+            spill->n_written++;
+        }
+        else {
+            if (!spill->failed)
+                g_warning ("Could not spill frame: %s", error->message);
+
+            g_error_free (error);
+            spill->failed = TRUE;
+            spill->n_queued--;
+        }
+
+        g_mutex_unlock (&spill->lock);
+
+        if (written) {
+            publish_frames (spill->priv);
+        }
+        else {
+            g_mutex_lock (&spill->priv->buffer_lock);
+            spill->priv->dropped_frames++;
+            g_mutex_unlock (&spill->priv->buffer_lock);
+        }
+
+        g_mutex_lock (&spill->lock);
+    }
+
+    g_mutex_unlock (&spill->lock);
+    return NULL;
+}
+
+static SpillQueue *
+spill_queue_new (UcaCameraPrivate *priv, gsize frame_size, GError **error)
+{
+    SpillQueue *spill;
+    gchar *filename;
+    gint fd;
+
+    filename = g_build_filename (priv->spill_directory != NULL ? priv->spill_directory : g_get_tmp_dir (),
+                                 "uca-spill-XXXXXX", NULL);
+    fd = g_mkstemp (filename);
+
+    if (fd < 0) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_DEVICE,
+                     "Could not create spill file `%s': %s", filename, g_strerror (errno));
+        g_free (filename);
+        return NULL;
+    }
+
+    g_close (fd, NULL);
+
+    spill = g_new0 (SpillQueue, 1);
+    spill->priv = priv;
+    spill->file = g_file_new_for_path (filename);
+    g_free (filename);
+
+    /* Separate streams so that reading does not move the write position */
+    spill->output = g_file_open_readwrite (spill->file, NULL, error);
+    spill->input = spill->output != NULL ? g_file_read (spill->file, NULL, error) : NULL;
+
+    if (spill->input == NULL) {
+        g_file_delete (spill->file, NULL, NULL);
+        g_clear_object (&spill->output);
+        g_object_unref (spill->file);
+        g_free (spill);
+        return NULL;
+    }
+
+    /* Keep the UcaFrameInfo of every staging buffer aligned */
+    spill->record_size = (sizeof (UcaFrameInfo) + frame_size + 15) & ~((gsize) 15);
+    spill->memory = g_malloc_n (SPILL_STAGING_FRAMES, spill->record_size);
+
+    g_queue_init (&spill->free_buffers);
+    g_queue_init (&spill->pending);
+    g_queue_init (&spill->borrowed);
+
+    for (guint i = 0; i < SPILL_STAGING_FRAMES; i++)
+        g_queue_push_tail (&spill->free_buffers, spill->memory + i * spill->record_size);
+
+    g_mutex_init (&spill->lock);
+    g_mutex_init (&spill->read_lock);
+    g_cond_init (&spill->cond);
+    spill->thread = g_thread_new ("spill-writer", (GThreadFunc) spill_queue_writer, spill);
+
+    return spill;
+}
+
+/*
+ * Stop the writer and remove the scratch file. Must only be called once the
+ * read thread has been joined and no consumer reads anymore. Returns the
+ * number of spilled frames that were never read.
+ */
+static guint64
+spill_queue_free (SpillQueue *spill)
+{
+    guint64 n_unread;
+
+    g_mutex_lock (&spill->lock);
+    spill->stopping = TRUE;
+    g_cond_broadcast (&spill->cond);
+    g_mutex_unlock (&spill->lock);
+
+    /* Failed writes have been counted as dropped by the writer already */
+    g_thread_join (spill->thread);
+    n_unread = spill->n_queued - spill->n_read;
+
+    g_object_unref (spill->input);
+    g_object_unref (spill->output);
+    g_file_delete (spill->file, NULL, NULL);
+    g_object_unref (spill->file);
+
+    g_queue_clear (&spill->free_buffers);
+    g_queue_clear (&spill->pending);
+    g_queue_foreach (&spill->borrowed, (GFunc) g_free, NULL);
+    g_queue_clear (&spill->borrowed);
+    g_mutex_clear (&spill->lock);
+    g_mutex_clear (&spill->read_lock);
+    g_cond_clear (&spill->cond);
+    g_free (spill->memory);
+    g_free (spill);
+
+    return n_unread;
+}
+
+/*
+ * Called by the read thread before every frame. Returns %NULL if the frame
+ * goes into the ring buffer or a staging buffer for the writer otherwise. If
+ * the frame must be spilled but the writer lags behind, %NULL is returned and
+ * @drop is set.
+ */
+static guint8 *
+spill_queue_reserve (SpillQueue *spill, UcaRingBuffer *ring_buffer, gboolean *drop)
+{
+    guint8 *record = NULL;
+
+    *drop = FALSE;
+    g_mutex_lock (&spill->lock);
+
+    if (spill->n_queued == spill->n_read && spill->n_reading == 0) {
+        /* The file is drained and the writer idle, start over at the beginning */
+        spill->n_queued = spill->n_written = spill->n_read = 0;
+
+        if (!uca_ring_buffer_is_full (ring_buffer)) {
+            g_mutex_unlock (&spill->lock);
+            return NULL;
+        }
+    }
+
+    record = g_queue_pop_head (&spill->free_buffers);
+    *drop = record == NULL;
+    g_mutex_unlock (&spill->lock);
+
+    return record;
+}
+
+static void
+spill_queue_push (SpillQueue *spill, guint8 *record)
+{
+    g_mutex_lock (&spill->lock);
+    spill->n_queued++;
+    g_queue_push_tail (&spill->pending, record);
+    g_cond_broadcast (&spill->cond);
+    g_mutex_unlock (&spill->lock);
+}
+
+static void
+spill_queue_cancel (SpillQueue *spill, guint8 *record)
+{
+    g_mutex_lock (&spill->lock);
+    g_queue_push_tail (&spill->free_buffers, record);
+    g_mutex_unlock (&spill->lock);
+}
+
+/*
+ * TRUE if spilled frames can be read and the ring buffer has no older frames.
+ * Must be called with the spill lock held.
+ */
+static gboolean
+spill_queue_readable_unlocked (SpillQueue *spill, UcaRingBuffer *ring_buffer)
+{
+    return spill->n_written > spill->n_read && !uca_ring_buffer_available (ring_buffer);
+}
+
+static gboolean
+spill_queue_readable (SpillQueue *spill, UcaRingBuffer *ring_buffer)
+{
+    gboolean readable;
+
+    g_mutex_lock (&spill->lock);
+    readable = spill_queue_readable_unlocked (spill, ring_buffer);
+    g_mutex_unlock (&spill->lock);
+
+    return readable;
+}
+
+/*
+ * Claim the oldest spilled frame for spill_queue_read(). Returns %FALSE if the
+ * next frame must be taken from the ring buffer. Must be called with
+ * buffer_lock held.
+ */
+static gboolean
+spill_queue_claim (SpillQueue *spill, UcaRingBuffer *ring_buffer, guint64 *index)
+{
+    gboolean readable;
+
+    g_mutex_lock (&spill->lock);
+    readable = spill_queue_readable_unlocked (spill, ring_buffer);
+
+    if (readable) {
+        *index = spill->n_read++;
+        spill->n_reading++;
+    }
+
+    g_mutex_unlock (&spill->lock);
+    return readable;
+}
+
+/*
+ * Read the frame claimed at @index into a new buffer and return a pointer to
+ * the frame, preceded by its UcaFrameInfo. Must be called without buffer_lock,
+ * so that consumers and the read thread do not wait for the disk. The frame
+ * must be passed to spill_queue_borrow() afterwards.
+ */
+static gpointer
+spill_queue_read (SpillQueue *spill, guint64 index, GError **error)
+{
+    guint8 *record;
+    gboolean success;
+
+    record = g_malloc (spill->record_size);
+
+    g_mutex_lock (&spill->read_lock);
+    success = g_seekable_seek (G_SEEKABLE (spill->input), (goffset) (index * spill->record_size),
+                               G_SEEK_SET, NULL, error) &&
+              g_input_stream_read_all (G_INPUT_STREAM (spill->input), record, spill->record_size,
+                                       NULL, NULL, error);
+    g_mutex_unlock (&spill->read_lock);
+
+    /* The writer may reuse the file once the record has been read */
+    g_mutex_lock (&spill->lock);
+    spill->n_reading--;
+    g_mutex_unlock (&spill->lock);
+
+    if (!success) {
+        g_free (record);
+        return NULL;
+    }
+
+    return record + sizeof (UcaFrameInfo);
+}
+
+/*
+ * Track a frame returned by spill_queue_read() until it is released. Must be
+ * called with buffer_lock held.
+ */
+static void
+spill_queue_borrow (SpillQueue *spill, gpointer buffer)
+{
+    g_queue_push_tail (&spill->borrowed, (guint8 *) buffer - sizeof (UcaFrameInfo));
+}
+
+/*
+ * Return the metadata of @buffer if it was returned by spill_queue_read() or
+ * %NULL otherwise. Must be called with buffer_lock held.
+ */
+static UcaFrameInfo *
+spill_queue_get_info (SpillQueue *spill, gpointer buffer)
+{
+    guint8 *record;
+
+    record = (guint8 *) buffer - sizeof (UcaFrameInfo);
+    return g_queue_find (&spill->borrowed, record) != NULL ? (UcaFrameInfo *) record : NULL;
+}
+
+/*
+ * Free a frame returned by spill_queue_read(). Returns FALSE if @buffer was not
+ * read from the spill file. Must be called with buffer_lock held.
+ */
+static gboolean
+spill_queue_release (SpillQueue *spill, gpointer buffer)
+{
+    guint8 *record;
+
+    record = (guint8 *) buffer - sizeof (UcaFrameInfo);
+
+    if (!g_queue_remove (&spill->borrowed, record))
+        return FALSE;
+
+    g_free (record);
+    return TRUE;
+}
+
+/* The ring buffer grows once it is three quarters full */
+#define RING_HIGH_WATER(capacity)   ((capacity) - (capacity) / 4)
+
+/* and shrinks after it has been below that for this many microseconds */
+#define RING_SHRINK_DELAY           G_USEC_PER_SEC
+
+static gpointer
+pipeline_worker (Pipeline *pipeline)
+{
+    UcaCameraPrivate *priv = pipeline->priv;
+
+    g_mutex_lock (&pipeline->lock);
+
+    while (TRUE) {
+        PipelineJob *job;
+        guint n_published = 0;
+
+        while (pipeline->n_started == pipeline->n_submitted && !pipeline->stopping)
+            g_cond_wait (&pipeline->cond, &pipeline->lock);
+
+        /* Submitted frames are processed before we quit */
+        if (pipeline->n_started == pipeline->n_submitted)
+            break;
+
+        job = &pipeline->jobs[pipeline->n_started++ % pipeline->n_jobs];
+
+        g_mutex_unlock (&pipeline->lock);
+        filter_frame (pipeline->chain, job->data);
+        analyse_frame (priv, job->data, job->info);
+        g_mutex_lock (&pipeline->lock);
+
+        job->done = TRUE;
+
+        while (pipeline->n_published < pipeline->n_started) {
+            PipelineJob *oldest = &pipeline->jobs[pipeline->n_published % pipeline->n_jobs];
+
+            if (!oldest->done)
+                break;
+
+            oldest->done = FALSE;
+            uca_ring_buffer_write_advance (priv->ring_buffer);
+            pipeline->n_published++;
+            n_published++;
+        }
+
+        if (n_published > 0) {
+            guint fill;
+
+            fill = uca_ring_buffer_get_fill_level (priv->ring_buffer);
+
+            if (fill > priv->peak_buffer_fill)
+                g_atomic_int_set (&priv->peak_buffer_fill, fill);
+
+            g_cond_broadcast (&pipeline->cond);
+            g_mutex_unlock (&pipeline->lock);
+
+            publish_frames (priv);
+
+            g_mutex_lock (&pipeline->lock);
+        }
+    }
+
+    g_mutex_unlock (&pipeline->lock);
+    return NULL;
+}
+
+static Pipeline *
+pipeline_new (UcaCameraPrivate *priv, const FilterChain *chain)
+{
+    Pipeline *pipeline;
+
+    pipeline = g_new0 (Pipeline, 1);
+    pipeline->priv = priv;
+    pipeline->chain = chain;
+    pipeline->n_threads = priv->filter_workers > 0 ? priv->filter_workers : g_get_num_processors ();
+
+    /* Enough frames in flight to keep every worker busy while the oldest one finishes */
+    pipeline->n_jobs = 2 * pipeline->n_threads;
+    pipeline->jobs = g_new0 (PipelineJob, pipeline->n_jobs);
+
+    g_mutex_init (&pipeline->lock);
+    g_cond_init (&pipeline->cond);
+
+    pipeline->threads = g_new0 (GThread *, pipeline->n_threads);
+
+    for (guint i = 0; i < pipeline->n_threads; i++)
+        pipeline->threads[i] = g_thread_new ("filter-worker", (GThreadFunc) pipeline_worker, pipeline);
+
+    return pipeline;
+}
+
+/*
+ * Publish all submitted frames and stop the workers. Must only be called once
+ * the read thread does not submit frames anymore.
+ */
+static void
+pipeline_free (Pipeline *pipeline)
+{
+    g_mutex_lock (&pipeline->lock);
+    pipeline->stopping = TRUE;
+    g_cond_broadcast (&pipeline->cond);
+    g_mutex_unlock (&pipeline->lock);
+
+    for (guint i = 0; i < pipeline->n_threads; i++)
+        g_thread_join (pipeline->threads[i]);
+
+    g_mutex_clear (&pipeline->lock);
+    g_cond_clear (&pipeline->cond);
+    g_free (pipeline->threads);
+    g_free (pipeline->jobs);
+    g_free (pipeline);
+}
+
+/*
+ * Get the next free block behind the frames that are still being processed.
+ * Waits while all jobs are taken or the block is still unread. Returns %NULL
+ * only if the pipeline is empty and the ring buffer full, in which case the
+ * read thread applies the ring policy as without filters.
+ */
+static gpointer
+pipeline_claim (Pipeline *pipeline)
+{
+    gpointer buffer = NULL;
+
+    g_mutex_lock (&pipeline->lock);
+
+    while (TRUE) {
+        guint n_pending = (guint) (pipeline->n_submitted - pipeline->n_published);
+
+        if (n_pending < pipeline->n_jobs) {
+            buffer = uca_ring_buffer_get_write_pointer_ahead (pipeline->priv->ring_buffer, n_pending);
+
+            if (buffer != NULL || n_pending == 0)
+                break;
+        }
+
+        g_cond_wait (&pipeline->cond, &pipeline->lock);
+    }
+
+    g_mutex_unlock (&pipeline->lock);
+    return buffer;
+}
+
+static void
+pipeline_submit (Pipeline *pipeline, gpointer buffer, UcaFrameInfo *info)
+{
+    PipelineJob *job;
+
+    g_mutex_lock (&pipeline->lock);
+    job = &pipeline->jobs[pipeline->n_submitted++ % pipeline->n_jobs];
+    job->data = buffer;
+    job->info = info;
+    g_cond_broadcast (&pipeline->cond);
+    g_mutex_unlock (&pipeline->lock);
+}
+
+/*
+ * Wait until all submitted frames have been published.
+ */
+static void
+pipeline_drain (Pipeline *pipeline)
+{
+    g_mutex_lock (&pipeline->lock);
+
+    while (pipeline->n_published < pipeline->n_submitted)
+        g_cond_wait (&pipeline->cond, &pipeline->lock);
+
+    g_mutex_unlock (&pipeline->lock);
+}
+
+/*
+ * Grow the ring buffer by its initial size while it fills up and the memory
+ * budget permits, and shrink it back once it has been idle for a while. Called
+ * by the read thread between frames. Consumers access the ring buffer with
+ * buffer_lock held, which we need to take for resizing. Frames in the filter
+ * pipeline are published first, since they sit in blocks ahead of the write
+ * location.
+ */
+static void
+resize_ring_buffer (UcaCameraPrivate *priv)
+{
+    guint capacity;
+    guint fill;
+
+    capacity = uca_ring_buffer_get_capacity (priv->ring_buffer);
+    fill = uca_ring_buffer_get_fill_level (priv->ring_buffer);
+
+    if (fill >= RING_HIGH_WATER (capacity)) {
+        guint64 size;
+
+        priv->ring_busy_time = g_get_monotonic_time ();
+        size = (guint64) (capacity + priv->num_buffers) * uca_ring_buffer_get_block_size (priv->ring_buffer);
+
+        if (priv->ring_growable && size <= priv->max_buffer_memory) {
+            if (priv->pipeline != NULL)
+                pipeline_drain (priv->pipeline);
+
+            g_mutex_lock (&priv->buffer_lock);
+            priv->ring_growable = uca_ring_buffer_grow (priv->ring_buffer, priv->num_buffers);
+            g_mutex_unlock (&priv->buffer_lock);
+        }
+    }
+    else if (fill == 0 && capacity > priv->num_buffers &&
+             g_get_monotonic_time () - priv->ring_busy_time > RING_SHRINK_DELAY) {
+        if (priv->pipeline != NULL)
+            pipeline_drain (priv->pipeline);
+
+        g_mutex_lock (&priv->buffer_lock);
+        uca_ring_buffer_shrink (priv->ring_buffer);
+        g_mutex_unlock (&priv->buffer_lock);
+    }
+}
+
+/*
+ * Read a frame that has no place to go. We read it anyway so that the camera
+ * does not stall.
+ */
+static gboolean
+drop_frame (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv;
+    UcaFrameInfo dropped_info;
+
+    priv = camera->priv;
+
+    if (!grab_frame (camera, priv->drop_buffer, &dropped_info, error))
+        return FALSE;
+
+    g_mutex_lock (&priv->buffer_lock);
+    priv->dropped_frames++;
+    g_mutex_unlock (&priv->buffer_lock);
+    return TRUE;
+}
+
+static gpointer
+buffer_thread (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv;
+    GError *error = NULL;
+
+    priv = camera->priv;
+
+    while (!priv->cancelling_recording) {
+        gpointer buffer;
+        UcaFrameInfo *info;
+        guint fill;
+
+        if (priv->max_buffer_memory > 0)
+            resize_ring_buffer (priv);
+
+        if (priv->spill_queue != NULL) {
+            guint8 *record;
+            gboolean drop;
+
+            record = spill_queue_reserve (priv->spill_queue, priv->ring_buffer, &drop);
+
+            if (record != NULL) {
+                /* Consumers read spilled frames only after all older ones */
+                if (priv->pipeline != NULL)
+                    pipeline_drain (priv->pipeline);
+
+                if (!grab_frame (camera, record + sizeof (UcaFrameInfo), (UcaFrameInfo *) record, &error)) {
+                    spill_queue_cancel (priv->spill_queue, record);
+                    cancel_buffered_grab (priv);
+                    break;
+                }
+
+                filter_frame (priv->filter_chain, record + sizeof (UcaFrameInfo));
+                analyse_frame (priv, record + sizeof (UcaFrameInfo), (UcaFrameInfo *) record);
+                spill_queue_push (priv->spill_queue, record);
+                continue;
+            }
+
+            /* The writer cannot keep up with the camera */
+            if (drop) {
+                if (!drop_frame (camera, &error)) {
+                    cancel_buffered_grab (priv);
+                    break;
+                }
+
+                continue;
+            }
+        }
+
+        buffer = NULL;
+
+        if (priv->pipeline != NULL) {
+            buffer = pipeline_claim (priv->pipeline);
+
+            /* The ring buffer is full, let the spill queue take over */
+            if (buffer == NULL && priv->spill_queue != NULL)
+                continue;
+        }
+
+        if (buffer == NULL && priv->ring_policy != UCA_CAMERA_RING_POLICY_DROP_OLDEST &&
+            uca_ring_buffer_is_full (priv->ring_buffer)) {
+            if (priv->ring_policy == UCA_CAMERA_RING_POLICY_DROP_NEWEST) {
+                if (!drop_frame (camera, &error)) {
+                    cancel_buffered_grab (priv);
+                    break;
+                }
+
+                continue;
+            }
+
+            g_mutex_lock (&priv->buffer_lock);
+            g_atomic_int_inc (&priv->n_buffer_waiters);
+
+            while (uca_ring_buffer_is_full (priv->ring_buffer) && !priv->cancelling_recording)
+                g_cond_wait (&priv->buffer_cond, &priv->buffer_lock);
+
+            g_atomic_int_add (&priv->n_buffer_waiters, -1);
+            g_mutex_unlock (&priv->buffer_lock);
+            continue;
+        }
+
+        if (buffer == NULL)
+            buffer = uca_ring_buffer_get_write_pointer (priv->ring_buffer);
+
+        /* Never overwrite a block that a consumer has borrowed */
+        if (buffer == NULL) {
+            g_mutex_lock (&priv->buffer_lock);
+            g_atomic_int_inc (&priv->n_buffer_waiters);
+
+            while (!uca_ring_buffer_is_writable (priv->ring_buffer) && !priv->cancelling_recording)
+                g_cond_wait (&priv->buffer_cond, &priv->buffer_lock);
+
+            g_atomic_int_add (&priv->n_buffer_waiters, -1);
+            g_mutex_unlock (&priv->buffer_lock);
+            continue;
+        }
+
+        info = uca_ring_buffer_get_metadata (priv->ring_buffer, buffer);
+
+        if (!grab_frame (camera, buffer, info, &error)) {
+            cancel_buffered_grab (priv);
+            break;
+        }
+
+        /* The workers publish the frame once it has been filtered */
+        if (priv->pipeline != NULL) {
+            pipeline_submit (priv->pipeline, buffer, info);
+            continue;
+        }
+
+        uca_ring_buffer_write_advance (priv->ring_buffer);
+        publish_frames (priv);
+
+        fill = uca_ring_buffer_get_fill_level (priv->ring_buffer);
+
+        if (fill > priv->peak_buffer_fill)
+            g_atomic_int_set (&priv->peak_buffer_fill, fill);
+    }
+
+    return error;
+}
+
+static void
+async_pool_push (gpointer data, gpointer user_data)
+{
+    AsyncPool *pool = user_data;
+    Accumulation *accumulation = pool->accumulation;
+    guint8 *buffer;
+
+    /* Only complete sums are handed to the workers */
+    if (accumulation != NULL) {
+        gconstpointer frame = data;
+
+        if (pool->binning != NULL) {
+            bin_frame (pool->binning, data, accumulation->frame);
+            frame = accumulation->frame;
+        }
+
+        if (!accumulation_add (accumulation, frame, NULL))
+            return;
+    }
+
+    g_mutex_lock (&pool->lock);
+
+    while ((buffer = g_queue_pop_head (&pool->free_buffers)) == NULL) {
+        if (pool->policy == UCA_CAMERA_RING_POLICY_DROP_NEWEST) {
+            pool->n_dropped++;
+            g_mutex_unlock (&pool->lock);
+
+            /* The sums are dropped with the frame */
+            if (accumulation != NULL)
+                accumulation->n_summed = 0;
+
+            return;
+        }
+
+        if (pool->policy == UCA_CAMERA_RING_POLICY_DROP_OLDEST &&
+            (buffer = g_queue_pop_head (&pool->pending)) != NULL) {
+            pool->n_dropped++;
+            break;
+        }
+
+        /* All buffers are being processed by workers */
+        g_cond_wait (&pool->cond, &pool->lock);
+    }
+
+    g_mutex_unlock (&pool->lock);
+
+    if (accumulation != NULL)
+        accumulation_store (accumulation, buffer, NULL);
+    else if (pool->binning != NULL)
+        bin_frame (pool->binning, data, buffer);
+    else
+        memcpy (buffer, data, pool->frame_size);
+
+    g_mutex_lock (&pool->lock);
+    g_queue_push_tail (&pool->pending, buffer);
+    g_cond_broadcast (&pool->cond);
+    g_mutex_unlock (&pool->lock);
+}
+
+static gpointer
+async_pool_worker (AsyncPool *pool)
+{
+    g_mutex_lock (&pool->lock);
+
+    while (TRUE) {
+        guint8 *buffer;
+        guint64 ticket;
+
+        while (g_queue_is_empty (&pool->pending) && !pool->stopping)
+            g_cond_wait (&pool->cond, &pool->lock);
+
+        /* Pending frames are processed before we quit */
+        buffer = g_queue_pop_head (&pool->pending);
+
+        if (buffer == NULL)
+            break;
+
+        ticket = pool->next_ticket++;
+
+        /* Filter while earlier frames may still be in the callback */
+        if (pool->chain != NULL) {
+            g_mutex_unlock (&pool->lock);
+            filter_frame (pool->chain, buffer);
+            g_mutex_lock (&pool->lock);
+        }
+
+        while (pool->preserve_order && ticket != pool->next_callback)
+            g_cond_wait (&pool->cond, &pool->lock);
+
+        g_mutex_unlock (&pool->lock);
+        pool->func (buffer, pool->user_data);
+        g_mutex_lock (&pool->lock);
+
+        pool->next_callback++;
+        g_queue_push_tail (&pool->free_buffers, buffer);
+        g_cond_broadcast (&pool->cond);
+    }
+
+    g_mutex_unlock (&pool->lock);
+    return NULL;
+}
+
+static AsyncPool *
+async_pool_new (UcaCamera *camera, gsize frame_size)
+{
+    UcaCameraPrivate *priv;
+    AsyncPool *pool;
+    guint n_buffers;
+
+    priv = camera->priv;
+    pool = g_new0 (AsyncPool, 1);
+    pool->func = camera->grab_func;
+    pool->user_data = camera->user_data;
+    pool->policy = priv->ring_policy;
+    pool->preserve_order = priv->async_preserve_order;
+    pool->binning = priv->bin ? &priv->binning : NULL;
+    pool->chain = priv->filter_chain;
+    pool->accumulation = priv->accumulation;
+    pool->frame_size = frame_size;
+
+    /* Every worker needs a buffer to work on plus one to fill */
+    n_buffers = MAX (priv->num_buffers, priv->async_workers + 1);
+    pool->memory = g_malloc_n (n_buffers, frame_size);
+
+    g_queue_init (&pool->free_buffers);
+    g_queue_init (&pool->pending);
+
+    for (guint i = 0; i < n_buffers; i++)
+        g_queue_push_tail (&pool->free_buffers, pool->memory + i * frame_size);
+
+    g_mutex_init (&pool->lock);
+    g_cond_init (&pool->cond);
+
+    pool->n_threads = priv->async_workers;
+    pool->threads = g_new0 (GThread *, pool->n_threads);
+
+    for (guint i = 0; i < pool->n_threads; i++)
+        pool->threads[i] = g_thread_new ("async-worker", (GThreadFunc) async_pool_worker, pool);
+
+    /* Plugins now hand their frames to the pool */
+    camera->grab_func = async_pool_push;
+    camera->user_data = pool;
+
+    return pool;
+}
+
+/*
+ * Process all pending frames, stop the workers and restore the user's grab
+ * function. Must only be called once the plugin does not push frames anymore.
+ */
+static void
+async_pool_free (UcaCamera *camera, AsyncPool *pool)
+{
+    g_mutex_lock (&pool->lock);
+    pool->stopping = TRUE;
+    g_cond_broadcast (&pool->cond);
+    g_mutex_unlock (&pool->lock);
+
+    for (guint i = 0; i < pool->n_threads; i++)
+        g_thread_join (pool->threads[i]);
+
+    camera->grab_func = pool->func;
+    camera->user_data = pool->user_data;
+
+    g_queue_clear (&pool->free_buffers);
+    g_queue_clear (&pool->pending);
+    g_mutex_clear (&pool->lock);
+    g_cond_clear (&pool->cond);
+    g_free (pool->threads);
+    g_free (pool->memory);
+    g_free (pool);
+}
+
+static GEnumValue *
+find_enum_value (GParamSpecEnum *pspec, const gchar *name)
+{
+    GEnumValue *result;
+    GEnumClass *enum_class;
+
+    result = NULL;
+    enum_class = pspec->enum_class;
+
+    for (guint i = 0; i < enum_class->n_values; i++)
+        if (!g_strcmp0 (enum_class->values[i].value_name, name))
+            result = &enum_class->values[i];
+
+    return result;
+}
+
+static gboolean
+is_a_number (const gchar *s)
+{
+    g_return_val_if_fail (s != NULL, FALSE);
+
+    for (; *s != '\0'; s++) {
+        if (!g_ascii_isdigit (*s))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_camera_parse_arg_props:
+ * @camera: A #UcaCamera object
+ * @argv: Array of property assignment strings in the form of `prop=value`
+ * @argc: Length of @argv
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Parses the assignment array @argv and sets the property to the given value.
+ * If an error occures, @error is set and %FALSE is returned.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+uca_camera_parse_arg_props (UcaCamera *camera, gchar **argv, guint argc, GError **error)
+{
+    GRegex *assignment;
+
+    assignment = g_regex_new ("\\s*([A-Za-z0-9-]*)=(.*)\\s*", 0, 0, error);
+
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UCHAR,   value_transform_uchar);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_INT,     value_transform_int);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UINT,    value_transform_uint);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UINT64,  value_transform_uint64);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_LONG,    value_transform_long);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_ULONG,   value_transform_ulong);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_FLOAT,   value_transform_float);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_DOUBLE,  value_transform_double);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_BOOLEAN, value_transform_boolean);
+    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_ENUM,    value_transform_enum);
+
+    for (guint i = 0; i < argc; i++) {
+        GMatchInfo *match;
+        gboolean success = TRUE;
+
+        g_regex_match (assignment, argv[i], 0, &match);
+
+        if (g_match_info_matches (match)) {
+            GParamSpec *pspec;
+            GValue value = {0};
+
+            gchar *prop = g_match_info_fetch (match, 1);
+            gchar *string_value = g_match_info_fetch (match, 2);
+
+            pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (camera), prop);
+
+            if (pspec != NULL) {
+                GValue target_value = {0};
+
+                if (g_type_is_a (pspec->value_type, G_TYPE_ENUM)) {
+                    g_value_init (&value, G_TYPE_INT);
+
+                    if (!is_a_number (string_value)) {
+                        GEnumValue *enum_value;
+
+                        enum_value = find_enum_value ((GParamSpecEnum *) pspec, string_value);
+
+                        if (enum_value) {
+                            g_value_set_int (&value, enum_value->value);
+                        }
+                        else {
+                            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND,
+                                         "Enum value `%s' does not exist for `%s'",
+                                         string_value, prop);
+                            success = FALSE;
+                        }
+                    }
+                    else {
+                        g_value_set_int (&value, atoi (string_value));
+                    }
+                }
+                else {
+                    g_value_init (&value, G_TYPE_STRING);
+                    g_value_set_string (&value, string_value);
+                }
+
+                g_value_init (&target_value, pspec->value_type);
+                g_value_transform (&value, &target_value);
+                g_object_set_property (G_OBJECT (camera), prop, &target_value);
+                g_value_unset (&value);
+                g_value_unset (&target_value);
+            }
+            else {
+                g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                             "No property `%s' found", prop);
+                success = FALSE;
+            }
+
+            g_free (prop);
+            g_free (string_value);
+
+            if (!success) {
+                g_match_info_free (match);
+                g_regex_unref (assignment);
+                return FALSE;
+            }
+        }
+
+        g_match_info_free (match);
+    }
+
+    g_regex_unref (assignment);
+    return TRUE;
+}
+
+/*
+ * Convert @value to the type of @pspec and check that it is in range and can
+ * be written now. @target must be zero-initialized.
+ */
+static gboolean
+validate_property_value (UcaCamera *camera, GParamSpec *pspec, const GValue *value, GValue *target, GError **error)
+{
+    if (!(pspec->flags & G_PARAM_WRITABLE) || (pspec->flags & G_PARAM_CONSTRUCT_ONLY)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "Property `%s' is not writable", pspec->name);
+        return FALSE;
+    }
+
+    if (uca_camera_is_recording (camera) && !uca_camera_is_writable_during_acquisition (camera, pspec->name)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Property `%s' cannot be changed during acquisition", pspec->name);
+        return FALSE;
+    }
+
+    g_value_init (target, pspec->value_type);
+
+    if (!g_value_transform (value, target)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "Cannot convert `%s' to `%s' for property `%s'",
+                     G_VALUE_TYPE_NAME (value), g_type_name (pspec->value_type), pspec->name);
+        return FALSE;
+    }
+
+    if (g_param_value_validate (pspec, target)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "Value for property `%s' is out of range", pspec->name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_camera_apply_properties:
+ * @camera: A #UcaCamera object
+ * @properties: (element-type utf8 GValue): Table mapping property names to
+ *  #GValue pointers
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Set all properties in @properties as one update. Every value is checked
+ * before any of them is applied, so either all properties are changed or
+ * none. Plugins that implement #UcaCameraClass.apply_properties can send the
+ * whole configuration to the device at once, otherwise the properties are set
+ * one after another in no particular order. Property notifications are only
+ * emitted after all properties have been set.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.5
+ */
+gboolean
+uca_camera_apply_properties (UcaCamera *camera, GHashTable *properties, GError **error)
+{
+    UcaCameraClass *klass;
+    GHashTableIter iter;
+    GParamSpec **pspecs;
+    GValue *values;
+    gpointer key;
+    gpointer value;
+    guint n_properties = 0;
+    gboolean success = TRUE;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (properties != NULL, FALSE);
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+    pspecs = g_new0 (GParamSpec *, g_hash_table_size (properties));
+    values = g_new0 (GValue, g_hash_table_size (properties));
+
+    g_hash_table_iter_init (&iter, properties);
+
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        GParamSpec *pspec;
+
+        pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (camera), (const gchar *) key);
+
+        if (pspec == NULL) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND,
+                         "No property `%s' found", (const gchar *) key);
+            success = FALSE;
+            break;
+        }
+
+        if (!validate_property_value (camera, pspec, (const GValue *) value, &values[n_properties], error)) {
+            /* Unset the partially initialized value as well */
+            n_properties++;
+            success = FALSE;
+            break;
+        }
+
+        pspecs[n_properties++] = pspec;
+    }
+
+    if (success) {
+        g_object_freeze_notify (G_OBJECT (camera));
+
+        if (klass->apply_properties != NULL) {
+            success = klass->apply_properties (camera, n_properties, pspecs, values, error);
+
+            if (success) {
+                for (guint i = 0; i < n_properties; i++)
+                    g_object_notify_by_pspec (G_OBJECT (camera), pspecs[i]);
+            }
+        }
+        else {
+            for (guint i = 0; i < n_properties; i++)
+                g_object_set_property (G_OBJECT (camera), pspecs[i]->name, &values[i]);
+        }
+
+        g_object_thaw_notify (G_OBJECT (camera));
+    }
+
+    for (guint i = 0; i < n_properties; i++) {
+        if (G_IS_VALUE (&values[i]))
+            g_value_unset (&values[i]);
+    }
+
+    g_free (values);
+    g_free (pspecs);
+    return success;
+}
+
+/*
+ * Whether the default consumer can take a frame from the ring buffer or the
+ * spill queue. Must be called with buffer_lock held.
+ */
+static gboolean
+frame_available (UcaCameraPrivate *priv)
+{
+    return uca_ring_buffer_available (priv->ring_buffer) ||
+           (priv->spill_queue != NULL && spill_queue_readable (priv->spill_queue, priv->ring_buffer));
+}
+
+/*
+ * Make the frame descriptor unreadable once the default consumer has taken the
+ * last frame. Must be called with buffer_lock held.
+ */
+static void
+clear_frame_fd (UcaCameraPrivate *priv)
+{
+#ifdef G_OS_UNIX
+    guint8 buffer[64];
+
+    if (priv->frame_fd < 0 || !g_atomic_int_get (&priv->frame_fd_signalled))
+        return;
+
+    if (priv->ring_buffer != NULL && frame_available (priv))
+        return;
+
+    while (read (priv->frame_fd, buffer, sizeof (buffer)) > 0)
+        ;
+
+    g_atomic_int_set (&priv->frame_fd_signalled, FALSE);
+
+    /* The producer does not signal again if a frame arrived before the reset */
+    if (priv->ring_buffer != NULL && frame_available (priv))
+        signal_frame_fd (priv);
+#endif
+}
+
+/*
+ * Return the ring buffer of the previous recording if it has the requested
+ * geometry and allocation options, otherwise allocate a new one. Reusing the
+ * buffer saves allocating and faulting in the memory on every start.
+ */
+static UcaRingBuffer *
+get_ring_buffer (UcaCameraPrivate *priv, gsize block_size)
+{
+    UcaRingBuffer *buffer;
+
+    buffer = priv->spare_ring_buffer;
+    priv->spare_ring_buffer = NULL;
+
+    if (buffer != NULL) {
+        guint num_blocks, alignment;
+        gboolean huge_pages, lock_memory, prefault;
+        gint numa_node;
+        gchar *file_name;
+
+        g_object_get (buffer,
+                      "num-blocks", &num_blocks,
+                      "alignment", &alignment,
+                      "huge-pages", &huge_pages,
+                      "lock-memory", &lock_memory,
+                      "prefault", &prefault,
+                      "numa-node", &numa_node,
+                      "file-name", &file_name,
+                      NULL);
+
+        if (uca_ring_buffer_get_block_size (buffer) == block_size &&
+            num_blocks == priv->num_buffers &&
+            alignment == priv->buffer_alignment &&
+            huge_pages == priv->buffer_huge_pages &&
+            lock_memory == priv->buffer_lock_memory &&
+            prefault == priv->buffer_prefault &&
+            numa_node == priv->buffer_numa_node &&
+            g_strcmp0 (file_name, priv->buffer_file) == 0) {
+            g_free (file_name);
+            uca_ring_buffer_reset (buffer);
+            return buffer;
+        }
+
+        g_free (file_name);
+
+        g_object_unref (buffer);
+    }
+
+    return g_object_new (UCA_TYPE_RING_BUFFER,
+                         "block-size", (guint64) block_size,
+                         "num-blocks", priv->num_buffers,
+                         "metadata-size", (guint) sizeof (UcaFrameInfo),
+                         "alignment", priv->buffer_alignment,
+                         "huge-pages", priv->buffer_huge_pages,
+                         "lock-memory", priv->buffer_lock_memory,
+                         "prefault", priv->buffer_prefault,
+                         "numa-node", priv->buffer_numa_node,
+                         "file-name", priv->buffer_file,
+                         NULL);
+}
+
+/*
+ * Remove the cursors of all consumers from the current ring buffer. Must be
+ * called with buffer_lock held.
+ */
+static void
+remove_cursors (UcaCameraPrivate *priv)
+{
+    GHashTableIter iter;
+    gpointer name;
+
+    g_hash_table_iter_init (&iter, priv->consumers);
+
+    while (g_hash_table_iter_next (&iter, &name, NULL)) {
+        UcaRingBufferCursor *cursor;
+
+        cursor = uca_ring_buffer_get_cursor (priv->ring_buffer, name);
+
+        if (cursor != NULL)
+            uca_ring_buffer_remove_cursor (priv->ring_buffer, cursor);
+    }
+}
+
+/*
+ * Take a snapshot of the software binning stage for this recording and make
+ * room for the unbinned frame. The stage is kept for readout after the
+ * recording stopped, so that frames keep the size the consumer expects.
+ */
+static gboolean
+begin_binning (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    Binning binning;
+    gboolean bin;
+
+    bin = get_binning (camera, &binning);
+
+    if (bin && (binning.width == 0 || binning.height == 0 ||
+                binning.x + binning.width * binning.horizontal > binning.src_width ||
+                binning.y + binning.height * binning.vertical > binning.src_height)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "Software region of interest does not fit into the %ux%u frame",
+                     binning.src_width, binning.src_height);
+        return FALSE;
+    }
+
+    g_mutex_lock (&priv->grab_lock);
+    priv->bin = bin;
+
+    if (bin) {
+        gsize size = (gsize) binning.src_width * binning.src_height * binning.src_pixel_size;
+
+        if (size != priv->bin_buffer_size) {
+            g_free (priv->bin_buffer);
+            priv->bin_buffer = g_malloc (size);
+            priv->bin_buffer_size = size;
+        }
+
+        priv->binning = binning;
+    }
+
+    g_mutex_unlock (&priv->grab_lock);
+    return TRUE;
+}
+
+/*
+ * Take a snapshot of the accumulation for this recording. Like binning, it is
+ * kept for readout after the recording stopped.
+ */
+static void
+begin_accumulation (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    UcaCameraPixelFormat format;
+    Accumulation *accumulation = NULL;
+    Accumulation *old;
+    guint width, height;
+
+    if (priv->accumulate_frames > 1) {
+        get_binned_geometry (camera, &width, &height, &format);
+
+        if (format == UCA_CAMERA_PIXEL_FORMAT_MONO8 || format == UCA_CAMERA_PIXEL_FORMAT_MONO16) {
+            accumulation = accumulation_new (priv->accumulate_frames,
+                                             priv->accumulate_mode == UCA_CAMERA_ACCUMULATE_MODE_MEAN,
+                                             (gsize) width * height,
+                                             format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 : 2);
+        }
+        else
+            g_warning ("Packed frames cannot be accumulated");
+    }
+
+    g_mutex_lock (&priv->grab_lock);
+    old = priv->accumulation;
+    priv->accumulation = accumulation;
+    g_mutex_unlock (&priv->grab_lock);
+
+    accumulation_free (old);
+}
+
+/*
+ * Undo begin_binning() and begin_accumulation() if recording could not be
+ * started. Their snapshots replaced those of the previous recording, so its
+ * frames cannot be read out anymore either.
+ */
+static void
+end_frame_stages (UcaCameraPrivate *priv)
+{
+    Accumulation *accumulation;
+
+    g_mutex_lock (&priv->grab_lock);
+    priv->bin = FALSE;
+    priv->is_readout = FALSE;
+    accumulation = priv->accumulation;
+    priv->accumulation = NULL;
+    g_mutex_unlock (&priv->grab_lock);
+
+    accumulation_free (accumulation);
+}
+
+/*
+ * Take a snapshot of the filters for this recording and set them up for the
+ * stored frames. Unbuffered grabs use the chain with grab_lock held.
+ */
+static gboolean
+begin_filters (UcaCamera *camera, GError **error)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    UcaCameraPixelFormat format;
+    FilterChain *chain;
+
+    if (priv->filters->len == 0)
+        return TRUE;
+
+    chain = g_new0 (FilterChain, 1);
+    uca_camera_get_frame_geometry (camera, &chain->width, &chain->height, &format);
+
+    if (format != UCA_CAMERA_PIXEL_FORMAT_MONO8 && format != UCA_CAMERA_PIXEL_FORMAT_MONO16) {
+        g_warning ("Only 8 and 16 bit frames can be filtered");
+        g_free (chain);
+        return TRUE;
+    }
+
+    chain->pixel_size = format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+    chain->filters = g_ptr_array_new_with_free_func (g_object_unref);
+
+    for (guint i = 0; i < priv->filters->len; i++) {
+        UcaFilter *filter = g_ptr_array_index (priv->filters, i);
+
+        if (!uca_filter_setup (filter, chain->width, chain->height, chain->pixel_size, error)) {
+            g_ptr_array_unref (chain->filters);
+            g_free (chain);
+            return FALSE;
+        }
+
+        g_ptr_array_add (chain->filters, g_object_ref (filter));
+    }
+
+    g_mutex_lock (&priv->grab_lock);
+    priv->filter_chain = chain;
+    g_mutex_unlock (&priv->grab_lock);
+    return TRUE;
+}
+
+static void
+end_filters (UcaCameraPrivate *priv)
+{
+    FilterChain *chain;
+
+    g_mutex_lock (&priv->grab_lock);
+    chain = priv->filter_chain;
+    priv->filter_chain = NULL;
+    g_mutex_unlock (&priv->grab_lock);
+
+    if (chain != NULL) {
+        g_ptr_array_unref (chain->filters);
+        g_free (chain);
+    }
+}
+
+/*
+ * Take a snapshot of the frame transform for this recording, so that grabs do
+ * not race with changes of the properties.
+ */
+static void
+begin_transform (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    UcaCameraPixelFormat format;
+
+    priv->transform = priv->apply_transform && (priv->mirror || priv->rotate != 0);
+
+    if (!priv->transform)
+        return;
+
+    uca_camera_get_frame_geometry (camera, &priv->transform_width, &priv->transform_height, &format);
+
+    if (format != UCA_CAMERA_PIXEL_FORMAT_MONO8 && format != UCA_CAMERA_PIXEL_FORMAT_MONO16) {
+        g_warning ("Only 8 and 16 bit frames can be mirrored or rotated");
+        priv->transform = FALSE;
+        return;
+    }
+
+    priv->transform_pixel_size = format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+    priv->transform_mirror = priv->mirror;
+    priv->transform_rotate = priv->rotate;
+}
+
+/*
+ * Take a snapshot of the statistics stage for this recording. Binned sums span
+ * the whole pixel type, otherwise the histogram covers the sensor bit depth.
+ */
+static void
+begin_statistics (UcaCamera *camera)
+{
+    UcaCameraPrivate *priv = camera->priv;
+    UcaCameraPixelFormat format;
+    Binning binning;
+    guint bits;
+
+    priv->stats = priv->statistics;
+
+    if (!priv->stats)
+        return;
+
+    uca_camera_get_frame_geometry (camera, &priv->stats_width, &priv->stats_height, &format);
+
+    if (format != UCA_CAMERA_PIXEL_FORMAT_MONO8 && format != UCA_CAMERA_PIXEL_FORMAT_MONO16) {
+        g_warning ("Statistics are only computed for 8 and 16 bit frames");
+        priv->stats = FALSE;
+        return;
+    }
+
+    priv->stats_pixel_size = format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 1 : 2;
+    bits = uca_camera_get_bitdepth (camera);
+
+    if (get_binning (camera, &binning) && binning.horizontal * binning.vertical > 1)
+        bits = 0;
+
+    priv->stats_bits = bits > 0 && bits < 8 * priv->stats_pixel_size ? bits : 8 * priv->stats_pixel_size;
+    priv->stats_step = priv->statistics_step;
+}
+
+/*
+ * Scratch frame for unbuffered grabs that are transformed afterwards. Must be
+ * called with grab_lock held, which also protects the returned memory.
+ */
+static gpointer
+get_transform_buffer (UcaCameraPrivate *priv)
+{
+    gsize size;
+
+    size = (gsize) priv->transform_width * priv->transform_height * priv->transform_pixel_size;
+
+    if (size != priv->transform_buffer_size) {
+        g_free (priv->transform_buffer);
+        priv->transform_buffer = g_malloc (size);
+        priv->transform_buffer_size = size;
+    }
+
+    return priv->transform_buffer;
+}
+
+/*
+ * Copy a frame to the caller, mirrored and rotated if requested.
+ */
+static void
+copy_frame (UcaCameraPrivate *priv, gpointer dst, gconstpointer src, gsize size)
+{
+    if (priv->transform) {
+        uca_transform_frame (src, dst, priv->transform_width, priv->transform_height,
+                             priv->transform_pixel_size, priv->transform_mirror,
+                             priv->transform_rotate);
+    }
+    else
+        memcpy (dst, src, size);
+}
+
+/**
+ * uca_camera_start_recording:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Initiate recording of frames. If UcaCamera:grab-asynchronous is %TRUE and a
+ * #UcaCameraGrabFunc callback is set, frames are automatically transfered to
+ * the client program, otherwise you must use uca_camera_grab().
+ */
+void
+uca_camera_start_recording (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    GError *tmp_error = NULL;
+    gsize frame_size = 0;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->start_recording != NULL);
+
+    priv = camera->priv;
+
+    g_mutex_lock (&priv->control_lock);
+
+    if (uca_camera_is_recording (camera)) {
+        g_atomic_int_set (&priv->is_recording, TRUE);
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Camera is already recording");
+        goto start_recording_unlock;
+    }
+
+    if (priv->buffered || (priv->transfer_async && priv->async_workers > 0))
+        frame_size = uca_camera_get_frame_size (camera);
+
+    if (priv->transfer_async && (camera->grab_func == NULL)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NO_GRAB_FUNC,
+                     "No grab callback function set");
+        goto start_recording_unlock;
+    }
+
+    /* Fails before it replaces the snapshot of the previous recording */
+    if (!begin_binning (camera, error))
+        goto start_recording_unlock;
+
+    begin_accumulation (camera);
+
+    if (!begin_filters (camera, error)) {
+        end_frame_stages (priv);
+        goto start_recording_unlock;
+    }
+
+    priv->dropped_frames = 0;
+    begin_transform (camera);
+    begin_statistics (camera);
+
+    if (priv->buffered && priv->ring_policy == UCA_CAMERA_RING_POLICY_SPILL) {
+        priv->spill_queue = spill_queue_new (priv, frame_size, error);
+
+        if (priv->spill_queue == NULL) {
+            priv->transform = FALSE;
+            priv->stats = FALSE;
+            end_filters (priv);
+            end_frame_stages (priv);
+            goto start_recording_unlock;
+        }
+    }
+
+    if (priv->transfer_async && priv->async_workers > 0)
+        priv->async_pool = async_pool_new (camera, frame_size);
+
+    g_mutex_lock (&priv->device_lock);
+    (*klass->start_recording)(camera, &tmp_error);
+    g_mutex_unlock (&priv->device_lock);
+
+    if (tmp_error != NULL && priv->async_pool != NULL) {
+        async_pool_free (camera, priv->async_pool);
+        priv->async_pool = NULL;
+    }
+
+    if (tmp_error != NULL && priv->spill_queue != NULL) {
+        spill_queue_free (priv->spill_queue);
+        priv->spill_queue = NULL;
+    }
+
+    if (tmp_error != NULL) {
+        priv->transform = FALSE;
+        priv->stats = FALSE;
+        end_filters (priv);
+        end_frame_stages (priv);
+    }
+
+    if (tmp_error == NULL) {
+        priv->is_readout = FALSE;
+        g_atomic_int_set (&priv->is_recording, TRUE);
+        priv->cancelling_recording = FALSE;
+        priv->cancelling_grab = FALSE;
+        priv->frame_sequence = 0;
+        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+    }
+    else
+        g_propagate_error (error, tmp_error);
+
+    if (tmp_error == NULL && priv->buffered) {
+        GHashTableIter iter;
+        gpointer name, policy;
+
+        priv->ring_buffer = get_ring_buffer (priv, frame_size);
+        priv->ring_growable = TRUE;
+
+        g_mutex_lock (&priv->buffer_lock);
+        g_hash_table_iter_init (&iter, priv->consumers);
+
+        while (g_hash_table_iter_next (&iter, &name, &policy))
+            uca_ring_buffer_add_cursor (priv->ring_buffer, name, GPOINTER_TO_INT (policy));
+
+        g_mutex_unlock (&priv->buffer_lock);
+
+        priv->ring_busy_time = g_get_monotonic_time ();
+        priv->peak_buffer_fill = 0;
+
+        if (priv->ring_policy == UCA_CAMERA_RING_POLICY_DROP_NEWEST ||
+            priv->ring_policy == UCA_CAMERA_RING_POLICY_SPILL)
+            priv->drop_buffer = g_malloc (frame_size);
+
+        if (priv->filter_chain != NULL || priv->stats)
+            priv->pipeline = pipeline_new (priv, priv->filter_chain);
+
+        /* Let's read out the frames from another thread */
+        g_cancellable_reset (priv->grab_cancellable);
+        priv->read_thread = g_thread_new ("read-thread", (GThreadFunc) buffer_thread, camera);
+    }
+
+start_recording_unlock:
+    g_mutex_unlock (&priv->control_lock);
+}
+
+/**
+ * uca_camera_stop_recording:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Stop recording.
+ */
+void
+uca_camera_stop_recording (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    SpillQueue *spill_queue;
+    GError *tmp_error = NULL;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->stop_recording != NULL);
+
+    priv = camera->priv;
+
+    g_mutex_lock (&priv->control_lock);
+
+    if (!uca_camera_is_recording (camera)) {
+        g_atomic_int_set (&priv->is_recording, FALSE);
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is not recording");
+        goto error_stop_recording;
+    }
+
+    if (priv->buffered) {
+        /* Wake up the read thread in case it waits for a borrowed block */
+        GError *thread_error;
+
+        g_mutex_lock (&priv->buffer_lock);
+        priv->cancelling_recording = TRUE;
+        g_cond_broadcast (&priv->buffer_cond);
+        g_mutex_unlock (&priv->buffer_lock);
+
+        /* The read thread may also wait for a frame inside the plugin */
+        g_cancellable_cancel (priv->grab_cancellable);
+
+        /* Errors of the read thread have been reported to consumers already */
+        thread_error = g_thread_join (priv->read_thread);
+        priv->read_thread = NULL;
+
+        if (thread_error != NULL)
+            g_error_free (thread_error);
+
+        /* Publish what the workers still have in flight */
+        if (priv->pipeline != NULL) {
+            pipeline_free (priv->pipeline);
+            priv->pipeline = NULL;
+        }
+
+        cancel_buffered_grab (priv);
+    }
+    else {
+        priv->cancelling_recording = TRUE;
+        g_cancellable_cancel (priv->grab_cancellable);
+    }
+
+    g_mutex_lock (&priv->device_lock);
+
+    (*klass->stop_recording)(camera, &tmp_error);
+    priv->cancelling_recording = FALSE;
+
+    g_mutex_unlock (&priv->device_lock);
+
+    if (tmp_error == NULL) {
+        g_atomic_int_set (&priv->is_recording, FALSE);
+        priv->is_readout = FALSE;
+        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
+    }
+    else
+        g_propagate_error (error, tmp_error);
+
+    if (priv->async_pool != NULL) {
+        AsyncPool *pool = priv->async_pool;
+
+        /* The plugin has stopped calling us, let the workers finish */
+        g_mutex_lock (&priv->buffer_lock);
+        priv->dropped_frames += pool->n_dropped;
+        priv->async_pool = NULL;
+        g_mutex_unlock (&priv->buffer_lock);
+
+        async_pool_free (camera, pool);
+    }
+
+    end_filters (priv);
+
+    g_mutex_lock (&priv->buffer_lock);
+
+    /* Grabs copy frames without buffer_lock, so wait until they are handed back */
+    g_atomic_int_inc (&priv->n_buffer_waiters);
+
+    while (priv->n_copying > 0)
+        g_cond_wait (&priv->buffer_cond, &priv->buffer_lock);
+
+    g_atomic_int_add (&priv->n_buffer_waiters, -1);
+
+    if (priv->ring_buffer != NULL) {
+        /* Keep the memory around for the next recording, but not what it has grown */
+        priv->dropped_frames += uca_ring_buffer_get_num_dropped (priv->ring_buffer);
+        remove_cursors (priv);
+        uca_ring_buffer_reset (priv->ring_buffer);
+        uca_ring_buffer_shrink (priv->ring_buffer);
+        priv->spare_ring_buffer = priv->ring_buffer;
+        priv->ring_buffer = NULL;
+    }
+
+    /* Unread frames are gone */
+    g_queue_clear (&priv->borrowed_frames);
+    g_queue_clear (&priv->released_frames);
+    g_atomic_int_set (&priv->frames_pending, FALSE);
+    clear_frame_fd (priv);
+    priv->transform = FALSE;
+
+    g_free (priv->drop_buffer);
+    priv->drop_buffer = NULL;
+    spill_queue = priv->spill_queue;
+    priv->spill_queue = NULL;
+
+    g_mutex_unlock (&priv->buffer_lock);
+
+    /* The writer may still wake up consumers, so join it without buffer_lock */
+    if (spill_queue != NULL) {
+        guint64 n_unread;
+
+        n_unread = spill_queue_free (spill_queue);
+
+        g_mutex_lock (&priv->buffer_lock);
+        priv->dropped_frames += n_unread;
+        g_mutex_unlock (&priv->buffer_lock);
+    }
+
+error_stop_recording:
+    g_mutex_unlock (&priv->control_lock);
+}
+
+/**
+ * uca_camera_is_recording:
+ * @camera: A #UcaCamera object
+ *
+ * Convenience function to ask the current recording status. Unlike reading the
+ * #UcaCamera:is-recording property, this does not take any lock and is cheap
+ * enough to be called for every frame.
+ *
+ * Return value: %TRUE if recording is ongoing
+ * Since: 1.5
+ */
+gboolean
+uca_camera_is_recording (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    return g_atomic_int_get (&camera->priv->is_recording);
+}
+
+/**
+ * uca_camera_get_trigger_source:
+ * @camera: A #UcaCamera object
+ *
+ * Get #UcaCamera:trigger-source without going through the property system.
+ * Plugins that change it internally must call g_object_notify() to keep this
+ * up to date.
+ *
+ * Return value: The current trigger source
+ * Since: 2.5
+ */
+UcaCameraTriggerSource
+uca_camera_get_trigger_source (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), UCA_CAMERA_TRIGGER_SOURCE_AUTO);
+    return (UcaCameraTriggerSource) g_atomic_int_get (&camera->priv->cached_trigger_source);
+}
+
+/**
+ * uca_camera_get_roi:
+ * @camera: A #UcaCamera object
+ * @x: (out) (allow-none): Location to store #UcaCamera:roi-x or %NULL
+ * @y: (out) (allow-none): Location to store #UcaCamera:roi-y or %NULL
+ * @width: (out) (allow-none): Location to store #UcaCamera:roi-width or %NULL
+ * @height: (out) (allow-none): Location to store #UcaCamera:roi-height or %NULL
+ *
+ * Get the region of interest without going through the property system.
+ * Plugins that change it internally must call g_object_notify() to keep this
+ * up to date.
+ *
+ * Since: 2.5
+ */
+void
+uca_camera_get_roi (UcaCamera *camera, guint *x, guint *y, guint *width, guint *height)
+{
+    UcaCameraPrivate *priv;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    priv = camera->priv;
+
+    if (x != NULL)
+        *x = (guint) g_atomic_int_get (&priv->cached_roi_x);
+
+    if (y != NULL)
+        *y = (guint) g_atomic_int_get (&priv->cached_roi_y);
+
+    if (width != NULL)
+        *width = (guint) g_atomic_int_get (&priv->cached_roi_width);
+
+    if (height != NULL)
+        *height = (guint) g_atomic_int_get (&priv->cached_roi_height);
+}
+
+/**
+ * uca_camera_get_bitdepth:
+ * @camera: A #UcaCamera object
+ *
+ * Get #UcaCamera:sensor-bitdepth without going through the property system.
+ * Plugins that change it internally must call g_object_notify() to keep this
+ * up to date.
+ *
+ * Return value: Number of bits per pixel
+ * Since: 2.5
+ */
+guint
+uca_camera_get_bitdepth (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), 0);
+    return (guint) g_atomic_int_get (&camera->priv->cached_bitdepth);
+}
+
+static gboolean
+already_recording (UcaCamera *camera, GError **error)
+{
+    if (uca_camera_is_recording (camera)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
+                     "Camera is still recording");
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * uca_camera_stopped_recording:
+ * @camera: A #UcaCamera object
+ * 
+ * Convenience function for plugin's to check if uca_camera_stop_recording() has been called.
+ * 
+ * Return value: %True if state is standby or transitioning from recording to standby
+ */
+gboolean
+uca_camera_stopped_recording(UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
+    return !uca_camera_is_recording (camera) || camera->priv->cancelling_recording;
+}
+
+/**
+ * uca_camera_get_pixel_format:
+ * @camera: A #UcaCamera object
+ *
+ * Like #UcaCamera:pixel-format but cheap enough to call for every frame.
+ * Plugins that change the pixel format or the bit depth internally must call
+ * g_object_notify() to keep this up to date.
+ *
+ * Returns: The current pixel format.
+ * Since: 2.5
+ */
+UcaCameraPixelFormat
+uca_camera_get_pixel_format (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), UCA_CAMERA_PIXEL_FORMAT_MONO16);
+    return (UcaCameraPixelFormat) g_atomic_int_get (&camera->priv->cached_pixel_format);
+}
+
+/**
+ * uca_camera_pixel_format_get_bits:
+ * @format: A #UcaCameraPixelFormat
+ *
+ * Returns: The number of bits a pixel occupies in memory in @format.
+ * Since: 2.5
+ */
+guint
+uca_camera_pixel_format_get_bits (UcaCameraPixelFormat format)
+{
+    switch (format) {
+        case UCA_CAMERA_PIXEL_FORMAT_MONO8:
+            return 8;
+        case UCA_CAMERA_PIXEL_FORMAT_MONO10P:
+            return 10;
+        case UCA_CAMERA_PIXEL_FORMAT_MONO12P:
+            return 12;
+        case UCA_CAMERA_PIXEL_FORMAT_MONO32:
+            return 32;
+        default:
+            return 16;
+    }
+}
+
+/**
+ * uca_camera_get_frame_size:
+ * @camera: A #UcaCamera object
+ *
+ * Returns: The number of bytes needed to grab a frame with the current region
+ * of interest and #UcaCamera:pixel-format.
+ * Since: 2.5
+ */
+gsize
+uca_camera_get_frame_size (UcaCamera *camera)
+{
+    UcaCameraPixelFormat format;
+    guint width, height;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), 0);
+
+    uca_camera_get_frame_geometry (camera, &width, &height, &format);
+
+    return uca_transform_get_packed_size ((gsize) width * height,
+                                          uca_camera_pixel_format_get_bits (format));
+}
+
+/**
+ * uca_camera_get_frame_geometry:
+ * @camera: A #UcaCamera object
+ * @width: (out) (allow-none): Location to store the frame width or %NULL
+ * @height: (out) (allow-none): Location to store the frame height or %NULL
+ * @format: (out) (allow-none): Location to store the pixel format or %NULL
+ *
+ * Get the dimensions and the pixel format of the frames stored by libuca.
+ * These differ from the region of interest and #UcaCamera:pixel-format if
+ * software binning or cropping is enabled or if sums of accumulated frames are
+ * stored. Rotations applied by #UcaCamera:apply-transform are not taken into
+ * account.
+ *
+ * Since: 2.5
+ */
+void
+uca_camera_get_frame_geometry (UcaCamera *camera, guint *width, guint *height,
+                               UcaCameraPixelFormat *format)
+{
+    UcaCameraPrivate *priv;
+    UcaCameraPixelFormat binned_format;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    priv = camera->priv;
+    get_binned_geometry (camera, width, height, &binned_format);
+
+    if (format == NULL)
+        return;
+
+    if (priv->accumulate_frames > 1 && priv->accumulate_mode == UCA_CAMERA_ACCUMULATE_MODE_SUM &&
+        (binned_format == UCA_CAMERA_PIXEL_FORMAT_MONO8 || binned_format == UCA_CAMERA_PIXEL_FORMAT_MONO16))
+        *format = UCA_CAMERA_PIXEL_FORMAT_MONO32;
+    else
+        *format = binned_format;
+}
+
+/**
+ * uca_camera_start_readout:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Initiate readout mode for cameras that support
+ * #UcaCamera:has-camram-recording after calling
+ * uca_camera_stop_recording(). Frames have to be picked up with
+ * ufo_camera_grab().
+ */
+void
+uca_camera_start_readout (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA(camera));
+
+    klass = UCA_CAMERA_GET_CLASS(camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->start_readout != NULL);
+
+    g_mutex_lock (&camera->priv->control_lock);
+
+    if (!already_recording (camera, error)) {
+        GError *tmp_error = NULL;
+
+        g_mutex_lock (&camera->priv->device_lock);
+        (*klass->start_readout) (camera, &tmp_error);
+        g_mutex_unlock (&camera->priv->device_lock);
+
+        if (tmp_error == NULL) {
+            camera->priv->is_readout = TRUE;
+            g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_READOUT]);
+        }
+        else
+            g_propagate_error (error, tmp_error);
+    }
+
+    g_mutex_unlock (&camera->priv->control_lock);
+}
+
+/**
+ * uca_camera_stop_readout:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Stop reading out frames.
+ *
+ * Since: 1.1
+ */
+void
+uca_camera_stop_readout (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA(camera));
+
+    klass = UCA_CAMERA_GET_CLASS(camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->stop_readout != NULL);
+
+    g_mutex_lock (&camera->priv->control_lock);
+
+    if (!already_recording (camera, error)) {
+        GError *tmp_error = NULL;
+
+        g_mutex_lock (&camera->priv->device_lock);
+        (*klass->stop_readout) (camera, &tmp_error);
+        g_mutex_unlock (&camera->priv->device_lock);
+
+        if (tmp_error == NULL) {
+            camera->priv->is_readout = FALSE;
+            g_object_notify (G_OBJECT (camera), "is-readout");
+        }
+        else
+            g_propagate_error (error, tmp_error);
+    }
+
+    g_mutex_unlock (&camera->priv->control_lock);
+}
+
+/**
+ * uca_camera_set_grab_func:
+ * @camera: A #UcaCamera object
+ * @func: (scope call): A #UcaCameraGrabFunc callback function
+ * @user_data: (closure): Data that is passed on to #func
+ *
+ * Set the grab function that is called whenever a frame is readily transfered.
+ */
+void
+uca_camera_set_grab_func(UcaCamera *camera, UcaCameraGrabFunc func, gpointer user_data)
+{
+    camera->grab_func = func;
+    camera->user_data = user_data;
+}
+
+/**
+ * uca_camera_trigger:
+ * @camera: A #UcaCamera object
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Trigger from software if supported by camera.
+ *
+ * You must have called uca_camera_start_recording() before, otherwise you will
+ * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ */
+void
+uca_camera_trigger (UcaCamera *camera, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+    g_return_if_fail (klass->trigger != NULL);
+
+    g_mutex_lock (&camera->priv->trigger_lock);
+
+    if (!camera->priv->is_recording) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING, "Camera is not recording");
+    }
+    else {
+        (*klass->trigger) (camera, error);
+    }
+
+    g_mutex_unlock (&camera->priv->trigger_lock);
+}
+
+/**
+ * uca_camera_write:
+ * @camera: A #UcaCamera object
+ * @name: String that identifies the written data.
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @size: Size of the data buffer in bytes.
+ * @error: Location to store a #UcaCameraError or %NULL.
+ *
+ * Writes camera-specific @data containing @size bytes and identified by @name.
+ */
+void
+uca_camera_write (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error)
+{
+    UcaCameraClass *klass;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+
+    klass = UCA_CAMERA_GET_CLASS (camera);
+
+    g_return_if_fail (klass != NULL);
+
+    if (klass->write == NULL) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "`%s' does not provide a `write' method",
+                     G_OBJECT_TYPE_NAME (G_OBJECT (camera)));
+    }
+    else {
+        (*klass->write) (camera, name, data, size, error);
+    }
+}
+
+/*
+ * Python threads must not hold the GIL while they block in a grab. It is
+ * dropped before any of our locks is taken and reacquired after all of them
+ * are released again, so that no thread waits for the GIL while holding a lock
+ * that the thread owning the GIL may need.
+ */
+typedef struct {
+    gboolean released;
+#ifdef WITH_PYTHON_MULTITHREADING
+    PyGILState_STATE state;
+    PyThreadState *thread_state;
+#endif
+} PythonLock;
+
+static void
+release_python_lock (PythonLock *lock)
+{
+#ifdef WITH_PYTHON_MULTITHREADING
+    lock->released = Py_IsInitialized ();
+
+    if (lock->released) {
+        lock->state = PyGILState_Ensure ();
+        lock->thread_state = PyEval_SaveThread ();
+    }
+#else
+    lock->released = FALSE;
+#endif
+}
+
+static void
+acquire_python_lock (PythonLock *lock)
+{
+#ifdef WITH_PYTHON_MULTITHREADING
+    if (lock->released) {
+        PyEval_RestoreThread (lock->thread_state);
+        PyGILState_Release (lock->state);
+    }
 #endif
 }
 
+/*
+ * Number of times we poll the ring buffer before going to sleep. Frames that
+ * arrive within this short window are picked up without a context switch.
+ */
+#define BUFFER_SPIN_COUNT   256
+
+/*
+ * Like frame_available() but for the named @consumer which only sees frames in
+ * the ring buffer. Must be called with buffer_lock held.
+ */
+static gboolean
+consumer_frame_available (UcaCameraPrivate *priv, const gchar *consumer)
+{
+    UcaRingBufferCursor *cursor;
+
+    if (consumer == NULL)
+        return frame_available (priv);
+
+    if (priv->ring_buffer == NULL)
+        return FALSE;
+
+    cursor = uca_ring_buffer_get_cursor (priv->ring_buffer, consumer);
+    return cursor != NULL && uca_ring_buffer_cursor_available (priv->ring_buffer, cursor);
+}
+
+/*
+ * Wait until a frame is available, grabbing is cancelled or the monotonic
+ * @end_time has passed. A negative @end_time waits forever.
+ */
+static void
+block_for_frame (UcaCameraPrivate *priv, const gchar *consumer, gint64 end_time,
+                 GCancellable *cancellable)
+{
+    g_atomic_int_inc (&priv->n_buffer_waiters);
+
+    while (priv->ring_buffer != NULL &&
+           !consumer_frame_available (priv, consumer) &&
+           !priv->cancelling_grab &&
+           !g_cancellable_is_cancelled (cancellable)) {
+        if (end_time < 0)
+            g_cond_wait (&priv->buffer_cond, &priv->buffer_lock);
+        else if (!g_cond_wait_until (&priv->buffer_cond, &priv->buffer_lock, end_time))
+            break;
+    }
+
+    g_atomic_int_add (&priv->n_buffer_waiters, -1);
+}
+
+/*
+ * Block until @consumer or the default consumer if %NULL has a frame. Returns
+ * %FALSE if recording was stopped, @end_time has passed or @cancellable was
+ * cancelled. Must be called with buffer_lock held.
+ */
+static gboolean
+wait_for_frame (UcaCameraPrivate *priv, const gchar *consumer, gint64 end_time,
+                GCancellable *cancellable, GError **error)
+{
+    if (!consumer_frame_available (priv, consumer) && !priv->cancelling_grab)
+        block_for_frame (priv, consumer, end_time, cancellable);
+
+    if (priv->ring_buffer == NULL || !consumer_frame_available (priv, consumer)) {
+        if (g_cancellable_set_error_if_cancelled (cancellable, error))
+            return FALSE;
+
+        if (priv->ring_buffer == NULL || priv->cancelling_grab)
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                         "Recording has been stopped");
+        else
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_TIMEOUT,
+                         "No frame arrived in time");
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+wake_cancelled_waiters (GCancellable *cancellable, UcaCameraPrivate *priv)
+{
+    g_mutex_lock (&priv->buffer_lock);
+    g_cond_broadcast (&priv->buffer_cond);
+    g_mutex_unlock (&priv->buffer_lock);
+}
+
+/*
+ * Metadata of a frame returned by borrow_buffered_frame(). Must be called with
+ * buffer_lock held.
+ */
+static UcaFrameInfo *
+get_buffered_frame_info (UcaCameraPrivate *priv, gpointer buffer)
+{
+    UcaFrameInfo *info = NULL;
+
+    if (priv->spill_queue != NULL)
+        info = spill_queue_get_info (priv->spill_queue, buffer);
+
+    return info != NULL ? info : uca_ring_buffer_get_metadata (priv->ring_buffer, buffer);
+}
+
+/*
+ * Borrow the next frame from the ring buffer or the spill queue and block until
+ * one is available, grabbing has been cancelled or @end_time has passed. If
+ * @cancellable is not %NULL, it must be connected to wake_cancelled_waiters().
+ * @info and @size receive the metadata and size of the frame unless they are
+ * %NULL. If @copy is %TRUE, the caller copies the frame without holding
+ * buffer_lock and uca_camera_stop_recording() waits until it is released.
+ */
 static gpointer
-buffer_thread (UcaCamera *camera)
+borrow_buffered_frame (UcaCamera *camera, gint64 end_time, GCancellable *cancellable,
+                       UcaFrameInfo *info, gsize *size, gboolean copy, GError **error)
+{
+    UcaCameraPrivate *priv;
+    gpointer buffer = NULL;
+
+    priv = camera->priv;
+
+    /* Spin without the lock, so that other grabs can borrow and release meanwhile */
+    for (guint i = 0; i < BUFFER_SPIN_COUNT; i++) {
+        if (g_atomic_int_get (&priv->frames_pending) || g_atomic_int_get (&priv->cancelling_grab))
+            break;
+    }
+
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (priv->ring_buffer == NULL) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                     "Camera is not recording");
+    }
+    else if (wait_for_frame (priv, NULL, end_time, cancellable, error)) {
+        GError *tmp_error = NULL;
+        guint64 index;
+
+        if (priv->spill_queue != NULL &&
+            spill_queue_claim (priv->spill_queue, priv->ring_buffer, &index)) {
+            SpillQueue *spill_queue = priv->spill_queue;
+
+            /* Keep stop_recording() from freeing the spill queue while reading from disk */
+            priv->n_copying++;
+            g_mutex_unlock (&priv->buffer_lock);
+
+            buffer = spill_queue_read (spill_queue, index, &tmp_error);
+
+            g_mutex_lock (&priv->buffer_lock);
+            priv->n_copying--;
+
+            if (priv->n_buffer_waiters > 0)
+                g_cond_broadcast (&priv->buffer_cond);
+
+            if (buffer != NULL)
+                spill_queue_borrow (spill_queue, buffer);
+        }
+        else {
+            buffer = uca_ring_buffer_borrow_read_pointer (priv->ring_buffer);
+
+            if (buffer != NULL)
+                g_queue_push_tail (&priv->borrowed_frames, buffer);
+        }
+
+        if (tmp_error != NULL) {
+            g_propagate_error (error, tmp_error);
+        }
+        else if (buffer == NULL) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
+                         "Ring buffer is empty");
+        }
+        else {
+            UcaFrameInfo *metadata;
+
+            metadata = get_buffered_frame_info (priv, buffer);
+            metadata->dequeue_time = g_get_monotonic_time ();
+
+            if (info != NULL)
+                memcpy (info, metadata, sizeof (UcaFrameInfo));
+
+            if (size != NULL)
+                *size = uca_ring_buffer_get_block_size (priv->ring_buffer);
+
+            if (copy)
+                priv->n_copying++;
+        }
+
+        /* Reset the hint for spinning readers once they have caught up */
+        if (!frame_available (priv)) {
+            g_atomic_int_set (&priv->frames_pending, FALSE);
+
+            /* The producer does not publish again for a frame it published before the reset */
+            if (frame_available (priv))
+                g_atomic_int_set (&priv->frames_pending, TRUE);
+        }
+
+        clear_frame_fd (priv);
+    }
+
+    g_mutex_unlock (&priv->buffer_lock);
+    return buffer;
+}
+
+/*
+ * The ring buffer takes blocks back in the order in which they were borrowed,
+ * but grabs that copy concurrently can finish in any order. A block released
+ * early is held back until all older ones are released. Must be called with
+ * buffer_lock held.
+ */
+static void
+release_ring_frame (UcaCameraPrivate *priv, gpointer buffer)
+{
+    if (priv->ring_buffer == NULL || g_queue_find (&priv->borrowed_frames, buffer) == NULL)
+        return;
+
+    g_queue_push_tail (&priv->released_frames, buffer);
+
+    while (!g_queue_is_empty (&priv->borrowed_frames)) {
+        gpointer oldest = g_queue_peek_head (&priv->borrowed_frames);
+
+        if (!g_queue_remove (&priv->released_frames, oldest))
+            break;
+
+        g_queue_pop_head (&priv->borrowed_frames);
+        uca_ring_buffer_release_read_pointer (priv->ring_buffer, oldest);
+    }
+}
+
+/*
+ * Hand a frame returned by borrow_buffered_frame() back. @copy must be the
+ * same as for the borrow.
+ */
+static void
+release_buffered_frame (UcaCameraPrivate *priv, gpointer buffer, gboolean copy)
+{
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (copy)
+        priv->n_copying--;
+
+    if (priv->spill_queue == NULL || !spill_queue_release (priv->spill_queue, buffer))
+        release_ring_frame (priv, buffer);
+
+    /* Waiters register with buffer_lock held, so this check is safe */
+    if (priv->n_buffer_waiters > 0)
+        g_cond_broadcast (&priv->buffer_cond);
+
+    g_mutex_unlock (&priv->buffer_lock);
+}
+
+/**
+ * uca_camera_grab:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a frame a single frame and store the result in @data.
+ *
+ * You must have called uca_camera_start_recording() before, otherwise you will
+ * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ */
+gboolean
+uca_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+{
+    return uca_camera_grab_full (camera, data, NULL, error);
+}
+
+/*
+ * Grab a frame directly from the plugin. The plugin can honour @end_time and
+ * @cancellable through uca_camera_get_grab_end_time() and
+ * uca_camera_get_grab_cancellable().
+ */
+static gboolean
+grab_device_frame (UcaCamera *camera, gpointer data, UcaFrameInfo *info, gint64 end_time,
+                   GCancellable *cancellable, GError **error)
+{
+    UcaCameraPrivate *priv;
+    gboolean result;
+    gulong handler;
+
+    priv = camera->priv;
+
+    g_mutex_lock (&priv->device_lock);
+    handler = begin_device_grab (priv, cancellable, end_time);
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        result = FALSE;
+    else
+        result = grab_frame (camera, data, info, error);
+
+    end_device_grab (priv, cancellable, handler);
+    g_mutex_unlock (&priv->device_lock);
+
+    if (result) {
+        filter_frame (priv->filter_chain, data);
+        analyse_frame (priv, data, info);
+    }
+
+    return result;
+}
+
+/*
+ * Common implementation of the single frame grab functions. Waits until the
+ * monotonic @end_time unless it is negative.
+ */
+static gboolean
+grab_full_until (UcaCamera *camera, gpointer data, UcaFrameInfo *info, gint64 end_time,
+                 GCancellable *cancellable, GError **error)
 {
     UcaCameraClass *klass;
-    GError *error = NULL;
+    UcaCameraPrivate *priv;
+    UcaFrameInfo tmp_info;
+    PythonLock python_lock;
+    gboolean result = FALSE;
+
+    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
 
     klass = UCA_CAMERA_GET_CLASS (camera);
 
-    while (!camera->priv->cancelling_recording) {
+    g_return_val_if_fail (klass != NULL, FALSE);
+    g_return_val_if_fail (klass->grab != NULL || klass->grab_full != NULL, FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
+
+    priv = camera->priv;
+
+    if (info == NULL)
+        info = &tmp_info;
+
+    release_python_lock (&python_lock);
+
+    if (!priv->buffered) {
+        g_mutex_lock (&priv->grab_lock);
+
+        if (!priv->is_recording && !priv->is_readout) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                         "Camera is neither recording nor in readout mode");
+        }
+        else {
+            gboolean transform = priv->transform;
+            gpointer frame = transform ? get_transform_buffer (priv) : data;
+
+            result = grab_device_frame (camera, frame, info, end_time, cancellable, error);
+
+            if (result && transform)
+                copy_frame (priv, data, frame, priv->transform_buffer_size);
+
+            info->dequeue_time = g_get_monotonic_time ();
+        }
+
+        g_mutex_unlock (&priv->grab_lock);
+    }
+    else {
         gpointer buffer;
+        gsize size;
+        gulong handler = 0;
 
-        buffer = uca_ring_buffer_get_write_pointer (camera->priv->ring_buffer);
+        /* Connect first, the handler takes buffer_lock if already cancelled */
+        if (cancellable != NULL)
+            handler = g_cancellable_connect (cancellable, G_CALLBACK (wake_cancelled_waiters), priv, NULL);
 
-        if (!(*klass->grab) (camera, buffer, &error)) {
-            camera->priv->cancelling_grab = TRUE;
-            break;
+        buffer = borrow_buffered_frame (camera, end_time, cancellable, info, &size, TRUE, error);
+
+        if (buffer != NULL) {
+            copy_frame (priv, data, buffer, size);
+            release_buffered_frame (priv, buffer, TRUE);
+            result = TRUE;
         }
 
-        uca_ring_buffer_write_advance (camera->priv->ring_buffer);
+        if (cancellable != NULL)
+            g_cancellable_disconnect (cancellable, handler);
     }
 
-    return error;
+    acquire_python_lock (&python_lock);
+    return result;
+}
+
+/**
+ * uca_camera_grab_full:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @info: (out caller-allocates) (allow-none): Location to store the frame
+ *  metadata or %NULL
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a single frame like uca_camera_grab() and additionally return its
+ * sequence number and timestamps in @info.
+ *
+ * Returns: %TRUE if a frame was grabbed.
+ * Since: 2.5
+ */
+gboolean
+uca_camera_grab_full (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error)
+{
+    return grab_full_until (camera, data, info, -1, NULL, error);
+}
+
+/**
+ * uca_camera_grab_timeout:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL.
+ * @timeout: Maximum time to wait in seconds, negative to wait forever
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a single frame like uca_camera_grab() but give up with
+ * #UCA_CAMERA_ERROR_TIMEOUT if no frame arrives within @timeout seconds. In
+ * unbuffered mode, the timeout is only honoured by plugins that check
+ * uca_camera_get_grab_end_time().
+ *
+ * Returns: %TRUE if a frame was grabbed.
+ * Since: 2.5
+ */
+gboolean
+uca_camera_grab_timeout (UcaCamera *camera, gpointer data, gdouble timeout, GError **error)
+{
+    gint64 end_time;
+
+    end_time = timeout < 0.0 ? -1 : g_get_monotonic_time () + (gint64) (timeout * G_USEC_PER_SEC);
+    return grab_full_until (camera, data, NULL, end_time, NULL, error);
 }
 
-static GEnumValue *
-find_enum_value (GParamSpecEnum *pspec, const gchar *name)
+static void
+grab_task_thread (GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
 {
-    GEnumValue *result;
-    GEnumClass *enum_class;
-
-    result = NULL;
-    enum_class = pspec->enum_class;
-
-    for (guint i = 0; i < enum_class->n_values; i++)
-        if (!g_strcmp0 (enum_class->values[i].value_name, name))
-            result = &enum_class->values[i];
+    GError *error = NULL;
 
-    return result;
+    if (grab_full_until (UCA_CAMERA (source_object), task_data, NULL, -1, cancellable, &error))
+        g_task_return_boolean (task, TRUE);
+    else
+        g_task_return_error (task, error);
 }
 
-static gboolean
-is_a_number (const gchar *s)
+/**
+ * uca_camera_grab_async:
+ * @camera: A #UcaCamera object
+ * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
+ *  %NULL and must stay valid until @callback is called.
+ * @cancellable: (allow-none): A #GCancellable or %NULL
+ * @callback: A #GAsyncReadyCallback to call when the frame has been grabbed
+ * @user_data: Data to pass to @callback
+ *
+ * Grab a single frame like uca_camera_grab() on a worker thread. @callback is
+ * called in the thread-default main context of the calling thread and should
+ * call uca_camera_grab_finish(). Cancelling @cancellable aborts waiting for the
+ * frame with %G_IO_ERROR_CANCELLED, in unbuffered mode only if the plugin
+ * checks uca_camera_get_grab_cancellable().
+ *
+ * Since: 2.5
+ */
+void
+uca_camera_grab_async (UcaCamera *camera, gpointer data, GCancellable *cancellable,
+                       GAsyncReadyCallback callback, gpointer user_data)
 {
-    g_return_val_if_fail (s != NULL, FALSE);
+    GTask *task;
 
-    for (; *s != '\0'; s++) {
-        if (!g_ascii_isdigit (*s))
-            return FALSE;
-    }
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (data != NULL);
 
-    return TRUE;
+    task = g_task_new (camera, cancellable, callback, user_data);
+    g_task_set_source_tag (task, uca_camera_grab_async);
+    g_task_set_task_data (task, data, NULL);
+    g_task_run_in_thread (task, grab_task_thread);
+    g_object_unref (task);
 }
 
 /**
- * uca_camera_parse_arg_props:
+ * uca_camera_grab_finish:
  * @camera: A #UcaCamera object
- * @argv: Array of property assignment strings in the form of `prop=value`
- * @argc: Length of @argv
- * @error: Location to store a #UcaCameraError error or %NULL
+ * @result: The #GAsyncResult passed to the callback of uca_camera_grab_async()
+ * @error: Location to store a #UcaCameraError or #GIOError or %NULL
  *
- * Parses the assignment array @argv and sets the property to the given value.
- * If an error occures, @error is set and %FALSE is returned.
+ * Finish a grab started with uca_camera_grab_async().
  *
- * Returns: %TRUE on success.
+ * Returns: %TRUE if a frame was grabbed.
+ * Since: 2.5
  */
 gboolean
-uca_camera_parse_arg_props (UcaCamera *camera, gchar **argv, guint argc, GError **error)
+uca_camera_grab_finish (UcaCamera *camera, GAsyncResult *result, GError **error)
 {
-    GRegex *assignment;
-
-    assignment = g_regex_new ("\\s*([A-Za-z0-9-]*)=(.*)\\s*", 0, 0, error);
-
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UCHAR,   value_transform_uchar);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_INT,     value_transform_int);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UINT,    value_transform_uint);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_UINT64,  value_transform_uint64);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_LONG,    value_transform_long);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_ULONG,   value_transform_ulong);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_FLOAT,   value_transform_float);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_DOUBLE,  value_transform_double);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_BOOLEAN, value_transform_boolean);
-    g_value_register_transform_func (G_TYPE_STRING, G_TYPE_ENUM,    value_transform_enum);
-
-    for (guint i = 0; i < argc; i++) {
-        GMatchInfo *match;
-        gboolean success = TRUE;
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (g_task_is_valid (result, camera), FALSE);
 
-        g_regex_match (assignment, argv[i], 0, &match);
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-        if (g_match_info_matches (match)) {
-            GParamSpec *pspec;
-            GValue value = {0};
+/**
+ * uca_camera_get_grab_cancellable:
+ * @camera: A #UcaCamera object
+ *
+ * For plugin implementations: get a #GCancellable that is cancelled when the
+ * grab that is currently in progress should be aborted, either because the
+ * caller of uca_camera_grab_async() cancelled it or because the recording is
+ * being stopped. Plugins that wait for a trigger or a frame should check it or
+ * wait on its file descriptor and fail with %G_IO_ERROR_CANCELLED.
+ *
+ * Returns: (transfer none): A #GCancellable owned by @camera
+ * Since: 2.5
+ */
+GCancellable *
+uca_camera_get_grab_cancellable (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+    return camera->priv->grab_cancellable;
+}
 
-            gchar *prop = g_match_info_fetch (match, 1);
-            gchar *string_value = g_match_info_fetch (match, 2);
+/**
+ * uca_camera_get_grab_end_time:
+ * @camera: A #UcaCamera object
+ *
+ * For plugin implementations: get the monotonic time in microseconds after
+ * which the grab that is currently in progress should fail with
+ * #UCA_CAMERA_ERROR_TIMEOUT.
+ *
+ * Returns: A time comparable to g_get_monotonic_time() or -1 if the grab
+ * may block forever
+ * Since: 2.5
+ */
+gint64
+uca_camera_get_grab_end_time (UcaCamera *camera)
+{
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), -1);
+    return camera->priv->grab_end_time;
+}
 
-            pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (camera), prop);
+static gboolean
+grab_unbuffered_frames (UcaCamera *camera, guint8 *data, gsize frame_size,
+                        guint n_frames, guint *n_got, gint64 end_time, GError **error)
+{
+    UcaFrameInfo info;
+    gulong handler;
+    gboolean transform;
 
-            if (pspec != NULL) {
-                GValue target_value = {0};
+    transform = camera->priv->transform;
 
-                if (g_type_is_a (pspec->value_type, G_TYPE_ENUM)) {
-                    g_value_init (&value, G_TYPE_INT);
+    g_mutex_lock (&camera->priv->device_lock);
+    handler = begin_device_grab (camera->priv, NULL, end_time);
 
-                    if (!is_a_number (string_value)) {
-                        GEnumValue *enum_value;
+    while (*n_got < n_frames) {
+        guint8 *frame = data + *n_got * frame_size;
 
-                        enum_value = find_enum_value ((GParamSpecEnum *) pspec, string_value);
+        if (!grab_frame (camera, transform ? get_transform_buffer (camera->priv) : frame, &info, error))
+            break;
 
-                        if (enum_value) {
-                            g_value_set_int (&value, enum_value->value);
-                        }
-                        else {
-                            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND,
-                                         "Enum value `%s' does not exist for `%s'",
-                                         string_value, prop);
-                            success = FALSE;
-                        }
-                    }
-                    else {
-                        g_value_set_int (&value, atoi (string_value));
-                    }
-                }
-                else {
-                    g_value_init (&value, G_TYPE_STRING);
-                    g_value_set_string (&value, string_value);
-                }
+        filter_frame (camera->priv->filter_chain, transform ? camera->priv->transform_buffer : frame);
 
-                g_value_init (&target_value, pspec->value_type);
-                g_value_transform (&value, &target_value);
-                g_object_set_property (G_OBJECT (camera), prop, &target_value);
-                g_value_unset (&value);
-                g_value_unset (&target_value);
-            }
-            else {
-                g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
-                             "No property `%s' found", prop);
-                success = FALSE;
-            }
+        if (transform)
+            copy_frame (camera->priv, frame, camera->priv->transform_buffer, frame_size);
 
-            g_free (prop);
-            g_free (string_value);
+        (*n_got)++;
 
-            if (!success) {
-                g_match_info_free (match);
-                g_regex_unref (assignment);
-                return FALSE;
-            }
+        if (end_time >= 0 && *n_got < n_frames && g_get_monotonic_time () >= end_time) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_TIMEOUT,
+                         "Timeout after %u of %u frames", *n_got, n_frames);
+            break;
         }
-
-        g_match_info_free (match);
     }
 
-    g_regex_unref (assignment);
-    return TRUE;
+    end_device_grab (camera->priv, NULL, handler);
+    g_mutex_unlock (&camera->priv->device_lock);
+    return *n_got == n_frames;
 }
 
 /**
- * uca_camera_start_recording:
+ * uca_camera_grab_many:
  * @camera: A #UcaCamera object
+ * @data: Pointer to a buffer large enough for @n_frames frames. Must not be
+ *  %NULL.
+ * @n_frames: Number of frames to grab
+ * @n_got: (out) (allow-none): Location to store the number of frames grabbed
+ *  or %NULL
+ * @timeout: Maximum time in seconds to wait for all frames or a negative value
+ *  to wait indefinitely
  * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Initiate recording of frames. If UcaCamera:grab-asynchronous is %TRUE and a
- * #UcaCameraGrabFunc callback is set, frames are automatically transfered to
- * the client program, otherwise you must use uca_camera_grab().
+ * Grab up to @n_frames frames and store them consecutively in @data. In
+ * buffered mode, all frames that are already in the ring buffer are copied in
+ * one go. Otherwise the frames are read from the camera one after another. If
+ * not all frames arrive within @timeout seconds, #UCA_CAMERA_ERROR_TIMEOUT is
+ * returned and @n_got contains the number of frames that were stored anyway.
+ * In unbuffered mode the timeout is only checked between frames.
+ *
+ * Returns: %TRUE if @n_frames frames were grabbed.
+ * Since: 2.5
  */
-void
-uca_camera_start_recording (UcaCamera *camera, GError **error)
+gboolean
+uca_camera_grab_many (UcaCamera *camera, gpointer data, guint n_frames,
+                      guint *n_got, gdouble timeout, GError **error)
 {
     UcaCameraClass *klass;
     UcaCameraPrivate *priv;
-    static GMutex mutex;
-    GError *tmp_error = NULL;
-    guint width, height, bitdepth;
-    guint pixel_size;
+    guint8 *dst;
+    gint64 end_time;
+    PythonLock python_lock;
+    guint n_grabbed = 0;
+    gboolean result = FALSE;
 
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
 
     klass = UCA_CAMERA_GET_CLASS (camera);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->start_recording != NULL);
+    g_return_val_if_fail (klass != NULL, FALSE);
+    g_return_val_if_fail (klass->grab != NULL || klass->grab_full != NULL, FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
 
     priv = camera->priv;
+    dst = (guint8 *) data;
+    end_time = timeout < 0.0 ? -1 : g_get_monotonic_time () + (gint64) (timeout * G_USEC_PER_SEC);
+    release_python_lock (&python_lock);
 
-    g_mutex_lock (&mutex);
+    if (!priv->buffered) {
+        gsize frame_size;
 
-    if (uca_camera_is_recording (camera)) {
-        priv->is_recording = TRUE;
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
-                     "Camera is already recording");
-        goto start_recording_unlock;
-    }
+        frame_size = uca_camera_get_frame_size (camera);
 
-    if (priv->buffered) {
-        g_object_get (camera,
-                      "roi-width", &width,
-                      "roi-height", &height,
-                      "sensor-bitdepth", &bitdepth,
-                      NULL);
+        g_mutex_lock (&priv->grab_lock);
 
-        pixel_size = bitdepth <= 8 ? 1 : 2;
-    }
+        if (!priv->is_recording && !priv->is_readout) {
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
+                         "Camera is neither recording nor in readout mode");
+        }
+        else {
+            result = grab_unbuffered_frames (camera, dst, frame_size, n_frames, &n_grabbed, end_time, error);
+        }
 
-    if (priv->transfer_async && (camera->grab_func == NULL)) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NO_GRAB_FUNC,
-                     "No grab callback function set");
-        goto start_recording_unlock;
+        g_mutex_unlock (&priv->grab_lock);
     }
+    else {
+        while (n_grabbed < n_frames) {
+            gpointer buffer;
+            gsize size;
 
-    g_mutex_lock (&access_lock);
-    (*klass->start_recording)(camera, &tmp_error);
-    g_mutex_unlock (&access_lock);
+            buffer = borrow_buffered_frame (camera, end_time, NULL, NULL, &size, TRUE, error);
 
-    if (tmp_error == NULL) {
-        priv->is_readout = FALSE;
-        priv->is_recording = TRUE;
-        priv->cancelling_recording = FALSE;
-        priv->cancelling_grab = FALSE;
-        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
-    }
-    else
-        g_propagate_error (error, tmp_error);
+            if (buffer == NULL)
+                break;
 
-    if (priv->buffered) {
-        priv->ring_buffer = uca_ring_buffer_new (width * height * pixel_size, priv->num_buffers);
-        /* Let's read out the frames from another thread */
-        priv->read_thread = g_thread_new ("read-thread", (GThreadFunc) buffer_thread, camera);
+            copy_frame (priv, dst + n_grabbed * size, buffer, size);
+            release_buffered_frame (priv, buffer, TRUE);
+            n_grabbed++;
+        }
+
+        result = n_grabbed == n_frames;
     }
 
-start_recording_unlock:
-    g_mutex_unlock (&mutex);
+    acquire_python_lock (&python_lock);
+
+    if (n_got != NULL)
+        *n_got = n_grabbed;
+
+    return result;
 }
 
 /**
- * uca_camera_stop_recording:
+ * uca_camera_grab_average:
  * @camera: A #UcaCamera object
+ * @average: (array): Location to store the mean of every pixel, large enough
+ *  for the frame geometry returned by uca_camera_get_frame_geometry()
+ * @n_frames: Number of frames to average
  * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Stop recording.
+ * Grab @n_frames frames with uca_camera_grab() and store the mean value of
+ * every pixel. This is meant for acquiring dark and flat references for a
+ * #UcaCorrectionFilter, which must not process the frames averaged for its own
+ * references. The mean has the layout of the grabbed frames, so
+ * #UcaCamera:apply-transform should be disabled as well. Packed pixel formats
+ * are not supported.
+ *
+ * Returns: %TRUE if all frames were grabbed.
+ * Since: 2.5
  */
-void
-uca_camera_stop_recording (UcaCamera *camera, GError **error)
+gboolean
+uca_camera_grab_average (UcaCamera *camera, gfloat *average, guint n_frames, GError **error)
 {
-    UcaCameraClass *klass;
-    UcaCameraPrivate *priv;
-    static GMutex mutex;
-    GError *tmp_error = NULL;
+    UcaCameraPixelFormat format;
+    guint width, height;
+    guint bits;
+    gsize n_pixels;
+    guint8 *frame;
+    guint64 *sums;
+    gboolean result = TRUE;
 
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (average != NULL, FALSE);
+    g_return_val_if_fail (n_frames > 0, FALSE);
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    uca_camera_get_frame_geometry (camera, &width, &height, &format);
+    bits = uca_camera_pixel_format_get_bits (format);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->stop_recording != NULL);
+    if (bits != 8 && bits != 16 && bits != 32) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE,
+                     "Cannot average frames with %u bit packed pixels", bits);
+        return FALSE;
+    }
 
-    priv = camera->priv;
+    n_pixels = (gsize) width * height;
+    frame = g_malloc (n_pixels * bits / 8);
+    sums = g_new0 (guint64, n_pixels);
 
-    g_mutex_lock (&mutex);
+    for (guint i = 0; i < n_frames; i++) {
+        result = uca_camera_grab (camera, frame, error);
 
-    if (!uca_camera_is_recording (camera)) {
-        priv->is_recording = FALSE;
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
-                     "Camera is not recording");
-        goto error_stop_recording;
-    }
+        if (!result)
+            break;
 
-    priv->cancelling_recording = TRUE;
+        if (bits == 8) {
+            for (gsize k = 0; k < n_pixels; k++)
+                sums[k] += frame[k];
+        }
+        else if (bits == 16) {
+            const guint16 *pixels = (const guint16 *) frame;
 
-    if (priv->buffered) {
-        g_thread_join (priv->read_thread);
-        priv->read_thread = NULL;
+            for (gsize k = 0; k < n_pixels; k++)
+                sums[k] += pixels[k];
+        }
+        else {
+            const guint32 *pixels = (const guint32 *) frame;
+
+            for (gsize k = 0; k < n_pixels; k++)
+                sums[k] += pixels[k];
+        }
     }
 
-    g_mutex_lock (&access_lock);
+    if (result) {
+        for (gsize k = 0; k < n_pixels; k++)
+            average[k] = (gfloat) ((gdouble) sums[k] / n_frames);
+    }
 
-    (*klass->stop_recording)(camera, &tmp_error);
-    priv->cancelling_recording = FALSE;
+    g_free (frame);
+    g_free (sums);
 
-    g_mutex_unlock (&access_lock);
+    return result;
+}
 
-    if (tmp_error == NULL) {
-        priv->is_recording = FALSE;
-        priv->is_readout = FALSE;
-        g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_RECORDING]);
-    }
-    else
-        g_propagate_error (error, tmp_error);
+/**
+ * uca_camera_grab_borrow:
+ * @camera: A #UcaCamera object
+ * @data: (out) (transfer none): Location to store a pointer to the frame
+ * @size: (out) (allow-none): Location to store the size of the frame in bytes
+ *  or %NULL
+ * @error: Location to store a #UcaCameraError error or %NULL
+ *
+ * Grab a single frame without copying it. In contrast to uca_camera_grab(),
+ * @data points directly into the internal ring buffer and must be treated as
+ * read-only. The frame is not overwritten until it is handed back with
+ * uca_camera_grab_release(). Frames can only be borrowed if #UcaCamera:buffered
+ * is %TRUE and must be released before calling uca_camera_stop_recording().
+ *
+ * Returns: %TRUE if a frame was borrowed.
+ * Since: 2.5
+ */
+gboolean
+uca_camera_grab_borrow (UcaCamera *camera, gconstpointer *data, gsize *size, GError **error)
+{
+    UcaCameraPrivate *priv;
+    PythonLock python_lock;
+    gpointer buffer;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
+
+    priv = camera->priv;
 
-    if (camera->priv->ring_buffer != NULL) {
-        g_object_unref (camera->priv->ring_buffer);
-        camera->priv->ring_buffer = NULL;
+    if (!priv->buffered) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "Frames can only be borrowed in buffered mode");
+        return FALSE;
     }
 
-error_stop_recording:
-    g_mutex_unlock (&mutex);
+    release_python_lock (&python_lock);
+    buffer = borrow_buffered_frame (camera, -1, NULL, NULL, size, FALSE, error);
+    acquire_python_lock (&python_lock);
+
+    *data = buffer;
+    return buffer != NULL;
+}
+
+/**
+ * uca_camera_grab_release:
+ * @camera: A #UcaCamera object
+ * @data: Frame returned by uca_camera_grab_borrow()
+ *
+ * Hand a borrowed frame back so that it can be overwritten by new frames. If
+ * more than one frame is borrowed, they can be released in any order.
+ *
+ * Since: 2.5
+ */
+void
+uca_camera_grab_release (UcaCamera *camera, gconstpointer data)
+{
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (data != NULL);
+
+    release_buffered_frame (camera->priv, (gpointer) data, FALSE);
 }
 
 /**
- * uca_camera_is_recording:
+ * uca_camera_add_consumer:
  * @camera: A #UcaCamera object
+ * @name: Unique name of the consumer
+ * @policy: What happens to frames the consumer has not read yet if the ring
+ *  buffer is full
  *
- * Convenience function to ask the current recording status
+ * Add a consumer that receives every buffered frame independently of
+ * uca_camera_grab() and all other consumers. Frames are borrowed with
+ * uca_camera_grab_borrow_from(). A consumer added during a recording starts
+ * with the next frame. With %UCA_RING_BUFFER_CURSOR_LOSSLESS, a slow consumer
+ * holds back acquisition according to #UcaCamera:ring-policy instead of
+ * missing frames.
  *
- * Return value: %TRUE if recording is ongoing
- * Since: 1.5
+ * Returns: %TRUE if the consumer was added, %FALSE if @name is already used or
+ * #UCA_RING_BUFFER_MAX_CURSORS consumers exist.
+ * Since: 2.5
  */
 gboolean
-uca_camera_is_recording (UcaCamera *camera)
+uca_camera_add_consumer (UcaCamera *camera, const gchar *name, UcaRingBufferCursorPolicy policy)
 {
-    gboolean result;
+    UcaCameraPrivate *priv;
+    gboolean result = FALSE;
+
     g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
-    g_object_get (camera, "is-recording", &result, NULL);
-    return result;
-}
+    g_return_val_if_fail (name != NULL, FALSE);
 
-static gboolean
-already_recording (UcaCamera *camera, GError **error)
-{
-    if (uca_camera_is_recording (camera)) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
-                     "Camera is still recording");
-        return TRUE;
+    priv = camera->priv;
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (!g_hash_table_contains (priv->consumers, name) &&
+        g_hash_table_size (priv->consumers) < UCA_RING_BUFFER_MAX_CURSORS) {
+        g_hash_table_insert (priv->consumers, g_strdup (name), GINT_TO_POINTER (policy));
+
+        if (priv->ring_buffer != NULL)
+            uca_ring_buffer_add_cursor (priv->ring_buffer, name, policy);
+
+        result = TRUE;
     }
-    return FALSE;
-}
 
-/**
- * uca_camera_stopped_recording:
- * @camera: A #UcaCamera object
- * 
- * Convenience function for plugin's to check if uca_camera_stop_recording() has been called.
- * 
- * Return value: %True if state is standby or transitioning from recording to standby
- */
-gboolean
-uca_camera_stopped_recording(UcaCamera *camera)
-{
-    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
-    return !uca_camera_is_recording (camera) || camera->priv->cancelling_recording;
+    g_mutex_unlock (&priv->buffer_lock);
+    return result;
 }
 
 /**
- * uca_camera_start_readout:
+ * uca_camera_remove_consumer:
  * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
+ * @name: Name of a consumer added with uca_camera_add_consumer()
  *
- * Initiate readout mode for cameras that support
- * #UcaCamera:has-camram-recording after calling
- * uca_camera_stop_recording(). Frames have to be picked up with
- * ufo_camera_grab().
+ * Remove a consumer. All frames it has borrowed must have been released.
+ *
+ * Since: 2.5
  */
 void
-uca_camera_start_readout (UcaCamera *camera, GError **error)
+uca_camera_remove_consumer (UcaCamera *camera, const gchar *name)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
-
-    g_return_if_fail (UCA_IS_CAMERA(camera));
+    UcaCameraPrivate *priv;
 
-    klass = UCA_CAMERA_GET_CLASS(camera);
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (name != NULL);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->start_readout != NULL);
+    priv = camera->priv;
+    g_mutex_lock (&priv->buffer_lock);
 
-    g_mutex_lock (&mutex);
+    if (priv->ring_buffer != NULL) {
+        UcaRingBufferCursor *cursor;
 
-    if (!already_recording (camera, error)) {
-        GError *tmp_error = NULL;
+        cursor = uca_ring_buffer_get_cursor (priv->ring_buffer, name);
 
-        g_mutex_lock (&access_lock);
-        (*klass->start_readout) (camera, &tmp_error);
-        g_mutex_unlock (&access_lock);
+        if (cursor != NULL) {
+            uca_ring_buffer_remove_cursor (priv->ring_buffer, cursor);
 
-        if (tmp_error == NULL) {
-            camera->priv->is_readout = TRUE;
-            g_object_notify_by_pspec (G_OBJECT (camera), camera_properties[PROP_IS_READOUT]);
+            /* The read thread may wait for this consumer */
+            if (priv->n_buffer_waiters > 0)
+                g_cond_broadcast (&priv->buffer_cond);
         }
-        else
-            g_propagate_error (error, tmp_error);
     }
 
-    g_mutex_unlock (&mutex);
+    g_hash_table_remove (priv->consumers, name);
+    g_mutex_unlock (&priv->buffer_lock);
 }
 
 /**
- * uca_camera_stop_readout:
+ * uca_camera_grab_borrow_from:
  * @camera: A #UcaCamera object
+ * @consumer: Name of a consumer added with uca_camera_add_consumer()
+ * @data: (out) (transfer none): Location to store a pointer to the frame
+ * @size: (out) (allow-none): Location to store the size of the frame in bytes
+ *  or %NULL
  * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Stop reading out frames.
+ * Like uca_camera_grab_borrow() but for a named consumer. Consumers only see
+ * frames that are in the ring buffer, frames that were spilled to disk with
+ * %UCA_CAMERA_RING_POLICY_SPILL are delivered to uca_camera_grab() only.
  *
- * Since: 1.1
+ * Returns: %TRUE if a frame was borrowed.
+ * Since: 2.5
  */
-void
-uca_camera_stop_readout (UcaCamera *camera, GError **error)
+gboolean
+uca_camera_grab_borrow_from (UcaCamera *camera, const gchar *consumer, gconstpointer *data,
+                             gsize *size, GError **error)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
+    UcaCameraPrivate *priv;
+    PythonLock python_lock;
+    gpointer buffer = NULL;
 
-    g_return_if_fail (UCA_IS_CAMERA(camera));
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (consumer != NULL, FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
 
-    klass = UCA_CAMERA_GET_CLASS(camera);
+    priv = camera->priv;
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->stop_readout != NULL);
+    if (!priv->buffered) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
+                     "Frames can only be borrowed in buffered mode");
+        return FALSE;
+    }
 
-    g_mutex_lock (&mutex);
+    release_python_lock (&python_lock);
+    g_mutex_lock (&priv->buffer_lock);
 
-    if (!already_recording (camera, error)) {
-        GError *tmp_error = NULL;
+    if (!g_hash_table_contains (priv->consumers, consumer)) {
+        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND,
+                     "Consumer `%s' does not exist", consumer);
+    }
+    else if (wait_for_frame (priv, consumer, -1, NULL, error)) {
+        UcaRingBufferCursor *cursor;
 
-        g_mutex_lock (&access_lock);
-        (*klass->stop_readout) (camera, &tmp_error);
-        g_mutex_unlock (&access_lock);
+        cursor = uca_ring_buffer_get_cursor (priv->ring_buffer, consumer);
+        buffer = uca_ring_buffer_cursor_borrow (priv->ring_buffer, cursor);
 
-        if (tmp_error == NULL) {
-            camera->priv->is_readout = FALSE;
-            g_object_notify (G_OBJECT (camera), "is-readout");
-        }
-        else
-            g_propagate_error (error, tmp_error);
+        if (buffer == NULL)
+            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
+                         "Ring buffer is empty");
+        else if (size != NULL)
+            *size = uca_ring_buffer_get_block_size (priv->ring_buffer);
     }
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&priv->buffer_lock);
+    acquire_python_lock (&python_lock);
+
+    *data = buffer;
+    return buffer != NULL;
 }
 
 /**
- * uca_camera_set_grab_func:
+ * uca_camera_grab_release_from:
  * @camera: A #UcaCamera object
- * @func: (scope call): A #UcaCameraGrabFunc callback function
- * @user_data: (closure): Data that is passed on to #func
+ * @consumer: Name of the consumer that borrowed @data
+ * @data: Frame returned by uca_camera_grab_borrow_from()
  *
- * Set the grab function that is called whenever a frame is readily transfered.
+ * Like uca_camera_grab_release() but for a named consumer.
+ *
+ * Since: 2.5
  */
 void
-uca_camera_set_grab_func(UcaCamera *camera, UcaCameraGrabFunc func, gpointer user_data)
+uca_camera_grab_release_from (UcaCamera *camera, const gchar *consumer, gconstpointer data)
 {
-    camera->grab_func = func;
-    camera->user_data = user_data;
+    UcaCameraPrivate *priv;
+    UcaRingBufferCursor *cursor = NULL;
+
+    g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (consumer != NULL);
+    g_return_if_fail (data != NULL);
+
+    priv = camera->priv;
+    g_mutex_lock (&priv->buffer_lock);
+
+    if (priv->ring_buffer != NULL)
+        cursor = uca_ring_buffer_get_cursor (priv->ring_buffer, consumer);
+
+    if (cursor != NULL) {
+        uca_ring_buffer_cursor_release (priv->ring_buffer, cursor, (gpointer) data);
+
+        if (priv->n_buffer_waiters > 0)
+            g_cond_broadcast (&priv->buffer_cond);
+    }
+
+    g_mutex_unlock (&priv->buffer_lock);
 }
 
 /**
- * uca_camera_trigger:
+ * uca_camera_get_frame_info:
  * @camera: A #UcaCamera object
- * @error: Location to store a #UcaCameraError error or %NULL
+ * @data: Frame returned by uca_camera_grab_borrow() or
+ *  uca_camera_grab_borrow_from() that has not been released yet
+ * @info: (out caller-allocates): Location to store the frame metadata
  *
- * Trigger from software if supported by camera.
+ * Get the metadata of a borrowed frame, which includes its statistics if
+ * #UcaCamera:statistics is enabled.
  *
- * You must have called uca_camera_start_recording() before, otherwise you will
- * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ * Returns: %TRUE if @info was filled in.
+ * Since: 2.5
  */
-void
-uca_camera_trigger (UcaCamera *camera, GError **error)
+gboolean
+uca_camera_get_frame_info (UcaCamera *camera, gconstpointer data, UcaFrameInfo *info)
 {
-    UcaCameraClass *klass;
-    static GMutex mutex;
-
-    g_return_if_fail (UCA_IS_CAMERA (camera));
+    UcaCameraPrivate *priv;
+    UcaFrameInfo *metadata = NULL;
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
+    g_return_val_if_fail (info != NULL, FALSE);
 
-    g_return_if_fail (klass != NULL);
-    g_return_if_fail (klass->trigger != NULL);
+    priv = camera->priv;
+    g_mutex_lock (&priv->buffer_lock);
 
-    g_mutex_lock (&mutex);
+    if (priv->ring_buffer != NULL)
+        metadata = get_buffered_frame_info (priv, (gpointer) data);
 
-    if (!camera->priv->is_recording) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING, "Camera is not recording");
-    }
-    else {
-        (*klass->trigger) (camera, error);
-    }
+    if (metadata != NULL)
+        memcpy (info, metadata, sizeof (UcaFrameInfo));
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&priv->buffer_lock);
+    return metadata != NULL;
 }
 
 /**
- * uca_camera_write:
+ * uca_camera_add_filter:
  * @camera: A #UcaCamera object
- * @name: String that identifies the written data.
- * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
- *  %NULL.
- * @size: Size of the data buffer in bytes.
- * @error: Location to store a #UcaCameraError or %NULL.
+ * @filter: A #UcaFilter
  *
- * Writes camera-specific @data containing @size bytes and identified by @name.
+ * Append @filter to the filters that process every recorded frame in place
+ * before consumers see it. In buffered mode, the filters run on
+ * #UcaCamera:filter-workers threads, otherwise in the thread that grabs the
+ * frame or on the #UcaCamera:async-workers. Changes take effect with the next
+ * recording.
+ *
+ * Since: 2.5
  */
 void
-uca_camera_write (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error)
+uca_camera_add_filter (UcaCamera *camera, UcaFilter *filter)
 {
-    UcaCameraClass *klass;
-
     g_return_if_fail (UCA_IS_CAMERA (camera));
+    g_return_if_fail (UCA_IS_FILTER (filter));
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+    g_mutex_lock (&camera->priv->control_lock);
+    g_ptr_array_add (camera->priv->filters, g_object_ref (filter));
+    g_mutex_unlock (&camera->priv->control_lock);
+}
 
-    g_return_if_fail (klass != NULL);
+/**
+ * uca_camera_clear_filters:
+ * @camera: A #UcaCamera object
+ *
+ * Remove all filters added with uca_camera_add_filter(). Changes take effect
+ * with the next recording.
+ *
+ * Since: 2.5
+ */
+void
+uca_camera_clear_filters (UcaCamera *camera)
+{
+    g_return_if_fail (UCA_IS_CAMERA (camera));
 
-    if (klass->write == NULL) {
-        g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_IMPLEMENTED,
-                     "`%s' does not provide a `write' method",
-                     G_OBJECT_TYPE_NAME (G_OBJECT (camera)));
-    }
-    else {
-        (*klass->write) (camera, name, data, size, error);
-    }
+    g_mutex_lock (&camera->priv->control_lock);
+    g_ptr_array_set_size (camera->priv->filters, 0);
+    g_mutex_unlock (&camera->priv->control_lock);
 }
 
 /**
- * uca_camera_grab:
+ * uca_camera_get_fd:
  * @camera: A #UcaCamera object
- * @data: (type gulong): Pointer to suitably sized data buffer. Must not be
- *  %NULL.
- * @error: Location to store a #UcaCameraError error or %NULL
  *
- * Grab a frame a single frame and store the result in @data.
+ * Get a file descriptor that is readable while uca_camera_grab() can return a
+ * buffered frame without blocking. It can be polled from any event loop
+ * instead of blocking in uca_camera_grab() on a separate thread. The descriptor
+ * is only signalled if #UcaCamera:buffered is %TRUE. It is owned by @camera and
+ * must neither be read nor closed.
  *
- * You must have called uca_camera_start_recording() before, otherwise you will
- * get a #UCA_CAMERA_ERROR_NOT_RECORDING error.
+ * Returns: A file descriptor or -1 if this is not supported on this platform.
+ * Since: 2.5
  */
-gboolean
-uca_camera_grab (UcaCamera *camera, gpointer data, GError **error)
+gint
+uca_camera_get_fd (UcaCamera *camera)
 {
-    UcaCameraClass *klass;
-    gboolean result = FALSE;
+    UcaCameraPrivate *priv;
+    gint fd;
 
-    /* FIXME: this prevents accessing two independent cameras simultanously. */
-    static GMutex mutex;
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), -1);
 
-    g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
+    priv = camera->priv;
+    g_mutex_lock (&priv->buffer_lock);
 
-    klass = UCA_CAMERA_GET_CLASS (camera);
+#ifdef G_OS_UNIX
+    if (priv->frame_fd < 0) {
+        gint fds[2] = { -1, -1 };
+        GError *error = NULL;
 
-    g_return_val_if_fail (klass != NULL, FALSE);
-    g_return_val_if_fail (klass->grab != NULL, FALSE);
-    g_return_val_if_fail (data != NULL, FALSE);
+#ifdef __linux__
+        fds[0] = fds[1] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (fds[0] < 0)
+            g_set_error (&error, G_IO_ERROR, g_io_error_from_errno (errno),
+                         "Could not create eventfd: %s", g_strerror (errno));
+#else
+        if (g_unix_open_pipe (fds, FD_CLOEXEC, &error) &&
+            g_unix_set_fd_nonblocking (fds[0], TRUE, &error))
+            g_unix_set_fd_nonblocking (fds[1], TRUE, &error);
+#endif
 
-    if (!camera->priv->buffered) {
-        g_mutex_lock (&mutex);
+        if (error == NULL) {
+            priv->frame_fd = fds[0];
+            g_atomic_int_set (&priv->frame_fd_write, fds[1]);
 
-        if (!camera->priv->is_recording && !camera->priv->is_readout) {
-            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
-                         "Camera is neither recording nor in readout mode");
+            if (priv->ring_buffer != NULL && frame_available (priv))
+                signal_frame_fd (priv);
         }
         else {
-#ifdef WITH_PYTHON_MULTITHREADING
-            if (Py_IsInitialized ()) {
-                PyGILState_STATE state = PyGILState_Ensure ();
-                Py_BEGIN_ALLOW_THREADS
+            g_warning ("Could not create frame descriptor: %s", error->message);
+            g_error_free (error);
 
-                g_mutex_lock (&access_lock);
-                result = (*klass->grab) (camera, data, error);
-                g_mutex_unlock (&access_lock);
+            if (fds[1] >= 0 && fds[1] != fds[0])
+                g_close (fds[1], NULL);
 
-                Py_END_ALLOW_THREADS
-                PyGILState_Release (state);
-            }
-            else {
-                g_mutex_lock (&access_lock);
-                result = (*klass->grab) (camera, data, error);
-                g_mutex_unlock (&access_lock);
-            }
-#else
-            g_mutex_lock (&access_lock);
-            result = (*klass->grab) (camera, data, error);
-            g_mutex_unlock (&access_lock);
-#endif
+            if (fds[0] >= 0)
+                g_close (fds[0], NULL);
         }
+    }
+#endif
 
-        g_mutex_unlock (&mutex);
+    fd = priv->frame_fd;
+    g_mutex_unlock (&priv->buffer_lock);
+    return fd;
+}
+
+#ifdef G_OS_UNIX
+typedef struct {
+    GSource source;
+    UcaCamera *camera;
+} UcaCameraSource;
+
+static gboolean
+camera_source_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
+{
+    if (callback == NULL) {
+        g_warning ("Camera source dispatched without callback, "
+                   "call g_source_set_callback()");
+        return FALSE;
     }
-    else {
-        gpointer buffer;
 
-        if (camera->priv->ring_buffer == NULL)
-            return FALSE;
+    return ((UcaCameraSourceFunc) callback) (((UcaCameraSource *) source)->camera, user_data);
+}
 
-        /*
-         * Spin-lock until we can read something. This shouldn't happen to
-         * often, as buffering is usually used in those cases when the camera is
-         * faster than the software.
-         */
-        while (!uca_ring_buffer_available (camera->priv->ring_buffer)) {
-            if (camera->priv->cancelling_grab) {
-                return FALSE;
-            }
-        }
+static void
+camera_source_finalize (GSource *source)
+{
+    g_object_unref (((UcaCameraSource *) source)->camera);
+}
 
-        buffer = uca_ring_buffer_get_read_pointer (camera->priv->ring_buffer);
+static GSourceFuncs camera_source_funcs = {
+    NULL,
+    NULL,
+    camera_source_dispatch,
+    camera_source_finalize,
+};
+#endif
 
-        if (buffer == NULL) {
-            g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_END_OF_STREAM,
-                         "Ring buffer is empty");
-        }
-        else {
-            memcpy (data, buffer, uca_ring_buffer_get_block_size (camera->priv->ring_buffer));
-            result = TRUE;
-        }
-    }
-    return result;
+/**
+ * uca_camera_create_source:
+ * @camera: A #UcaCamera object
+ *
+ * Create a #GSource that dispatches while a buffered frame is available. Set
+ * a #UcaCameraSourceFunc with g_source_set_callback() and attach it to a
+ * #GMainContext. The callback should grab at least one frame, otherwise it is
+ * called again right away.
+ *
+ * Returns: (transfer full): A new #GSource or %NULL if this is not supported on
+ * this platform.
+ * Since: 2.5
+ */
+GSource *
+uca_camera_create_source (UcaCamera *camera)
+{
+#ifdef G_OS_UNIX
+    GSource *source;
+    gint fd;
+
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+
+    fd = uca_camera_get_fd (camera);
+
+    if (fd < 0)
+        return NULL;
+
+    source = g_source_new (&camera_source_funcs, sizeof (UcaCameraSource));
+    ((UcaCameraSource *) source)->camera = g_object_ref (camera);
+    g_source_add_unix_fd (source, fd, G_IO_IN);
+    g_source_set_name (source, "UcaCameraSource");
+
+    return source;
+#else
+    g_return_val_if_fail (UCA_IS_CAMERA (camera), NULL);
+    return NULL;
+#endif
 }
 
 /**
@@ -1282,11 +5474,10 @@ gboolean
 uca_camera_readout (UcaCamera *camera, gpointer data, guint index, GError **error)
 {
     UcaCameraClass *klass;
+    UcaCameraPrivate *priv;
+    PythonLock python_lock;
     gboolean result = FALSE;
 
-    /* FIXME: this prevents accessing two independent cameras simultanously. */
-    static GMutex mutex;
-
     g_return_val_if_fail (UCA_IS_CAMERA(camera), FALSE);
 
     klass = UCA_CAMERA_GET_CLASS (camera);
@@ -1295,42 +5486,31 @@ uca_camera_readout (UcaCamera *camera, gpointer data, guint index, GError **erro
     g_return_val_if_fail (klass->readout != NULL, FALSE);
     g_return_val_if_fail (data != NULL, FALSE);
 
-    if (camera->priv->buffered) {
+    priv = camera->priv;
+
+    if (priv->buffered) {
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_RECORDING,
                      "Cannot grab specific frame in buffered mode");
         return FALSE;
     }
 
-    g_mutex_lock (&mutex);
+    release_python_lock (&python_lock);
+    g_mutex_lock (&priv->grab_lock);
 
-    if (!camera->priv->is_recording && !camera->priv->is_readout) {
+    if (!priv->is_recording && !priv->is_readout) {
         g_set_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING,
                      "Camera is not in readout or record mode");
     }
     else {
-        g_mutex_lock (&access_lock);
+        g_mutex_lock (&priv->device_lock);
 
-#ifdef WITH_PYTHON_MULTITHREADING
-        if (Py_IsInitialized ()) {
-            PyGILState_STATE state = PyGILState_Ensure ();
-            Py_BEGIN_ALLOW_THREADS
-
-            result = (*klass->readout) (camera, data, index, error);
-
-            Py_END_ALLOW_THREADS
-            PyGILState_Release (state);
-        }
-        else {
-            result = (*klass->readout) (camera, data, index, error);
-        }
-#else
         result = (*klass->readout) (camera, data, index, error);
-#endif
 
-        g_mutex_unlock (&access_lock);
+        g_mutex_unlock (&priv->device_lock);
     }
 
-    g_mutex_unlock (&mutex);
+    g_mutex_unlock (&priv->grab_lock);
+    acquire_python_lock (&python_lock);
 
     return result;
 }
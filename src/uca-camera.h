@@ -19,7 +19,11 @@
 #define __UCA_CAMERA_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include "uca-api.h"
+#include "uca-ring-buffer.h"
+#include "uca-transform.h"
+#include "uca-filter.h"
 
 G_BEGIN_DECLS
 
@@ -48,6 +52,7 @@ typedef enum {
     UCA_CAMERA_ERROR_END_OF_STREAM,
     UCA_CAMERA_ERROR_TIMEOUT,
     UCA_CAMERA_ERROR_DEVICE,
+    UCA_CAMERA_ERROR_INVALID_VALUE,
 } UcaCameraError;
 
 typedef enum {
@@ -61,6 +66,88 @@ typedef enum {
     UCA_CAMERA_TRIGGER_TYPE_LEVEL
 } UcaCameraTriggerType;
 
+/**
+ * UcaCameraRingPolicy:
+ * @UCA_CAMERA_RING_POLICY_DROP_OLDEST: Overwrite the oldest unread frame
+ * @UCA_CAMERA_RING_POLICY_DROP_NEWEST: Discard the frame that was just read
+ *  from the camera
+ * @UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER: Stop reading from the camera until
+ *  the consumer frees a buffer
+ * @UCA_CAMERA_RING_POLICY_SPILL: Write frames to a scratch file in
+ *  #UcaCamera:spill-directory until the consumer catches up. Frames are only
+ *  dropped if the disk cannot keep up. Behaves like
+ *  %UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER for asynchronous workers.
+ *
+ * Specifies what happens in buffered mode if the ring buffer is full.
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_CAMERA_RING_POLICY_DROP_OLDEST,
+    UCA_CAMERA_RING_POLICY_DROP_NEWEST,
+    UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER,
+    UCA_CAMERA_RING_POLICY_SPILL
+} UcaCameraRingPolicy;
+
+/**
+ * UcaCameraPixelFormat:
+ * @UCA_CAMERA_PIXEL_FORMAT_MONO8: One byte per pixel
+ * @UCA_CAMERA_PIXEL_FORMAT_MONO16: Two bytes per pixel in host byte order
+ * @UCA_CAMERA_PIXEL_FORMAT_MONO10P: 10-bit pixels packed into 5 bytes per 4
+ *  pixels
+ * @UCA_CAMERA_PIXEL_FORMAT_MONO12P: 12-bit pixels packed into 3 bytes per 2
+ *  pixels
+ * @UCA_CAMERA_PIXEL_FORMAT_MONO32: Four bytes per pixel in host byte order.
+ *  Only used for sums of #UcaCamera:accumulate-frames, cameras do not deliver
+ *  it.
+ *
+ * Memory layout of the frames returned by the camera. Packed frames form a
+ * continuous little-endian bit stream without row padding and can be expanded
+ * to 16 bit with uca_transform_unpack().
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_CAMERA_PIXEL_FORMAT_MONO8,
+    UCA_CAMERA_PIXEL_FORMAT_MONO16,
+    UCA_CAMERA_PIXEL_FORMAT_MONO10P,
+    UCA_CAMERA_PIXEL_FORMAT_MONO12P,
+    UCA_CAMERA_PIXEL_FORMAT_MONO32
+} UcaCameraPixelFormat;
+
+/**
+ * UcaCameraBinningMode:
+ * @UCA_CAMERA_BINNING_MODE_SATURATE: Keep the pixel size and clamp sums that
+ *  do not fit
+ * @UCA_CAMERA_BINNING_MODE_WIDEN: Store sums of 8-bit pixels in 16 bits.
+ *  16-bit sums still saturate.
+ *
+ * How #UcaCamera:software-horizontal-binning and
+ * #UcaCamera:software-vertical-binning combine pixels.
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_CAMERA_BINNING_MODE_SATURATE,
+    UCA_CAMERA_BINNING_MODE_WIDEN
+} UcaCameraBinningMode;
+
+/**
+ * UcaCameraAccumulateMode:
+ * @UCA_CAMERA_ACCUMULATE_MODE_MEAN: Store the rounded mean with the pixel size
+ *  of the accumulated frames
+ * @UCA_CAMERA_ACCUMULATE_MODE_SUM: Store the sums as
+ *  #UCA_CAMERA_PIXEL_FORMAT_MONO32 pixels
+ *
+ * How frames accumulated with #UcaCamera:accumulate-frames are stored.
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_CAMERA_ACCUMULATE_MODE_MEAN,
+    UCA_CAMERA_ACCUMULATE_MODE_SUM
+} UcaCameraAccumulateMode;
+
 typedef enum {
     UCA_UNIT_NA = 0,
     UCA_UNIT_METER,
@@ -70,6 +157,40 @@ typedef enum {
     UCA_UNIT_COUNT
 } UcaUnit;
 
+/**
+ * UcaFrameInfo:
+ * @sequence: Number of the frame since recording started. Frames dropped by
+ *  the ring buffer leave gaps in the sequence.
+ * @capture_time: Monotonic time in microseconds at which the frame was
+ *  acquired, see g_get_monotonic_time()
+ * @dequeue_time: Monotonic time in microseconds at which the frame was handed
+ *  to the caller
+ * @hardware_counter: Frame counter provided by the camera, only valid if
+ *  @has_hardware_counter is %TRUE
+ * @has_hardware_counter: %TRUE if the plugin provides @hardware_counter
+ * @n_accumulated: Number of camera frames summed into this frame, see
+ *  #UcaCamera:accumulate-frames
+ * @has_statistics: %TRUE if @statistics is valid, see #UcaCamera:statistics
+ * @statistics: Statistics of the frame as it is handed to the caller
+ *
+ * Metadata describing a single frame. The difference between @dequeue_time
+ * and @capture_time is the time the frame spent in the ring buffer. For
+ * accumulated frames, @capture_time refers to the last and @hardware_counter
+ * to the first of the summed frames.
+ *
+ * Since: 2.5
+ */
+typedef struct {
+    guint64 sequence;
+    gint64 capture_time;
+    gint64 dequeue_time;
+    guint64 hardware_counter;
+    gboolean has_hardware_counter;
+    guint n_accumulated;
+    gboolean has_statistics;
+    UcaFrameStatistics statistics;
+} UcaFrameInfo;
+
 typedef struct _UcaCamera           UcaCamera;
 typedef struct _UcaCameraClass      UcaCameraClass;
 typedef struct _UcaCameraPrivate    UcaCameraPrivate;
@@ -107,6 +228,34 @@ enum {
     PROP_NUM_BUFFERS,
     PROP_MIRROR,
     PROP_ROTATE,
+    PROP_RING_POLICY,
+    PROP_DROPPED_FRAMES,
+    PROP_ASYNC_WORKERS,
+    PROP_ASYNC_PRESERVE_ORDER,
+    PROP_BUFFER_ALIGNMENT,
+    PROP_BUFFER_HUGE_PAGES,
+    PROP_BUFFER_LOCK_MEMORY,
+    PROP_BUFFER_PREFAULT,
+    PROP_BUFFER_NUMA_NODE,
+    PROP_BUFFER_FILE,
+    PROP_SPILL_DIRECTORY,
+    PROP_MAX_BUFFER_MEMORY,
+    PROP_BUFFER_CAPACITY,
+    PROP_BUFFER_PEAK_FILL,
+    PROP_APPLY_TRANSFORM,
+    PROP_PIXEL_FORMAT,
+    PROP_SOFTWARE_HORIZONTAL_BINNING,
+    PROP_SOFTWARE_VERTICAL_BINNING,
+    PROP_SOFTWARE_BINNING_MODE,
+    PROP_SOFTWARE_ROI_X,
+    PROP_SOFTWARE_ROI_Y,
+    PROP_SOFTWARE_ROI_WIDTH,
+    PROP_SOFTWARE_ROI_HEIGHT,
+    PROP_FILTER_WORKERS,
+    PROP_ACCUMULATE_FRAMES,
+    PROP_ACCUMULATE_MODE,
+    PROP_STATISTICS,
+    PROP_STATISTICS_STEP,
     N_BASE_PROPERTIES
 };
 
@@ -121,6 +270,18 @@ UCA_API extern const gchar *uca_camera_props[N_BASE_PROPERTIES];
  */
 typedef void (*UcaCameraGrabFunc) (gpointer data, gpointer user_data);
 
+/**
+ * UcaCameraSourceFunc:
+ * @camera: the camera that has a frame available
+ * @user_data: user data passed to g_source_set_callback()
+ *
+ * Callback of a source created with uca_camera_create_source().
+ *
+ * Returns: %FALSE to remove the source
+ * Since: 2.5
+ */
+typedef gboolean (*UcaCameraSourceFunc) (UcaCamera *camera, gpointer user_data);
+
 struct _UcaCamera {
     /*< private >*/
     GObject parent;
@@ -148,6 +309,8 @@ struct _UcaCameraClass {
     void (*write)           (UcaCamera *camera, const gchar *name, gpointer data, gsize size, GError **error);
     gboolean (*grab)        (UcaCamera *camera, gpointer data, GError **error);
     gboolean (*readout)     (UcaCamera *camera, gpointer data, guint index, GError **error);
+    gboolean (*grab_full)   (UcaCamera *camera, gpointer data, UcaFrameInfo *info, GError **error);
+    gboolean (*apply_properties) (UcaCamera *camera, guint n_properties, GParamSpec **pspecs, const GValue *values, GError **error);
 };
 
 UCA_API UcaCamera * uca_camera_new      (const gchar        *type,
@@ -157,6 +320,10 @@ UCA_API gboolean    uca_camera_parse_arg_props
                                          gchar             **argv,
                                          guint               argc,
                                          GError            **error);
+UCA_API gboolean    uca_camera_apply_properties
+                                        (UcaCamera          *camera,
+                                         GHashTable         *properties,
+                                         GError            **error);
 UCA_API void        uca_camera_start_recording
                                         (UcaCamera          *camera,
                                          GError            **error);
@@ -167,6 +334,28 @@ UCA_API gboolean    uca_camera_is_recording
                                         (UcaCamera          *camera);
 UCA_API gboolean    uca_camera_stopped_recording
                                         (UcaCamera          *camera);
+UCA_API UcaCameraTriggerSource
+                    uca_camera_get_trigger_source
+                                        (UcaCamera          *camera);
+UCA_API void        uca_camera_get_roi  (UcaCamera          *camera,
+                                         guint              *x,
+                                         guint              *y,
+                                         guint              *width,
+                                         guint              *height);
+UCA_API guint       uca_camera_get_bitdepth
+                                        (UcaCamera          *camera);
+UCA_API UcaCameraPixelFormat
+                    uca_camera_get_pixel_format
+                                        (UcaCamera          *camera);
+UCA_API gsize       uca_camera_get_frame_size
+                                        (UcaCamera          *camera);
+UCA_API void        uca_camera_get_frame_geometry
+                                        (UcaCamera          *camera,
+                                         guint              *width,
+                                         guint              *height,
+                                         UcaCameraPixelFormat *format);
+UCA_API guint       uca_camera_pixel_format_get_bits
+                                        (UcaCameraPixelFormat format);
 UCA_API void        uca_camera_start_readout
                                         (UcaCamera          *camera,
                                          GError            **error);
@@ -183,6 +372,80 @@ UCA_API void        uca_camera_write    (UcaCamera          *camera,
 UCA_API gboolean    uca_camera_grab     (UcaCamera          *camera,
                                          gpointer            data,
                                          GError            **error);
+UCA_API gboolean    uca_camera_grab_full
+                                        (UcaCamera          *camera,
+                                         gpointer            data,
+                                         UcaFrameInfo       *info,
+                                         GError            **error);
+UCA_API gboolean    uca_camera_grab_timeout
+                                        (UcaCamera          *camera,
+                                         gpointer            data,
+                                         gdouble             timeout,
+                                         GError            **error);
+UCA_API void        uca_camera_grab_async
+                                        (UcaCamera          *camera,
+                                         gpointer            data,
+                                         GCancellable       *cancellable,
+                                         GAsyncReadyCallback callback,
+                                         gpointer            user_data);
+UCA_API gboolean    uca_camera_grab_finish
+                                        (UcaCamera          *camera,
+                                         GAsyncResult       *result,
+                                         GError            **error);
+UCA_API GCancellable *
+                    uca_camera_get_grab_cancellable
+                                        (UcaCamera          *camera);
+UCA_API gint64      uca_camera_get_grab_end_time
+                                        (UcaCamera          *camera);
+UCA_API gboolean    uca_camera_grab_many
+                                        (UcaCamera          *camera,
+                                         gpointer            data,
+                                         guint               n_frames,
+                                         guint              *n_got,
+                                         gdouble             timeout,
+                                         GError            **error);
+UCA_API gboolean    uca_camera_grab_average
+                                        (UcaCamera          *camera,
+                                         gfloat             *average,
+                                         guint               n_frames,
+                                         GError            **error);
+UCA_API gboolean    uca_camera_grab_borrow
+                                        (UcaCamera          *camera,
+                                         gconstpointer      *data,
+                                         gsize              *size,
+                                         GError            **error);
+UCA_API void        uca_camera_grab_release
+                                        (UcaCamera          *camera,
+                                         gconstpointer       data);
+UCA_API gboolean    uca_camera_add_consumer
+                                        (UcaCamera          *camera,
+                                         const gchar        *name,
+                                         UcaRingBufferCursorPolicy policy);
+UCA_API void        uca_camera_remove_consumer
+                                        (UcaCamera          *camera,
+                                         const gchar        *name);
+UCA_API gboolean    uca_camera_grab_borrow_from
+                                        (UcaCamera          *camera,
+                                         const gchar        *consumer,
+                                         gconstpointer      *data,
+                                         gsize              *size,
+                                         GError            **error);
+UCA_API void        uca_camera_grab_release_from
+                                        (UcaCamera          *camera,
+                                         const gchar        *consumer,
+                                         gconstpointer       data);
+UCA_API gboolean    uca_camera_get_frame_info
+                                        (UcaCamera          *camera,
+                                         gconstpointer       data,
+                                         UcaFrameInfo       *info);
+UCA_API void        uca_camera_add_filter
+                                        (UcaCamera          *camera,
+                                         UcaFilter          *filter);
+UCA_API void        uca_camera_clear_filters
+                                        (UcaCamera          *camera);
+UCA_API gint        uca_camera_get_fd   (UcaCamera          *camera);
+UCA_API GSource *   uca_camera_create_source
+                                        (UcaCamera          *camera);
 UCA_API gboolean    uca_camera_readout  (UcaCamera          *camera,
                                          gpointer            data,
                                          guint               index,
@@ -0,0 +1,629 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-correction-filter
+ * @Short_description: Dark-field, flat-field and defect correction
+ * @Title: UcaCorrectionFilter
+ *
+ * #UcaCorrectionFilter computes (raw - dark) / (flat - dark) * scale for every
+ * pixel and replaces defective pixels by the mean of their intact neighbours.
+ * The references are usually averages of frames recorded with the shutter
+ * closed and with an empty beam, see uca_camera_grab_average().
+ *
+ * Pixels are defective if they are set in the mask passed to
+ * uca_correction_filter_set_defects(), if their dark value exceeds
+ * #UcaCorrectionFilter:hot-pixel-threshold, if their flat value does not
+ * exceed their dark value or if their response, the flat minus the dark value,
+ * is less than a sixteenth of the mean response. Without a flat reference, only
+ * the dark reference is subtracted.
+ *
+ * When a recording starts, the references are turned into integer dark values
+ * and fixed-point gains, so that frames are corrected in place without
+ * floating point conversions. Negative results are clamped to zero and results
+ * beyond the range of the pixel type saturate. Changes of the references and
+ * properties take effect with the next recording.
+ * uca_correction_filter_correct_float() produces unclamped floating point
+ * results from the same references.
+ */
+
+#include <string.h>
+#include "uca-correction-filter.h"
+#include "uca-transform.h"
+
+#define UCA_CORRECTION_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_CORRECTION_FILTER, UcaCorrectionFilterPrivate))
+
+/*
+ * Pixels whose gain would exceed the mean gain by this factor are defective.
+ * Otherwise a single nearly dead pixel would dictate the fixed-point shift and
+ * leave too few fractional bits for all others.
+ */
+#define MAX_RELATIVE_GAIN 16.0
+
+static void uca_correction_filter_iface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaCorrectionFilter, uca_correction_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_correction_filter_iface_init))
+
+enum {
+    PROP_0,
+    PROP_SCALE,
+    PROP_HOT_PIXEL_THRESHOLD,
+    N_PROPERTIES
+};
+
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+typedef struct {
+    gpointer data;
+    guint width;
+    guint height;
+} Reference;
+
+typedef struct {
+    gsize index;
+    guint n_neighbours;
+    gsize neighbours[8];
+} Defect;
+
+struct _UcaCorrectionFilterPrivate {
+    GMutex lock;
+    Reference dark;
+    Reference flat;
+    Reference defects;
+    gdouble scale;
+    guint hot_pixel_threshold;
+
+    /* Prepared by setup for frames of this geometry */
+    guint width;
+    guint height;
+    guint pixel_size;
+    guint shift;
+    guint16 *fixed_dark;
+    guint16 *fixed_gain;
+    gfloat *float_dark;
+    gfloat *float_gain;
+    GArray *defect_list;
+};
+
+static void
+reference_set (Reference *reference, gconstpointer data, gsize element_size, guint width, guint height)
+{
+    gsize size = (gsize) width * height * element_size;
+
+    g_free (reference->data);
+    reference->data = NULL;
+    reference->width = width;
+    reference->height = height;
+
+    if (data != NULL && size > 0) {
+        reference->data = g_malloc (size);
+        memcpy (reference->data, data, size);
+    }
+}
+
+static gboolean
+reference_check (const Reference *reference, const gchar *name, guint width, guint height, GError **error)
+{
+    if (reference->data != NULL && (reference->width != width || reference->height != height)) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_REFERENCE,
+                     "%s reference has %ux%u pixels but frames have %ux%u",
+                     name, reference->width, reference->height, width, height);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+free_tables (UcaCorrectionFilterPrivate *priv)
+{
+    g_free (priv->fixed_dark);
+    g_free (priv->fixed_gain);
+    g_free (priv->float_dark);
+    g_free (priv->float_gain);
+
+    if (priv->defect_list != NULL)
+        g_array_unref (priv->defect_list);
+
+    priv->fixed_dark = NULL;
+    priv->fixed_gain = NULL;
+    priv->float_dark = NULL;
+    priv->float_gain = NULL;
+    priv->defect_list = NULL;
+}
+
+/*
+ * Collect the intact pixels of the 8-neighbourhood of every defective pixel.
+ * Their values are corrected before the defects are filled in, so the order in
+ * which defects are replaced does not matter.
+ */
+static GArray *
+find_defects (const guint8 *bad, guint width, guint height)
+{
+    GArray *list;
+
+    list = g_array_new (FALSE, FALSE, sizeof (Defect));
+
+    for (guint y = 0; y < height; y++) {
+        for (guint x = 0; x < width; x++) {
+            Defect defect;
+
+            defect.index = (gsize) y * width + x;
+            defect.n_neighbours = 0;
+
+            if (!bad[defect.index])
+                continue;
+
+            for (gint dy = -1; dy <= 1; dy++) {
+                for (gint dx = -1; dx <= 1; dx++) {
+                    gint nx = (gint) x + dx;
+                    gint ny = (gint) y + dy;
+                    gsize index;
+
+                    if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= (gint) width || ny >= (gint) height)
+                        continue;
+
+                    index = (gsize) ny * width + nx;
+
+                    if (!bad[index])
+                        defect.neighbours[defect.n_neighbours++] = index;
+                }
+            }
+
+            g_array_append_val (list, defect);
+        }
+    }
+
+    return list;
+}
+
+static gboolean
+uca_correction_filter_setup (UcaFilter *filter, guint width, guint height, guint pixel_size, GError **error)
+{
+    UcaCorrectionFilterPrivate *priv;
+    const gfloat *dark;
+    const gfloat *flat;
+    const guint8 *defects;
+    guint8 *bad;
+    gsize n_pixels;
+    gdouble scale;
+    gdouble max_gain = 0.0;
+    guint shift = 16;
+
+    priv = UCA_CORRECTION_FILTER (filter)->priv;
+
+    if (pixel_size != 1 && pixel_size != 2) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_UNSUPPORTED,
+                     "Correction filter only supports 8 and 16 bit pixels");
+        return FALSE;
+    }
+
+    g_mutex_lock (&priv->lock);
+
+    if (!reference_check (&priv->dark, "Dark", width, height, error) ||
+        !reference_check (&priv->flat, "Flat", width, height, error) ||
+        !reference_check (&priv->defects, "Defect", width, height, error)) {
+        g_mutex_unlock (&priv->lock);
+        return FALSE;
+    }
+
+    free_tables (priv);
+    n_pixels = (gsize) width * height;
+    dark = priv->dark.data;
+    flat = priv->flat.data;
+    defects = priv->defects.data;
+    bad = g_malloc0 (n_pixels);
+
+    priv->width = width;
+    priv->height = height;
+    priv->pixel_size = pixel_size;
+    priv->fixed_dark = g_new (guint16, n_pixels);
+    priv->fixed_gain = g_new (guint16, n_pixels);
+    priv->float_dark = g_new (gfloat, n_pixels);
+    priv->float_gain = g_new (gfloat, n_pixels);
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        priv->float_dark[i] = dark != NULL ? dark[i] : 0.0f;
+
+        if (defects != NULL && defects[i])
+            bad[i] = 1;
+
+        if (dark != NULL && priv->hot_pixel_threshold > 0 && dark[i] > priv->hot_pixel_threshold)
+            bad[i] = 1;
+
+        /* Also catches NaN */
+        if (flat != NULL && !(flat[i] > priv->float_dark[i]))
+            bad[i] = 1;
+    }
+
+    if (flat != NULL) {
+        gdouble sum = 0.0;
+        gsize n_good = 0;
+
+        for (gsize i = 0; i < n_pixels; i++) {
+            if (!bad[i]) {
+                sum += flat[i] - priv->float_dark[i];
+                n_good++;
+            }
+        }
+
+        if (n_good > 0) {
+            gdouble min_response = sum / n_good / MAX_RELATIVE_GAIN;
+
+            for (gsize i = 0; i < n_pixels; i++) {
+                if (flat[i] - priv->float_dark[i] < min_response)
+                    bad[i] = 1;
+            }
+        }
+    }
+
+    scale = priv->scale;
+
+    if (scale <= 0.0 && flat != NULL) {
+        gdouble sum = 0.0;
+        gsize n_good = 0;
+
+        /* Keep the mean intensity of the flat field */
+        for (gsize i = 0; i < n_pixels; i++) {
+            if (!bad[i]) {
+                sum += flat[i] - priv->float_dark[i];
+                n_good++;
+            }
+        }
+
+        scale = n_good > 0 ? sum / n_good : 1.0;
+    }
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        gfloat gain = 0.0f;
+
+        if (!bad[i])
+            gain = flat != NULL ? (gfloat) (scale / (flat[i] - priv->float_dark[i])) : 1.0f;
+
+        priv->float_gain[i] = gain;
+        max_gain = MAX (max_gain, gain);
+    }
+
+    /* Use as many fractional bits as the largest gain allows */
+    while (shift > 0 && max_gain * (1 << shift) > G_MAXUINT16)
+        shift--;
+
+    priv->shift = shift;
+
+    for (gsize i = 0; i < n_pixels; i++) {
+        gdouble fixed_dark = CLAMP (priv->float_dark[i], 0.0, G_MAXUINT16);
+        gdouble fixed_gain = CLAMP (priv->float_gain[i] * (1 << shift), 0.0, G_MAXUINT16);
+
+        priv->fixed_dark[i] = (guint16) (fixed_dark + 0.5);
+        priv->fixed_gain[i] = (guint16) (fixed_gain + 0.5);
+    }
+
+    priv->defect_list = find_defects (bad, width, height);
+
+    g_mutex_unlock (&priv->lock);
+    g_free (bad);
+
+    return TRUE;
+}
+
+static gboolean
+check_set_up (UcaCorrectionFilterPrivate *priv, guint width, guint height, guint pixel_size, GError **error)
+{
+    if (priv->fixed_dark == NULL || priv->width != width || priv->height != height ||
+        priv->pixel_size != pixel_size) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_NOT_SET_UP,
+                     "Correction filter was not set up for %ux%u frames with %u byte pixels",
+                     width, height, pixel_size);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+#define DEFINE_FILL_DEFECTS(suffix, type, sum_type, round)                      \
+static void                                                                     \
+fill_defects_##suffix (type *data, GArray *list)                                \
+{                                                                               \
+    for (guint i = 0; i < list->len; i++) {                                     \
+        const Defect *defect = &g_array_index (list, Defect, i);                \
+        sum_type sum = 0;                                                       \
+                                                                                \
+        if (defect->n_neighbours == 0)                                          \
+            continue;                                                           \
+                                                                                \
+        for (guint k = 0; k < defect->n_neighbours; k++)                        \
+            sum += data[defect->neighbours[k]];                                 \
+                                                                                \
+        data[defect->index] = (type) ((sum + round) / defect->n_neighbours);    \
+    }                                                                           \
+}
+
+DEFINE_FILL_DEFECTS (8, guint8, guint32, defect->n_neighbours / 2)
+DEFINE_FILL_DEFECTS (16, guint16, guint32, defect->n_neighbours / 2)
+DEFINE_FILL_DEFECTS (float, gfloat, gfloat, 0)
+
+static gboolean
+uca_correction_filter_process (UcaFilter *filter, gpointer data, guint width, guint height,
+                               guint pixel_size, GError **error)
+{
+    UcaCorrectionFilterPrivate *priv;
+
+    priv = UCA_CORRECTION_FILTER (filter)->priv;
+    g_mutex_lock (&priv->lock);
+
+    if (!check_set_up (priv, width, height, pixel_size, error)) {
+        g_mutex_unlock (&priv->lock);
+        return FALSE;
+    }
+
+    uca_transform_correct (data, data, priv->fixed_dark, priv->fixed_gain,
+                           (gsize) width * height, priv->shift, pixel_size);
+
+    if (pixel_size == 1)
+        fill_defects_8 (data, priv->defect_list);
+    else
+        fill_defects_16 (data, priv->defect_list);
+
+    g_mutex_unlock (&priv->lock);
+    return TRUE;
+}
+
+/**
+ * uca_correction_filter_new:
+ *
+ * Create a new correction filter without references.
+ *
+ * Return value: (transfer full): A new #UcaFilter
+ * Since: 2.5
+ */
+UcaFilter *
+uca_correction_filter_new (void)
+{
+    return g_object_new (UCA_TYPE_CORRECTION_FILTER, NULL);
+}
+
+/**
+ * uca_correction_filter_set_dark:
+ * @filter: A #UcaCorrectionFilter
+ * @dark: (array) (allow-none): @width times @height dark values or %NULL
+ * @width: Width of @dark
+ * @height: Height of @dark
+ *
+ * Set the dark reference, which is copied. %NULL removes the reference.
+ *
+ * Since: 2.5
+ */
+void
+uca_correction_filter_set_dark (UcaCorrectionFilter *filter, const gfloat *dark, guint width, guint height)
+{
+    g_return_if_fail (UCA_IS_CORRECTION_FILTER (filter));
+
+    g_mutex_lock (&filter->priv->lock);
+    reference_set (&filter->priv->dark, dark, sizeof (gfloat), width, height);
+    g_mutex_unlock (&filter->priv->lock);
+}
+
+/**
+ * uca_correction_filter_set_flat:
+ * @filter: A #UcaCorrectionFilter
+ * @flat: (array) (allow-none): @width times @height flat values or %NULL
+ * @width: Width of @flat
+ * @height: Height of @flat
+ *
+ * Set the flat reference, which is copied. %NULL removes the reference.
+ *
+ * Since: 2.5
+ */
+void
+uca_correction_filter_set_flat (UcaCorrectionFilter *filter, const gfloat *flat, guint width, guint height)
+{
+    g_return_if_fail (UCA_IS_CORRECTION_FILTER (filter));
+
+    g_mutex_lock (&filter->priv->lock);
+    reference_set (&filter->priv->flat, flat, sizeof (gfloat), width, height);
+    g_mutex_unlock (&filter->priv->lock);
+}
+
+/**
+ * uca_correction_filter_set_defects:
+ * @filter: A #UcaCorrectionFilter
+ * @mask: (array) (allow-none): @width times @height values that are non-zero
+ *  for defective pixels or %NULL
+ * @width: Width of @mask
+ * @height: Height of @mask
+ *
+ * Set the map of known defective pixels, which is copied. %NULL removes the
+ * map.
+ *
+ * Since: 2.5
+ */
+void
+uca_correction_filter_set_defects (UcaCorrectionFilter *filter, const guint8 *mask, guint width, guint height)
+{
+    g_return_if_fail (UCA_IS_CORRECTION_FILTER (filter));
+
+    g_mutex_lock (&filter->priv->lock);
+    reference_set (&filter->priv->defects, mask, 1, width, height);
+    g_mutex_unlock (&filter->priv->lock);
+}
+
+/**
+ * uca_correction_filter_correct_float:
+ * @filter: A #UcaCorrectionFilter
+ * @src: (type gulong): Frame to correct
+ * @dst: Location to store @width times @height corrected pixels
+ * @width: Width of the frame in pixels
+ * @height: Height of the frame in pixels
+ * @pixel_size: Number of bytes per pixel of @src, either 1 or 2
+ * @error: Location to store an error or %NULL
+ *
+ * Correct @src like the filter does, but without rounding, clamping or
+ * saturation. @filter must have been set up for frames of this geometry, either
+ * by a recording or by uca_filter_setup().
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.5
+ */
+gboolean
+uca_correction_filter_correct_float (UcaCorrectionFilter *filter, gconstpointer src, gfloat *dst,
+                                     guint width, guint height, guint pixel_size, GError **error)
+{
+    UcaCorrectionFilterPrivate *priv;
+    gsize n_pixels;
+
+    g_return_val_if_fail (UCA_IS_CORRECTION_FILTER (filter), FALSE);
+    g_return_val_if_fail (src != NULL && dst != NULL, FALSE);
+
+    priv = filter->priv;
+    g_mutex_lock (&priv->lock);
+
+    if (!check_set_up (priv, width, height, pixel_size, error)) {
+        g_mutex_unlock (&priv->lock);
+        return FALSE;
+    }
+
+    n_pixels = (gsize) width * height;
+
+    if (pixel_size == 1) {
+        const guint8 *pixels = src;
+
+        for (gsize i = 0; i < n_pixels; i++)
+            dst[i] = (pixels[i] - priv->float_dark[i]) * priv->float_gain[i];
+    }
+    else {
+        const guint16 *pixels = src;
+
+        for (gsize i = 0; i < n_pixels; i++)
+            dst[i] = (pixels[i] - priv->float_dark[i]) * priv->float_gain[i];
+    }
+
+    fill_defects_float (dst, priv->defect_list);
+
+    g_mutex_unlock (&priv->lock);
+    return TRUE;
+}
+
+static void
+uca_correction_filter_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaCorrectionFilterPrivate *priv = UCA_CORRECTION_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_SCALE:
+            g_value_set_double (value, priv->scale);
+            break;
+        case PROP_HOT_PIXEL_THRESHOLD:
+            g_value_set_uint (value, priv->hot_pixel_threshold);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_correction_filter_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaCorrectionFilterPrivate *priv = UCA_CORRECTION_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_SCALE:
+            priv->scale = g_value_get_double (value);
+            break;
+        case PROP_HOT_PIXEL_THRESHOLD:
+            priv->hot_pixel_threshold = g_value_get_uint (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_correction_filter_finalize (GObject *object)
+{
+    UcaCorrectionFilterPrivate *priv = UCA_CORRECTION_FILTER (object)->priv;
+
+    free_tables (priv);
+    g_free (priv->dark.data);
+    g_free (priv->flat.data);
+    g_free (priv->defects.data);
+    g_mutex_clear (&priv->lock);
+
+    G_OBJECT_CLASS (uca_correction_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_correction_filter_iface_init (UcaFilterInterface *iface)
+{
+    iface->setup = uca_correction_filter_setup;
+    iface->process = uca_correction_filter_process;
+}
+
+static void
+uca_correction_filter_class_init (UcaCorrectionFilterClass *klass)
+{
+    GObjectClass *oclass;
+
+    oclass = G_OBJECT_CLASS (klass);
+    oclass->get_property = uca_correction_filter_get_property;
+    oclass->set_property = uca_correction_filter_set_property;
+    oclass->finalize = uca_correction_filter_finalize;
+
+    /**
+     * UcaCorrectionFilter:scale:
+     *
+     * Factor applied after dividing by the flat reference. If 0, the mean of
+     * flat minus dark over all intact pixels is used, which keeps the
+     * intensity of the flat field.
+     */
+    properties[PROP_SCALE] =
+        g_param_spec_double ("scale",
+                             "Scale",
+                             "Factor applied after dividing by the flat reference, 0 for automatic",
+                             0.0, G_MAXDOUBLE, 0.0,
+                             G_PARAM_READWRITE);
+
+    /**
+     * UcaCorrectionFilter:hot-pixel-threshold:
+     *
+     * Pixels with a dark value above this threshold are treated as defective.
+     * 0 disables the check.
+     */
+    properties[PROP_HOT_PIXEL_THRESHOLD] =
+        g_param_spec_uint ("hot-pixel-threshold",
+                           "Hot pixel threshold",
+                           "Dark value above which pixels are defective, 0 to disable",
+                           0, G_MAXUINT16, 0,
+                           G_PARAM_READWRITE);
+
+    for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
+        g_object_class_install_property (oclass, i, properties[i]);
+
+    g_type_class_add_private (klass, sizeof (UcaCorrectionFilterPrivate));
+}
+
+static void
+uca_correction_filter_init (UcaCorrectionFilter *filter)
+{
+    filter->priv = UCA_CORRECTION_FILTER_GET_PRIVATE (filter);
+    g_mutex_init (&filter->priv->lock);
+    filter->priv->scale = 0.0;
+    filter->priv->hot_pixel_threshold = 0;
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef UCA_CORRECTION_FILTER_H
+#define UCA_CORRECTION_FILTER_H
+
+#include <glib-object.h>
+#include "uca-api.h"
+#include "uca-filter.h"
+
+#define UCA_TYPE_CORRECTION_FILTER             (uca_correction_filter_get_type())
+#define UCA_CORRECTION_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_CORRECTION_FILTER, UcaCorrectionFilter))
+#define UCA_IS_CORRECTION_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_CORRECTION_FILTER))
+#define UCA_CORRECTION_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_CORRECTION_FILTER, UcaCorrectionFilterClass))
+#define UCA_IS_CORRECTION_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_CORRECTION_FILTER))
+#define UCA_CORRECTION_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_CORRECTION_FILTER, UcaCorrectionFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaCorrectionFilter           UcaCorrectionFilter;
+typedef struct _UcaCorrectionFilterClass      UcaCorrectionFilterClass;
+typedef struct _UcaCorrectionFilterPrivate    UcaCorrectionFilterPrivate;
+
+struct _UcaCorrectionFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaCorrectionFilterPrivate *priv;
+};
+
+struct _UcaCorrectionFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UCA_API UcaFilter * uca_correction_filter_new (void);
+UCA_API void        uca_correction_filter_set_dark
+                                        (UcaCorrectionFilter    *filter,
+                                         const gfloat           *dark,
+                                         guint                   width,
+                                         guint                   height);
+UCA_API void        uca_correction_filter_set_flat
+                                        (UcaCorrectionFilter    *filter,
+                                         const gfloat           *flat,
+                                         guint                   width,
+                                         guint                   height);
+UCA_API void        uca_correction_filter_set_defects
+                                        (UcaCorrectionFilter    *filter,
+                                         const guint8           *mask,
+                                         guint                   width,
+                                         guint                   height);
+UCA_API gboolean    uca_correction_filter_correct_float
+                                        (UcaCorrectionFilter    *filter,
+                                         gconstpointer           src,
+                                         gfloat                 *dst,
+                                         guint                   width,
+                                         guint                   height,
+                                         guint                   pixel_size,
+                                         GError                **error);
+UCA_API GType       uca_correction_filter_get_type
+                                        (void);
+
+G_END_DECLS
+
+#endif
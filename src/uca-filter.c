@@ -0,0 +1,106 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-filter
+ * @Short_description: Frame processing stage
+ * @Title: UcaFilter
+ *
+ * A #UcaFilter modifies frames in place after they have been grabbed and
+ * before consumers see them. Filters are chained on a camera with
+ * uca_camera_add_filter(). In buffered mode, a pool of worker threads runs the
+ * chain on several frames at once, hence implementations of
+ * #UcaFilterInterface.process must be reentrant. Frames are still delivered
+ * in the order they were grabbed.
+ *
+ * Frames are unpacked 8 or 16 bit pixels in row-major order with the geometry
+ * returned by uca_camera_get_frame_geometry().
+ */
+
+#include "uca-filter.h"
+
+G_DEFINE_INTERFACE (UcaFilter, uca_filter, G_TYPE_OBJECT)
+
+GQuark
+uca_filter_error_quark (void)
+{
+    return g_quark_from_static_string ("uca-filter-error-quark");
+}
+
+static void
+uca_filter_default_init (UcaFilterInterface *iface)
+{
+}
+
+/**
+ * uca_filter_setup:
+ * @filter: A #UcaFilter
+ * @width: Width of the frames in pixels
+ * @height: Height of the frames in pixels
+ * @pixel_size: Number of bytes per pixel, either 1 or 2
+ * @error: Location to store an error or %NULL
+ *
+ * Prepare @filter for frames of the given geometry. Filters without a setup
+ * function accept any geometry.
+ *
+ * Returns: %TRUE if @filter can process such frames.
+ * Since: 2.5
+ */
+gboolean
+uca_filter_setup (UcaFilter *filter, guint width, guint height, guint pixel_size, GError **error)
+{
+    UcaFilterInterface *iface;
+
+    g_return_val_if_fail (UCA_IS_FILTER (filter), FALSE);
+
+    iface = UCA_FILTER_GET_INTERFACE (filter);
+
+    if (iface->setup == NULL)
+        return TRUE;
+
+    return iface->setup (filter, width, height, pixel_size, error);
+}
+
+/**
+ * uca_filter_process:
+ * @filter: A #UcaFilter
+ * @data: Frame to process in place
+ * @width: Width of the frame in pixels
+ * @height: Height of the frame in pixels
+ * @pixel_size: Number of bytes per pixel, either 1 or 2
+ * @error: Location to store an error or %NULL
+ *
+ * Process a single frame. This may be called concurrently for different
+ * frames.
+ *
+ * Returns: %TRUE on success.
+ * Since: 2.5
+ */
+gboolean
+uca_filter_process (UcaFilter *filter, gpointer data, guint width, guint height,
+                    guint pixel_size, GError **error)
+{
+    UcaFilterInterface *iface;
+
+    g_return_val_if_fail (UCA_IS_FILTER (filter), FALSE);
+    g_return_val_if_fail (data != NULL, FALSE);
+
+    iface = UCA_FILTER_GET_INTERFACE (filter);
+    g_return_val_if_fail (iface->process != NULL, FALSE);
+
+    return iface->process (filter, data, width, height, pixel_size, error);
+}
@@ -0,0 +1,95 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef UCA_FILTER_H
+#define UCA_FILTER_H
+
+#include <glib-object.h>
+#include "uca-api.h"
+
+G_BEGIN_DECLS
+
+#define UCA_TYPE_FILTER                 (uca_filter_get_type())
+#define UCA_FILTER(obj)                 (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_FILTER, UcaFilter))
+#define UCA_IS_FILTER(obj)              (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_FILTER))
+#define UCA_FILTER_GET_INTERFACE(obj)   (G_TYPE_INSTANCE_GET_INTERFACE((obj), UCA_TYPE_FILTER, UcaFilterInterface))
+
+#define UCA_FILTER_ERROR    uca_filter_error_quark()
+
+UCA_API GQuark uca_filter_error_quark (void);
+
+/**
+ * UcaFilterError:
+ * @UCA_FILTER_ERROR_UNSUPPORTED: The filter cannot process frames of the
+ *  given geometry
+ * @UCA_FILTER_ERROR_NOT_SET_UP: The filter was not set up for the frame
+ * @UCA_FILTER_ERROR_REFERENCE: Reference data does not match the frames
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_FILTER_ERROR_UNSUPPORTED,
+    UCA_FILTER_ERROR_NOT_SET_UP,
+    UCA_FILTER_ERROR_REFERENCE
+} UcaFilterError;
+
+typedef struct _UcaFilter           UcaFilter;
+typedef struct _UcaFilterInterface  UcaFilterInterface;
+
+/**
+ * UcaFilterInterface:
+ * @parent_iface: The parent interface
+ * @setup: Prepare for frames of the given geometry. Called once at the start
+ *  of every recording.
+ * @process: Process a frame in place. May be called from several threads at
+ *  once for different frames.
+ *
+ * Since: 2.5
+ */
+struct _UcaFilterInterface {
+    GTypeInterface parent_iface;
+
+    gboolean (*setup)   (UcaFilter  *filter,
+                         guint       width,
+                         guint       height,
+                         guint       pixel_size,
+                         GError    **error);
+    gboolean (*process) (UcaFilter  *filter,
+                         gpointer    data,
+                         guint       width,
+                         guint       height,
+                         guint       pixel_size,
+                         GError    **error);
+};
+
+UCA_API gboolean    uca_filter_setup    (UcaFilter  *filter,
+                                         guint       width,
+                                         guint       height,
+                                         guint       pixel_size,
+                                         GError    **error);
+UCA_API gboolean    uca_filter_process  (UcaFilter  *filter,
+                                         gpointer    data,
+                                         guint       width,
+                                         guint       height,
+                                         guint       pixel_size,
+                                         GError    **error);
+
+UCA_API GType       uca_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -15,32 +15,421 @@
    with this library; if not, write to the Free Software Foundation, Inc., 51
    Franklin St, Fifth Floor, Boston, MA 02110, USA */
 
+/**
+ * SECTION:uca-ring-buffer
+ * @Short_description: Ring buffer for frames
+ * @Title: UcaRingBuffer
+ *
+ * #UcaRingBuffer is a fixed-size queue of equally sized blocks. One producer
+ * thread and one consumer thread may access the buffer concurrently without
+ * locking. The producer fills the block returned by
+ * uca_ring_buffer_get_write_pointer() and publishes it with
+ * uca_ring_buffer_write_advance(), the consumer borrows and releases published
+ * blocks in order.
+ *
+ * Positions are tracked with 64-bit sequence numbers that never wrap in
+ * practice. The producer owns the write sequence. The consumer owns the read
+ * sequence and the number of borrowed blocks, except that the producer may
+ * claim the oldest unread block with a compare-and-swap on the read sequence
+ * when it has to overwrite it.
+ *
+ * Additional consumers can read the same blocks through named cursors created
+ * with uca_ring_buffer_add_cursor(). Every cursor has its own read sequence and
+ * borrowed blocks and is used by one thread. A block is only recycled once all
+ * cursors are past it. Depending on its #UcaRingBufferCursorPolicy, the
+ * producer either waits for a cursor or moves it forward.
+ *
+ * If #UcaRingBuffer:file-name is set, the blocks are stored in a shared
+ * mapping of that file instead of anonymous memory, so that recordings can
+ * exceed the physical memory and remain on disk after the process exits. The
+ * file starts with a header page holding the magic string "UCARING1" followed
+ * by the block size, the number of blocks, the number of blocks written so far
+ * and the offset of the first block, all as native 64-bit unsigned integers.
+ * Block n is the (n mod number of blocks)-th block after that offset.
+ *
+ * Buffers in memory can be enlarged with uca_ring_buffer_grow() while they are
+ * in use. The new blocks are allocated separately and existing blocks are not
+ * moved, so the mapping from sequence numbers to blocks is kept in a table.
+ */
+
+/* Memory mapping flags, posix_memalign and sync_file_range are not in C99 */
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include "uca-ring-buffer.h"
 
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#ifdef G_OS_UNIX
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifdef G_OS_WIN32
+#include <malloc.h>
+#endif
+
 #define UCA_RING_BUFFER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_RING_BUFFER, UcaRingBufferPrivate))
 
+/* Padding that keeps producer and consumer state on separate cache lines */
+#define CACHE_LINE_SIZE 64
+
+/* Size of explicit huge pages, mappings are rounded up to a multiple of it */
+#define HUGE_PAGE_SIZE  (2 << 20)
+
+typedef enum {
+    ALLOC_NONE,
+    ALLOC_GLIB,
+    ALLOC_ALIGNED,
+    ALLOC_MAPPED,
+    ALLOC_FILE
+} AllocKind;
+
+#define FILE_MAGIC "UCARING1"
+
+typedef struct {
+    gchar   magic[8];
+    guint64 block_size;
+    guint64 n_blocks;
+    volatile guint64 write_seq;
+    guint64 data_offset;
+} FileHeader;
+
+/* Blocks added by uca_ring_buffer_grow() */
+typedef struct {
+    guchar *data;
+    guchar *metadata;
+    guint   n_blocks;
+} Chunk;
+
+struct _UcaRingBufferCursor {
+    /* Written by the consumer, the read sequence is also claimed by the producer */
+    volatile guint64 read_seq;
+    volatile gint n_borrowed;
+    guint64  cached_write_seq;
+    volatile guint64 n_skipped;
+    UcaRingBufferCursorPolicy policy;
+    gchar   *name;
+
+    guint8   pad[CACHE_LINE_SIZE];
+};
+
 G_DEFINE_TYPE(UcaRingBuffer, uca_ring_buffer, G_TYPE_OBJECT)
 
 struct _UcaRingBufferPrivate {
     guchar  *data;
+    guchar  *metadata;
     gsize    block_size;
+    gsize    metadata_size;
     guint    n_blocks_total;
-    guint    write_index;
-    guint    read_index;
-    guint    read;
-    guint    written;
+
+    /* Block of each ring position, the first n_blocks_base ones are in data */
+    guchar **slots;
+    guint    n_blocks_base;
+    GPtrArray *chunks;
+
+    /* Allocation options and how the current memory was allocated */
+    gsize    alignment;
+    gboolean huge_pages;
+    gboolean lock_memory;
+    gboolean prefault;
+    gint     numa_node;
+    gchar   *file_name;
+    AllocKind alloc_kind;
+    gpointer alloc_base;
+    gsize    alloc_size;
+    gsize    locked_size;
+    gboolean constructed;
+    gint     fd;
+    FileHeader *file_header;
+
+    guint8   pad0[CACHE_LINE_SIZE];
+
+    /* Written by the producer only */
+    volatile guint64 write_seq;
+    volatile guint64 n_dropped;
+    guint64  cached_free_seq;
+
+    guint8   pad1[CACHE_LINE_SIZE];
+
+    /* Default consumer */
+    UcaRingBufferCursor reader;
+
+    /* Named cursors, only the producer's slow path and their owners use them */
+    GMutex   cursor_lock;
+    GPtrArray *cursors;
+    volatile gint n_cursors;
 };
 
 enum {
     PROP_0,
     PROP_BLOCK_SIZE,
     PROP_NUM_BLOCKS,
+    PROP_METADATA_SIZE,
+    PROP_ALIGNMENT,
+    PROP_HUGE_PAGES,
+    PROP_LOCK_MEMORY,
+    PROP_PREFAULT,
+    PROP_NUMA_NODE,
+    PROP_FILE_NAME,
     N_PROPERTIES
 };
 
 static GParamSpec *properties[N_PROPERTIES] = { NULL, };
 
+#if defined(_MSC_VER)
+/* Interlocked functions imply a full memory barrier */
+static inline guint64
+load_acquire (volatile guint64 *p)
+{
+    return (guint64) InterlockedCompareExchange64 ((volatile LONG64 *) p, 0, 0);
+}
+
+static inline void
+store_release (volatile guint64 *p, guint64 value)
+{
+    InterlockedExchange64 ((volatile LONG64 *) p, (LONG64) value);
+}
+
+static inline gboolean
+compare_and_swap (volatile guint64 *p, guint64 old_value, guint64 new_value)
+{
+    return InterlockedCompareExchange64 ((volatile LONG64 *) p, (LONG64) new_value, (LONG64) old_value) == (LONG64) old_value;
+}
+
+static inline void
+fetch_add (volatile guint64 *p, guint64 value)
+{
+    InterlockedExchangeAdd64 ((volatile LONG64 *) p, (LONG64) value);
+}
+#else
+static inline guint64
+load_acquire (volatile guint64 *p)
+{
+    return __atomic_load_n (p, __ATOMIC_ACQUIRE);
+}
+
+static inline void
+store_release (volatile guint64 *p, guint64 value)
+{
+    __atomic_store_n (p, value, __ATOMIC_RELEASE);
+}
+
+static inline gboolean
+compare_and_swap (volatile guint64 *p, guint64 old_value, guint64 new_value)
+{
+    return __atomic_compare_exchange_n (p, &old_value, new_value, FALSE,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void
+fetch_add (volatile guint64 *p, guint64 value)
+{
+    __atomic_fetch_add (p, value, __ATOMIC_RELAXED);
+}
+#endif
+
+static inline guchar *
+block_at (UcaRingBufferPrivate *priv, guint64 seq)
+{
+    return priv->slots[seq % priv->n_blocks_total];
+}
+
+/*
+ * Sequence number of the oldest block that is still unread or borrowed by
+ * @cursor. The read sequence must be loaded before the number of borrowed
+ * blocks: a concurrent borrow increments the counter before it claims the
+ * block, so we can only underestimate.
+ */
+static inline guint64
+get_cursor_free_seq (UcaRingBufferCursor *cursor)
+{
+    guint64 read_seq;
+
+    read_seq = load_acquire (&cursor->read_seq);
+    return read_seq - (guint64) g_atomic_int_get (&cursor->n_borrowed);
+}
+
+/*
+ * Sequence number of the oldest block that any cursor still needs. All blocks
+ * before it can be overwritten.
+ */
+static guint64
+get_free_seq (UcaRingBufferPrivate *priv)
+{
+    guint64 free_seq;
+
+    free_seq = get_cursor_free_seq (&priv->reader);
+
+    if (g_atomic_int_get (&priv->n_cursors) > 0) {
+        g_mutex_lock (&priv->cursor_lock);
+
+        for (guint i = 0; i < priv->cursors->len; i++)
+            free_seq = MIN (free_seq, get_cursor_free_seq (g_ptr_array_index (priv->cursors, i)));
+
+        g_mutex_unlock (&priv->cursor_lock);
+    }
+
+    return free_seq;
+}
+
+/*
+ * Move all cursors that still need block @free_seq past it, so that the
+ * producer can overwrite it. Fails if a cursor is lossless or has borrowed the
+ * block. Must be called by the producer only.
+ */
+static gboolean
+drop_oldest (UcaRingBufferPrivate *priv, guint64 free_seq, gboolean claim)
+{
+    UcaRingBufferCursor *cursors[UCA_RING_BUFFER_MAX_CURSORS + 1];
+    guint n_cursors = 0;
+    guint n_claimed = 0;
+    gboolean success = TRUE;
+
+    if (get_cursor_free_seq (&priv->reader) == free_seq)
+        cursors[n_cursors++] = &priv->reader;
+
+    g_mutex_lock (&priv->cursor_lock);
+
+    for (guint i = 0; i < priv->cursors->len; i++) {
+        UcaRingBufferCursor *cursor = g_ptr_array_index (priv->cursors, i);
+
+        if (get_cursor_free_seq (cursor) == free_seq)
+            cursors[n_cursors++] = cursor;
+    }
+
+    /* Check all cursors first, so that we do not drop the block for some only */
+    for (guint i = 0; i < n_cursors && success; i++) {
+        success = cursors[i]->policy != UCA_RING_BUFFER_CURSOR_LOSSLESS &&
+                  g_atomic_int_get (&cursors[i]->n_borrowed) == 0;
+    }
+
+    /* A failed claim means the consumer was faster and borrowed the block */
+    if (success && claim) {
+        while (n_claimed < n_cursors &&
+               compare_and_swap (&cursors[n_claimed]->read_seq, free_seq, free_seq + 1))
+            n_claimed++;
+
+        success = n_claimed == n_cursors;
+    }
+
+    for (guint i = 0; i < n_claimed; i++) {
+        /* The block stays, give it back unless the consumer has moved on already */
+        if (!success && compare_and_swap (&cursors[i]->read_seq, free_seq + 1, free_seq))
+            continue;
+
+        if (cursors[i] == &priv->reader)
+            store_release (&priv->n_dropped, priv->n_dropped + 1);
+        else
+            fetch_add (&cursors[i]->n_skipped, 1);
+    }
+
+    g_mutex_unlock (&priv->cursor_lock);
+
+    return success;
+}
+
+static void
+reset_cursor (UcaRingBufferCursor *cursor, guint64 seq)
+{
+    cursor->read_seq = seq;
+    cursor->n_borrowed = 0;
+    cursor->cached_write_seq = seq;
+    cursor->n_skipped = 0;
+}
+
+static void
+reset_seqs (UcaRingBufferPrivate *priv)
+{
+    priv->write_seq = 0;
+    priv->n_dropped = 0;
+    priv->cached_free_seq = 0;
+    reset_cursor (&priv->reader, 0);
+
+    for (guint i = 0; i < priv->cursors->len; i++)
+        reset_cursor (g_ptr_array_index (priv->cursors, i), 0);
+}
+
+static gboolean
+cursor_available (UcaRingBufferPrivate *priv, UcaRingBufferCursor *cursor)
+{
+    guint64 read_seq;
+
+    read_seq = load_acquire (&cursor->read_seq);
+
+    if (read_seq < cursor->cached_write_seq)
+        return TRUE;
+
+    cursor->cached_write_seq = load_acquire (&priv->write_seq);
+    return read_seq < cursor->cached_write_seq;
+}
+
+static gpointer
+cursor_borrow (UcaRingBufferPrivate *priv, UcaRingBufferCursor *cursor)
+{
+    guint64 read_seq;
+    guint64 seq;
+    gboolean skip;
+
+    /* Latest-only cursors can skip ahead only if they hold no older block */
+    skip = cursor->policy == UCA_RING_BUFFER_CURSOR_LATEST &&
+           g_atomic_int_get (&cursor->n_borrowed) == 0;
+
+    /*
+     * Announce the borrow before claiming the block, so that the producer
+     * never considers it free. The claim fails only if the producer dropped
+     * the block in the meantime, in which case we try the next one.
+     */
+    g_atomic_int_inc (&cursor->n_borrowed);
+    read_seq = load_acquire (&cursor->read_seq);
+
+    while (TRUE) {
+        guint64 write_seq;
+
+        write_seq = load_acquire (&priv->write_seq);
+
+        if (read_seq >= write_seq) {
+            g_atomic_int_add (&cursor->n_borrowed, -1);
+            return NULL;
+        }
+
+        seq = skip ? write_seq - 1 : read_seq;
+
+        if (compare_and_swap (&cursor->read_seq, read_seq, seq + 1))
+            break;
+
+        read_seq = load_acquire (&cursor->read_seq);
+    }
+
+    if (seq > read_seq)
+        fetch_add (&cursor->n_skipped, seq - read_seq);
+
+    return block_at (priv, seq);
+}
+
+static void
+cursor_release (UcaRingBufferPrivate *priv, UcaRingBufferCursor *cursor, gpointer data)
+{
+    gint n_borrowed;
+
+    n_borrowed = g_atomic_int_get (&cursor->n_borrowed);
+    g_return_if_fail (n_borrowed > 0);
+    g_return_if_fail (data == block_at (priv, load_acquire (&cursor->read_seq) - n_borrowed));
+
+    /* Implies a full barrier, our reads of the block are complete */
+    g_atomic_int_add (&cursor->n_borrowed, -1);
+}
+
 UcaRingBuffer *
 uca_ring_buffer_new (gsize block_size,
                      guint n_blocks)
@@ -54,80 +443,540 @@ uca_ring_buffer_new (gsize block_size,
     return buffer;
 }
 
+/**
+ * uca_ring_buffer_get_metadata:
+ * @buffer: A #UcaRingBuffer object
+ * @block: Pointer to a block of @buffer
+ *
+ * Get the metadata that is stored alongside @block. The metadata belongs to
+ * whoever currently owns the block, i.e. the writer between
+ * uca_ring_buffer_get_write_pointer() and uca_ring_buffer_write_advance() and
+ * the reader while the block is borrowed.
+ *
+ * Return value: (transfer none): Pointer to #UcaRingBuffer:metadata-size bytes
+ *  or %NULL if no metadata is stored.
+ * Since: 2.5
+ */
+gpointer
+uca_ring_buffer_get_metadata (UcaRingBuffer *buffer,
+                              gconstpointer  block)
+{
+    UcaRingBufferPrivate *priv;
+    gsize index;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    priv = buffer->priv;
+
+    if (priv->metadata == NULL || priv->block_size == 0)
+        return NULL;
+
+    index = ((const guchar *) block - priv->data) / priv->block_size;
+
+    if ((const guchar *) block >= priv->data && index < priv->n_blocks_base)
+        return priv->metadata + index * priv->metadata_size;
+
+    for (guint i = 0; i < priv->chunks->len; i++) {
+        Chunk *chunk = g_ptr_array_index (priv->chunks, i);
+
+        index = ((const guchar *) block - chunk->data) / priv->block_size;
+
+        if ((const guchar *) block >= chunk->data && index < chunk->n_blocks)
+            return chunk->metadata + index * priv->metadata_size;
+    }
+
+    g_return_val_if_reached (NULL);
+}
+
+/**
+ * uca_ring_buffer_reset:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Discard all blocks. This must not be called while a producer or consumer
+ * accesses @buffer.
+ */
 void
 uca_ring_buffer_reset (UcaRingBuffer *buffer)
 {
+    UcaRingBufferPrivate *priv;
+
     g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    priv = buffer->priv;
 
-    buffer->priv->write_index = 0;
-    buffer->priv->read_index = 0;
+    reset_seqs (priv);
+
+    if (priv->file_header != NULL)
+        priv->file_header->write_seq = 0;
 }
 
 gsize
 uca_ring_buffer_get_block_size (UcaRingBuffer *buffer)
 {
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
-    return buffer->priv->block_size;
-}
-
-gboolean
-uca_ring_buffer_available (UcaRingBuffer *buffer)
-{
-    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
-    return buffer->priv->read_index < buffer->priv->write_index;
+    return buffer->priv->block_size;
+}
+
+gboolean
+uca_ring_buffer_available (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    return cursor_available (buffer->priv, &buffer->priv->reader);
+}
+
+/**
+ * uca_ring_buffer_get_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get pointer to current read location. If no data is available, %NULL is
+ * returned. The block is handed back to the writer immediately, so the data
+ * may be overwritten at any time. Use uca_ring_buffer_borrow_read_pointer() if
+ * the block must stay valid while it is accessed.
+ *
+ * Return value: (transfer none): Pointer to current read location
+ */
+gpointer
+uca_ring_buffer_get_read_pointer (UcaRingBuffer *buffer)
+{
+    gpointer data;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+
+    data = uca_ring_buffer_borrow_read_pointer (buffer);
+
+    if (data != NULL)
+        uca_ring_buffer_release_read_pointer (buffer, data);
+
+    return data;
+}
+
+/**
+ * uca_ring_buffer_borrow_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get pointer to current read location and advance the read location. Unlike
+ * uca_ring_buffer_get_read_pointer(), the block is not recycled until it is
+ * handed back with uca_ring_buffer_release_read_pointer(). More than one block
+ * can be borrowed at a time but they must be released in the order they were
+ * borrowed. If no data is available, %NULL is returned.
+ *
+ * Return value: (transfer none): Pointer to current read location
+ * Since: 2.5
+ */
+gpointer
+uca_ring_buffer_borrow_read_pointer (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    return cursor_borrow (buffer->priv, &buffer->priv->reader);
+}
+
+/**
+ * uca_ring_buffer_release_read_pointer:
+ * @buffer: A #UcaRingBuffer object
+ * @data: Pointer previously returned by uca_ring_buffer_borrow_read_pointer()
+ *
+ * Hand the oldest borrowed block back to the writer. @data must be the oldest
+ * block that has not been released yet.
+ *
+ * Since: 2.5
+ */
+void
+uca_ring_buffer_release_read_pointer (UcaRingBuffer *buffer,
+                                      gpointer       data)
+{
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    cursor_release (buffer->priv, &buffer->priv->reader, data);
+}
+
+static void
+cursor_free (UcaRingBufferCursor *cursor)
+{
+    g_free (cursor->name);
+    g_free (cursor);
+}
+
+/**
+ * uca_ring_buffer_add_cursor:
+ * @buffer: A #UcaRingBuffer object
+ * @name: Unique name of the cursor
+ * @policy: What happens to the cursor if the producer runs out of blocks
+ *
+ * Add a consumer that reads all blocks written from now on independently of
+ * the default consumer and all other cursors. A block is only overwritten once
+ * every cursor has read it or allowed to skip it according to its @policy.
+ *
+ * This may be called while the producer is running. Each cursor must only be
+ * used by one consumer thread at a time.
+ *
+ * Return value: (transfer none): The new cursor, owned by @buffer, or %NULL if
+ * a cursor called @name exists already or #UCA_RING_BUFFER_MAX_CURSORS cursors
+ * have been added
+ * Since: 2.5
+ */
+UcaRingBufferCursor *
+uca_ring_buffer_add_cursor (UcaRingBuffer            *buffer,
+                            const gchar              *name,
+                            UcaRingBufferCursorPolicy policy)
+{
+    UcaRingBufferPrivate *priv;
+    UcaRingBufferCursor *cursor;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    g_return_val_if_fail (name != NULL, NULL);
+    priv = buffer->priv;
+
+    if (uca_ring_buffer_get_cursor (buffer, name) != NULL)
+        return NULL;
+
+    cursor = g_new0 (UcaRingBufferCursor, 1);
+    cursor->name = g_strdup (name);
+    cursor->policy = policy;
+
+    g_mutex_lock (&priv->cursor_lock);
+
+    /* The producer keeps the cursors it drops a block for on the stack */
+    if (priv->cursors->len < UCA_RING_BUFFER_MAX_CURSORS) {
+        reset_cursor (cursor, load_acquire (&priv->write_seq));
+        g_ptr_array_add (priv->cursors, cursor);
+        g_atomic_int_inc (&priv->n_cursors);
+    }
+    else {
+        cursor_free (cursor);
+        cursor = NULL;
+    }
+
+    g_mutex_unlock (&priv->cursor_lock);
+
+    return cursor;
+}
+
+/**
+ * uca_ring_buffer_get_cursor:
+ * @buffer: A #UcaRingBuffer object
+ * @name: Name of the cursor
+ *
+ * Return value: (transfer none): The cursor called @name or %NULL
+ * Since: 2.5
+ */
+UcaRingBufferCursor *
+uca_ring_buffer_get_cursor (UcaRingBuffer *buffer,
+                            const gchar   *name)
+{
+    UcaRingBufferPrivate *priv;
+    UcaRingBufferCursor *result = NULL;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    g_return_val_if_fail (name != NULL, NULL);
+    priv = buffer->priv;
+
+    g_mutex_lock (&priv->cursor_lock);
+
+    for (guint i = 0; i < priv->cursors->len && result == NULL; i++) {
+        UcaRingBufferCursor *cursor = g_ptr_array_index (priv->cursors, i);
+
+        if (g_strcmp0 (cursor->name, name) == 0)
+            result = cursor;
+    }
+
+    g_mutex_unlock (&priv->cursor_lock);
+    return result;
+}
+
+/**
+ * uca_ring_buffer_remove_cursor:
+ * @buffer: A #UcaRingBuffer object
+ * @cursor: A cursor returned by uca_ring_buffer_add_cursor()
+ *
+ * Remove and free @cursor. All blocks borrowed through @cursor must have been
+ * released.
+ *
+ * Since: 2.5
+ */
+void
+uca_ring_buffer_remove_cursor (UcaRingBuffer       *buffer,
+                               UcaRingBufferCursor *cursor)
+{
+    UcaRingBufferPrivate *priv;
+    gboolean removed;
+
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    g_return_if_fail (cursor != NULL);
+    priv = buffer->priv;
+
+    g_mutex_lock (&priv->cursor_lock);
+    removed = g_ptr_array_remove (priv->cursors, cursor);
+
+    if (removed)
+        g_atomic_int_add (&priv->n_cursors, -1);
+
+    g_mutex_unlock (&priv->cursor_lock);
+
+    g_return_if_fail (removed);
+
+    if (g_atomic_int_get (&cursor->n_borrowed) > 0)
+        g_warning ("Cursor `%s' removed with borrowed blocks", cursor->name);
+
+    cursor_free (cursor);
+}
+
+/**
+ * uca_ring_buffer_cursor_get_name:
+ * @cursor: A #UcaRingBufferCursor
+ *
+ * Return value: The name @cursor was added with
+ * Since: 2.5
+ */
+const gchar *
+uca_ring_buffer_cursor_get_name (UcaRingBufferCursor *cursor)
+{
+    g_return_val_if_fail (cursor != NULL, NULL);
+    return cursor->name;
+}
+
+/**
+ * uca_ring_buffer_cursor_available:
+ * @buffer: A #UcaRingBuffer object
+ * @cursor: A cursor of @buffer
+ *
+ * Return value: %TRUE if @cursor has at least one unread block
+ * Since: 2.5
+ */
+gboolean
+uca_ring_buffer_cursor_available (UcaRingBuffer       *buffer,
+                                  UcaRingBufferCursor *cursor)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    g_return_val_if_fail (cursor != NULL, FALSE);
+    return cursor_available (buffer->priv, cursor);
+}
+
+/**
+ * uca_ring_buffer_cursor_borrow:
+ * @buffer: A #UcaRingBuffer object
+ * @cursor: A cursor of @buffer
+ *
+ * Like uca_ring_buffer_borrow_read_pointer() but for @cursor. A
+ * %UCA_RING_BUFFER_CURSOR_LATEST cursor without borrowed blocks skips to the
+ * newest block.
+ *
+ * Return value: (transfer none): The next block for @cursor or %NULL
+ * Since: 2.5
+ */
+gpointer
+uca_ring_buffer_cursor_borrow (UcaRingBuffer       *buffer,
+                               UcaRingBufferCursor *cursor)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
+    g_return_val_if_fail (cursor != NULL, NULL);
+    return cursor_borrow (buffer->priv, cursor);
+}
+
+/**
+ * uca_ring_buffer_cursor_release:
+ * @buffer: A #UcaRingBuffer object
+ * @cursor: A cursor of @buffer
+ * @data: Pointer previously returned by uca_ring_buffer_cursor_borrow()
+ *
+ * Like uca_ring_buffer_release_read_pointer() but for @cursor.
+ *
+ * Since: 2.5
+ */
+void
+uca_ring_buffer_cursor_release (UcaRingBuffer       *buffer,
+                                UcaRingBufferCursor *cursor,
+                                gpointer             data)
+{
+    g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
+    g_return_if_fail (cursor != NULL);
+    cursor_release (buffer->priv, cursor, data);
+}
+
+/**
+ * uca_ring_buffer_cursor_get_num_skipped:
+ * @cursor: A #UcaRingBufferCursor
+ *
+ * Get the number of blocks @cursor has not seen, either because the producer
+ * needed them or because @cursor skipped to the newest block.
+ *
+ * Return value: Number of skipped blocks since @cursor was added or the buffer
+ * was reset
+ * Since: 2.5
+ */
+guint64
+uca_ring_buffer_cursor_get_num_skipped (UcaRingBufferCursor *cursor)
+{
+    g_return_val_if_fail (cursor != NULL, 0);
+    return load_acquire (&cursor->n_skipped);
+}
+
+/**
+ * uca_ring_buffer_is_writable:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Check if the block at the current write location may be written. This is
+ * %FALSE if it is still borrowed by a reader.
+ *
+ * Return value: %TRUE if the write location can be written
+ * Since: 2.5
+ */
+gboolean
+uca_ring_buffer_is_writable (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    guint64 free_seq;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    free_seq = get_free_seq (priv);
+
+    return priv->write_seq - free_seq < priv->n_blocks_total ||
+           drop_oldest (priv, free_seq, FALSE);
+}
+
+/**
+ * uca_ring_buffer_is_full:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Check if all blocks hold data that has not been read yet. Writing to a full
+ * buffer drops the oldest unread block.
+ *
+ * Return value: %TRUE if no block is free
+ * Since: 2.5
+ */
+gboolean
+uca_ring_buffer_is_full (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    return priv->write_seq - get_free_seq (priv) >= priv->n_blocks_total;
+}
+
+/**
+ * uca_ring_buffer_get_num_dropped:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the number of unread blocks that were overwritten by
+ * uca_ring_buffer_get_write_pointer() since the last reset.
+ *
+ * Return value: Number of dropped blocks
+ * Since: 2.5
+ */
+guint64
+uca_ring_buffer_get_num_dropped (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return load_acquire (&buffer->priv->n_dropped);
 }
 
 /**
- * uca_ring_buffer_get_read_pointer:
+ * uca_ring_buffer_get_write_pointer:
  * @buffer: A #UcaRingBuffer object
  *
- * Get pointer to current read location. If no data is available, %NULL is
- * returned.
+ * Get pointer to current write location. If the buffer is full, the oldest
+ * unread block is dropped to make room. If that block is borrowed, %NULL is
+ * returned and the producer has to try again after it has been released.
  *
- * Return value: (transfer none): Pointer to current read location
+ * Return value: (transfer none): Pointer to current write location
  */
 gpointer
-uca_ring_buffer_get_read_pointer (UcaRingBuffer *buffer)
+uca_ring_buffer_get_write_pointer (UcaRingBuffer *buffer)
 {
     UcaRingBufferPrivate *priv;
-    gpointer data;
+    guint64 write_seq;
+    guint64 free_seq;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
+    g_return_val_if_fail (priv->n_blocks_total > 0, NULL);
 
-    g_return_val_if_fail (priv->read_index != priv->write_index, NULL);
-    data = priv->data + (priv->read_index % priv->n_blocks_total) * priv->block_size;
-    priv->read_index++;
-    return data;
+    write_seq = priv->write_seq;
+
+    /* Only look at the consumer's cache line if we might be full */
+    if (write_seq - priv->cached_free_seq < priv->n_blocks_total)
+        return block_at (priv, write_seq);
+
+    free_seq = get_free_seq (priv);
+    priv->cached_free_seq = free_seq;
+
+    if (write_seq - free_seq < priv->n_blocks_total)
+        return block_at (priv, write_seq);
+
+    /* Claim the oldest block unless it is borrowed or must not be lost */
+    if (!drop_oldest (priv, free_seq, TRUE))
+        return NULL;
+
+    priv->cached_free_seq = free_seq + 1;
+    return block_at (priv, write_seq);
 }
 
 /**
- * uca_ring_buffer_get_write_pointer:
+ * uca_ring_buffer_get_write_pointer_ahead:
  * @buffer: A #UcaRingBuffer object
+ * @n: Number of blocks past the current write location
  *
- * Get pointer to current write location.
+ * Get pointer to the block @n positions after the current write location, so
+ * that the producer can fill several blocks at once and publish them in order
+ * with uca_ring_buffer_write_advance(). Unlike
+ * uca_ring_buffer_get_write_pointer(), no unread block is ever dropped and the
+ * buffer must not be resized while blocks ahead are being filled.
  *
- * Return value: (transfer none): Pointer to current write location
+ * Return value: (transfer none): Pointer to the block or %NULL if it still
+ *  holds data that has not been read.
+ * Since: 2.5
  */
 gpointer
-uca_ring_buffer_get_write_pointer (UcaRingBuffer *buffer)
+uca_ring_buffer_get_write_pointer_ahead (UcaRingBuffer *buffer,
+                                         guint          n)
 {
     UcaRingBufferPrivate *priv;
-    gpointer data;
+    guint64 seq;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
-
     priv = buffer->priv;
-    data = priv->data + (priv->write_index % priv->n_blocks_total) * priv->block_size;
+    g_return_val_if_fail (priv->n_blocks_total > 0, NULL);
 
-    return data;
+    seq = priv->write_seq + n;
+
+    if (seq - priv->cached_free_seq < priv->n_blocks_total)
+        return block_at (priv, seq);
+
+    priv->cached_free_seq = get_free_seq (priv);
+
+    if (seq - priv->cached_free_seq < priv->n_blocks_total)
+        return block_at (priv, seq);
+
+    return NULL;
 }
 
+/**
+ * uca_ring_buffer_write_advance:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Publish the block at the current write location. It must have been obtained
+ * with uca_ring_buffer_get_write_pointer() or
+ * uca_ring_buffer_get_write_pointer_ahead() before.
+ */
 void
 uca_ring_buffer_write_advance (UcaRingBuffer *buffer)
 {
+    UcaRingBufferPrivate *priv;
+
     g_return_if_fail (UCA_IS_RING_BUFFER (buffer));
-    buffer->priv->write_index++;
+    priv = buffer->priv;
+
+    if (priv->file_header != NULL) {
+#if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+        /* Start writing the block back now instead of in one burst later */
+        sync_file_range (priv->fd,
+                         (off_t) (priv->file_header->data_offset + (priv->write_seq % priv->n_blocks_total) * priv->block_size),
+                         (off_t) priv->block_size, SYNC_FILE_RANGE_WRITE);
+#endif
+        priv->file_header->write_seq = priv->write_seq + 1;
+    }
+
+    store_release (&priv->write_seq, priv->write_seq + 1);
 }
 
 /**
@@ -144,7 +993,7 @@ uca_ring_buffer_peek_pointer (UcaRingBuffer *buffer)
     UcaRingBufferPrivate *priv;
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
-    return ((guint8 *) priv->data) + ((priv->write_index % priv->n_blocks_total) * priv->block_size);
+    return block_at (priv, load_acquire (&priv->write_seq));
 }
 
 /**
@@ -152,7 +1001,8 @@ uca_ring_buffer_peek_pointer (UcaRingBuffer *buffer)
  * @buffer: A #UcaRingBuffer object
  * @index: Block index of queried pointer
  *
- * Get pointer to read location identified by @index.
+ * Get pointer to read location identified by @index, counted from the oldest
+ * block that has not been read yet.
  *
  * Return value: (transfer none): Pointer to indexed read location
  */
@@ -163,26 +1013,475 @@ uca_ring_buffer_get_pointer (UcaRingBuffer *buffer,
     UcaRingBufferPrivate *priv;
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), NULL);
     priv = buffer->priv;
-    return ((guint8 *) priv->data) + (((priv->read_index + index) % priv->n_blocks_total) * priv->block_size);
+    return block_at (priv, load_acquire (&priv->reader.read_seq) + index);
 }
 
 guint
 uca_ring_buffer_get_num_blocks (UcaRingBuffer *buffer)
 {
     UcaRingBufferPrivate *priv;
+    guint64 write_seq;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    priv = buffer->priv;
+    write_seq = load_acquire (&priv->write_seq);
+    return write_seq < priv->n_blocks_total ? (guint) write_seq : priv->n_blocks_total;
+}
+
+/**
+ * uca_ring_buffer_get_capacity:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the number of blocks that @buffer can hold, including those added with
+ * uca_ring_buffer_grow().
+ *
+ * Return value: Number of allocated blocks
+ * Since: 2.5
+ */
+guint
+uca_ring_buffer_get_capacity (UcaRingBuffer *buffer)
+{
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
+    return buffer->priv->n_blocks_total;
+}
+
+/**
+ * uca_ring_buffer_get_fill_level:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Get the number of blocks that are unread or borrowed. If called
+ * concurrently with a producer or consumer, the result is a snapshot.
+ *
+ * Return value: Number of blocks that cannot be written without dropping data
+ * Since: 2.5
+ */
+guint
+uca_ring_buffer_get_fill_level (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+    guint64 free_seq;
 
     g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), 0);
     priv = buffer->priv;
-    return priv->write_index < priv->n_blocks_total ? priv->write_index : priv->n_blocks_total;
+
+    /* Free sequence first, so that we cannot get ahead of the write sequence */
+    free_seq = get_free_seq (priv);
+    return (guint) (load_acquire (&priv->write_seq) - free_seq);
 }
 
 static void
-realloc_mem (UcaRingBufferPrivate *priv)
+chunk_free (Chunk *chunk)
+{
+    g_free (chunk->data);
+    g_free (chunk->metadata);
+    g_free (chunk);
+}
+
+/**
+ * uca_ring_buffer_grow:
+ * @buffer: A #UcaRingBuffer object
+ * @n_blocks: Number of blocks to add
+ *
+ * Add @n_blocks blocks to @buffer. Existing blocks are not moved, so borrowed
+ * blocks stay valid and unread blocks are read in the same order as before.
+ * The new blocks are allocated on the heap regardless of the allocation
+ * options. Buffers backed by a file cannot grow.
+ *
+ * This may only be called by the producer outside of
+ * uca_ring_buffer_get_write_pointer() and uca_ring_buffer_write_advance() and
+ * must not run concurrently with any consumer function.
+ *
+ * Return value: %TRUE if @buffer has grown
+ * Since: 2.5
+ */
+gboolean
+uca_ring_buffer_grow (UcaRingBuffer *buffer,
+                      guint          n_blocks)
+{
+    UcaRingBufferPrivate *priv;
+    Chunk *chunk;
+    guchar **slots;
+    gboolean *live;
+    guint64 free_seq;
+    guint64 write_seq;
+    guint n_old;
+    guint n_new;
+    guint next_old = 0;
+    guint next_new = 0;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    if (n_blocks == 0 || priv->block_size == 0 || priv->alloc_kind == ALLOC_FILE)
+        return FALSE;
+
+    chunk = g_new0 (Chunk, 1);
+    chunk->n_blocks = n_blocks;
+    chunk->data = g_try_malloc_n (n_blocks, priv->block_size);
+
+    if (chunk->data == NULL) {
+        g_free (chunk);
+        return FALSE;
+    }
+
+    chunk->metadata = g_malloc0_n (n_blocks, priv->metadata_size);
+    g_ptr_array_add (priv->chunks, chunk);
+
+    n_old = priv->n_blocks_total;
+    n_new = n_old + n_blocks;
+    slots = g_new0 (guchar *, n_new);
+    live = g_new0 (gboolean, n_old);
+
+    /* Unread and borrowed blocks move to the position of their sequence number */
+    free_seq = get_free_seq (priv);
+    write_seq = priv->write_seq;
+
+    for (guint64 seq = free_seq; seq < write_seq; seq++) {
+        slots[seq % n_new] = priv->slots[seq % n_old];
+        live[seq % n_old] = TRUE;
+    }
+
+    /* All other blocks are free and can go anywhere */
+    for (guint i = 0; i < n_new; i++) {
+        if (slots[i] != NULL)
+            continue;
+
+        while (next_old < n_old && live[next_old])
+            next_old++;
+
+        if (next_old < n_old)
+            slots[i] = priv->slots[next_old++];
+        else
+            slots[i] = chunk->data + (next_new++) * priv->block_size;
+    }
+
+    g_free (live);
+    g_free (priv->slots);
+    priv->slots = slots;
+    priv->n_blocks_total = n_new;
+    priv->cached_free_seq = free_seq;
+
+    return TRUE;
+}
+
+/**
+ * uca_ring_buffer_shrink:
+ * @buffer: A #UcaRingBuffer object
+ *
+ * Release all blocks added with uca_ring_buffer_grow(). This only succeeds if
+ * no block is unread or borrowed. The same restrictions as for
+ * uca_ring_buffer_grow() apply.
+ *
+ * Return value: %TRUE if @buffer has shrunk
+ * Since: 2.5
+ */
+gboolean
+uca_ring_buffer_shrink (UcaRingBuffer *buffer)
+{
+    UcaRingBufferPrivate *priv;
+
+    g_return_val_if_fail (UCA_IS_RING_BUFFER (buffer), FALSE);
+    priv = buffer->priv;
+
+    if (priv->chunks->len == 0 || get_free_seq (priv) != priv->write_seq)
+        return FALSE;
+
+    for (guint i = 0; i < priv->n_blocks_base; i++)
+        priv->slots[i] = priv->data + i * priv->block_size;
+
+    priv->n_blocks_total = priv->n_blocks_base;
+    g_ptr_array_set_size (priv->chunks, 0);
+
+    return TRUE;
+}
+
+static void
+free_mem (UcaRingBufferPrivate *priv)
+{
+#ifdef G_OS_UNIX
+    if (priv->locked_size > 0)
+        munlock (priv->data, priv->locked_size);
+#endif
+
+    switch (priv->alloc_kind) {
+        case ALLOC_GLIB:
+            g_free (priv->alloc_base);
+            break;
+
+        case ALLOC_ALIGNED:
+#ifdef G_OS_WIN32
+            _aligned_free (priv->alloc_base);
+#else
+            free (priv->alloc_base);
+#endif
+            break;
+
+        case ALLOC_MAPPED:
+#ifdef G_OS_UNIX
+            munmap (priv->alloc_base, priv->alloc_size);
+#endif
+            break;
+
+        case ALLOC_FILE:
+#ifdef G_OS_UNIX
+            /* Pages of a shared mapping stay in the page cache and are written back eventually */
+            munmap (priv->alloc_base, priv->alloc_size);
+            close (priv->fd);
+#endif
+            break;
+
+        case ALLOC_NONE:
+            break;
+    }
+
+    priv->alloc_kind = ALLOC_NONE;
+    priv->alloc_base = NULL;
+    priv->alloc_size = 0;
+    priv->locked_size = 0;
+    priv->data = NULL;
+
+    g_free (priv->slots);
+    priv->slots = NULL;
+    priv->n_blocks_base = 0;
+    g_ptr_array_set_size (priv->chunks, 0);
+    priv->fd = -1;
+    priv->file_header = NULL;
+}
+
+#ifdef G_OS_UNIX
+static gpointer
+map_mem (UcaRingBufferPrivate *priv, gsize size, gsize page_size)
+{
+    gsize extra;
+    gpointer base = MAP_FAILED;
+
+    /* mmap only guarantees page alignment, over-allocate for anything else */
+    extra = priv->alignment > page_size ? priv->alignment : 0;
+
+#ifdef MAP_HUGETLB
+    if (priv->huge_pages) {
+        priv->alloc_size = (size + extra + HUGE_PAGE_SIZE - 1) & ~((gsize) HUGE_PAGE_SIZE - 1);
+        base = mmap (NULL, priv->alloc_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+
+    if (base == MAP_FAILED) {
+        priv->alloc_size = size + extra;
+        base = mmap (NULL, priv->alloc_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (base == MAP_FAILED)
+            return NULL;
+
+#ifdef MADV_HUGEPAGE
+        /* No huge pages reserved, ask for transparent ones instead */
+        if (priv->huge_pages)
+            madvise (base, priv->alloc_size, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (priv->numa_node >= 0) {
+#if defined(__linux__) && defined(SYS_mbind)
+        unsigned long node_mask;
+
+        /* MPOL_BIND = 2, avoids a dependency on libnuma */
+        if (priv->numa_node < (gint) (sizeof (node_mask) * 8)) {
+            node_mask = 1UL << priv->numa_node;
+
+            if (syscall (SYS_mbind, base, priv->alloc_size, 2, &node_mask, sizeof (node_mask) * 8, 0) != 0)
+                g_warning ("Could not bind ring buffer to NUMA node %i", priv->numa_node);
+        }
+        else
+            g_warning ("NUMA node %i out of range", priv->numa_node);
+#else
+        g_warning ("Binding ring buffers to NUMA nodes is not supported on this platform");
+#endif
+    }
+
+    priv->alloc_base = base;
+    priv->alloc_kind = ALLOC_MAPPED;
+
+    return (gpointer) (((gsize) base + extra) & ~(extra > 0 ? extra - 1 : 0));
+}
+
+/*
+ * Set @error from @errsv for the step of map_file() that failed and close @fd.
+ */
+static void
+map_file_error (gint fd, gint errsv, GError **error, const gchar *step, const gchar *file_name)
+{
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errsv),
+                 "Could not %s `%s': %s", step, file_name, g_strerror (errsv));
+
+    if (fd >= 0)
+        close (fd);
+}
+
+static gpointer
+map_file (UcaRingBufferPrivate *priv, gsize size, gsize page_size, GError **error)
+{
+    gsize offset;
+    gpointer base;
+    gint fd;
+#ifdef __linux__
+    gint result;
+#endif
+
+    /* The header takes the first page, the blocks start on the next boundary */
+    offset = MAX (page_size, priv->alignment);
+
+    fd = open (priv->file_name, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        map_file_error (fd, errno, error, "open", priv->file_name);
+        return NULL;
+    }
+
+    priv->alloc_size = offset + size;
+
+    /*
+     * Truncate leftovers of a larger recording and reserve the space up front,
+     * running out of disk space while writing to the mapping raises SIGBUS.
+     */
+    if (ftruncate (fd, (off_t) priv->alloc_size) != 0) {
+        map_file_error (fd, errno, error, "resize", priv->file_name);
+        return NULL;
+    }
+
+#ifdef __linux__
+    /* Returns the error instead of setting errno */
+    result = posix_fallocate (fd, 0, (off_t) priv->alloc_size);
+
+    if (result != 0) {
+        map_file_error (fd, result, error, "reserve space for", priv->file_name);
+        return NULL;
+    }
+#endif
+
+    base = mmap (NULL, priv->alloc_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (base == MAP_FAILED) {
+        map_file_error (fd, errno, error, "map", priv->file_name);
+        return NULL;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    /* Blocks are written in order, let the kernel read ahead and drop behind */
+    madvise (base, priv->alloc_size, MADV_SEQUENTIAL);
+#endif
+
+    priv->fd = fd;
+    priv->alloc_base = base;
+    priv->alloc_kind = ALLOC_FILE;
+    priv->file_header = base;
+
+    memcpy (priv->file_header->magic, FILE_MAGIC, sizeof (priv->file_header->magic));
+    priv->file_header->block_size = priv->block_size;
+    priv->file_header->n_blocks = priv->n_blocks_total;
+    priv->file_header->write_seq = 0;
+    priv->file_header->data_offset = offset;
+
+    return (guchar *) base + offset;
+}
+#endif
+
+static void
+alloc_mem (UcaRingBufferPrivate *priv)
 {
-    if (priv->data != NULL)
-        g_free (priv->data);
+    gsize size;
+    gsize page_size = 4096;
+
+    free_mem (priv);
+
+    g_free (priv->metadata);
+    priv->metadata = g_malloc0_n (priv->n_blocks_total, priv->metadata_size);
+
+    reset_seqs (priv);
+
+    size = priv->n_blocks_total * priv->block_size;
+    priv->n_blocks_base = priv->n_blocks_total;
+    priv->slots = g_new0 (guchar *, priv->n_blocks_total);
+
+    if (size == 0)
+        return;
+
+#ifdef G_OS_UNIX
+    page_size = (gsize) sysconf (_SC_PAGESIZE);
+
+    if (priv->file_name != NULL) {
+        GError *error = NULL;
+
+        priv->data = map_file (priv, size, page_size, &error);
+
+        if (priv->data == NULL) {
+            g_warning ("Could not back the ring buffer with a file: %s", error->message);
+            g_error_free (error);
+        }
+    }
+
+    if (priv->data == NULL && (priv->huge_pages || priv->numa_node >= 0)) {
+        priv->data = map_mem (priv, size, page_size);
+
+        if (priv->data == NULL)
+            g_warning ("Could not map %" G_GSIZE_FORMAT " bytes for the ring buffer", size);
+    }
+#else
+    if (priv->file_name != NULL)
+        g_warning ("File-backed ring buffers are not supported on this platform");
+
+    if (priv->huge_pages || priv->numa_node >= 0)
+        g_warning ("Huge pages and NUMA binding are not supported on this platform");
+#endif
+
+    if (priv->data == NULL && priv->alignment > 0) {
+#ifdef G_OS_WIN32
+        priv->alloc_base = _aligned_malloc (size, priv->alignment);
+#else
+        if (posix_memalign (&priv->alloc_base, priv->alignment, size) != 0)
+            priv->alloc_base = NULL;
+#endif
+        if (priv->alloc_base != NULL) {
+            priv->data = priv->alloc_base;
+            priv->alloc_kind = ALLOC_ALIGNED;
+        }
+    }
+
+    if (priv->data == NULL) {
+        /* Blocks are always written before they are read, no need to clear them */
+        priv->data = priv->alloc_base = g_malloc_n (priv->n_blocks_total, priv->block_size);
+        priv->alloc_kind = ALLOC_GLIB;
+    }
+
+    if (priv->lock_memory) {
+#ifdef G_OS_UNIX
+        /* Locking faults in all pages as a side effect */
+        if (mlock (priv->data, size) == 0)
+            priv->locked_size = size;
+        else
+            g_warning ("Could not lock ring buffer memory, check RLIMIT_MEMLOCK");
+#else
+        g_warning ("Locking ring buffer memory is not supported on this platform");
+#endif
+    }
+
+    if (priv->prefault) {
+        volatile guchar *data = priv->data;
+
+        for (gsize i = 0; i < size; i += page_size)
+            data[i] = 0;
+    }
 
-    priv->data = g_malloc0_n (priv->n_blocks_total, priv->block_size);
+    for (guint i = 0; i < priv->n_blocks_total; i++)
+        priv->slots[i] = priv->data + i * priv->block_size;
+}
+
+static void
+realloc_mem (UcaRingBufferPrivate *priv)
+{
+    /* Allocate only once all construct properties are known */
+    if (priv->constructed)
+        alloc_mem (priv);
 }
 
 static void
@@ -205,6 +1504,34 @@ uca_ring_buffer_get_property (GObject *object,
             g_value_set_uint (value, priv->n_blocks_total);
             break;
 
+        case PROP_METADATA_SIZE:
+            g_value_set_uint (value, (guint) priv->metadata_size);
+            break;
+
+        case PROP_ALIGNMENT:
+            g_value_set_uint (value, (guint) priv->alignment);
+            break;
+
+        case PROP_HUGE_PAGES:
+            g_value_set_boolean (value, priv->huge_pages);
+            break;
+
+        case PROP_LOCK_MEMORY:
+            g_value_set_boolean (value, priv->lock_memory);
+            break;
+
+        case PROP_PREFAULT:
+            g_value_set_boolean (value, priv->prefault);
+            break;
+
+        case PROP_NUMA_NODE:
+            g_value_set_int (value, priv->numa_node);
+            break;
+
+        case PROP_FILE_NAME:
+            g_value_set_string (value, priv->file_name);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
             break;
@@ -233,12 +1560,61 @@ uca_ring_buffer_set_property (GObject *object,
             realloc_mem (priv);
             break;
 
+        case PROP_METADATA_SIZE:
+            priv->metadata_size = g_value_get_uint (value);
+            realloc_mem (priv);
+            break;
+
+        case PROP_ALIGNMENT:
+            {
+                guint alignment = g_value_get_uint (value);
+
+                if (alignment & (alignment - 1) || (alignment > 0 && alignment < sizeof (gpointer)))
+                    g_warning ("Alignment %u is not a power of two multiple of the pointer size", alignment);
+                else
+                    priv->alignment = alignment;
+            }
+            break;
+
+        case PROP_HUGE_PAGES:
+            priv->huge_pages = g_value_get_boolean (value);
+            break;
+
+        case PROP_LOCK_MEMORY:
+            priv->lock_memory = g_value_get_boolean (value);
+            break;
+
+        case PROP_PREFAULT:
+            priv->prefault = g_value_get_boolean (value);
+            break;
+
+        case PROP_NUMA_NODE:
+            priv->numa_node = g_value_get_int (value);
+            break;
+
+        case PROP_FILE_NAME:
+            g_free (priv->file_name);
+            priv->file_name = g_value_dup_string (value);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
             break;
     }
 }
 
+static void
+uca_ring_buffer_constructed (GObject *object)
+{
+    UcaRingBufferPrivate *priv;
+
+    priv = UCA_RING_BUFFER_GET_PRIVATE (object);
+    priv->constructed = TRUE;
+    alloc_mem (priv);
+
+    G_OBJECT_CLASS (uca_ring_buffer_parent_class)->constructed (object);
+}
+
 static void
 uca_ring_buffer_dispose (GObject *object)
 {
@@ -251,8 +1627,17 @@ uca_ring_buffer_finalize (GObject *object)
     UcaRingBufferPrivate *priv;
 
     priv = UCA_RING_BUFFER_GET_PRIVATE (object);
-    g_free (priv->data);
-    priv->data = NULL;
+    free_mem (priv);
+    g_ptr_array_unref (priv->chunks);
+
+    for (guint i = 0; i < priv->cursors->len; i++)
+        cursor_free (g_ptr_array_index (priv->cursors, i));
+
+    g_ptr_array_unref (priv->cursors);
+    g_mutex_clear (&priv->cursor_lock);
+    g_free (priv->metadata);
+    g_free (priv->file_name);
+    priv->metadata = NULL;
     G_OBJECT_CLASS (uca_ring_buffer_parent_class)->finalize (object);
 }
 
@@ -265,6 +1650,7 @@ uca_ring_buffer_class_init (UcaRingBufferClass *klass)
 
     oclass->get_property = uca_ring_buffer_get_property;
     oclass->set_property = uca_ring_buffer_set_property;
+    oclass->constructed = uca_ring_buffer_constructed;
     oclass->dispose = uca_ring_buffer_dispose;
     oclass->finalize = uca_ring_buffer_finalize;
 
@@ -282,6 +1668,55 @@ uca_ring_buffer_class_init (UcaRingBufferClass *klass)
                            0, G_MAXUINT, 0,
                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
 
+    properties[PROP_METADATA_SIZE] =
+        g_param_spec_uint ("metadata-size",
+                           "Metadata size in bytes",
+                           "Number of bytes of metadata stored per block",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+
+    properties[PROP_ALIGNMENT] =
+        g_param_spec_uint ("alignment",
+                           "Alignment of the first block in bytes",
+                           "Alignment of the first block in bytes, 0 for the default",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+    properties[PROP_HUGE_PAGES] =
+        g_param_spec_boolean ("huge-pages",
+                              "Use huge pages",
+                              "Back the blocks with huge pages if possible",
+                              FALSE,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+    properties[PROP_LOCK_MEMORY] =
+        g_param_spec_boolean ("lock-memory",
+                              "Lock memory",
+                              "Prevent the blocks from being swapped out",
+                              FALSE,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+    properties[PROP_PREFAULT] =
+        g_param_spec_boolean ("prefault",
+                              "Prefault memory",
+                              "Touch all pages at allocation time instead of on first write",
+                              FALSE,
+                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+    properties[PROP_NUMA_NODE] =
+        g_param_spec_int ("numa-node",
+                          "NUMA node",
+                          "NUMA node to allocate the blocks on, -1 for no preference",
+                          -1, G_MAXINT, -1,
+                          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+    properties[PROP_FILE_NAME] =
+        g_param_spec_string ("file-name",
+                             "Backing file",
+                             "File that is mapped to store the blocks, NULL for anonymous memory",
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
     for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
         g_object_class_install_property (oclass, i, properties[i]);
 
@@ -296,5 +1731,30 @@ uca_ring_buffer_init (UcaRingBuffer *buffer)
 
     priv->n_blocks_total = 0;
     priv->block_size = 0;
+    priv->metadata_size = 0;
     priv->data = NULL;
+    priv->metadata = NULL;
+    priv->alignment = 0;
+    priv->huge_pages = FALSE;
+    priv->lock_memory = FALSE;
+    priv->prefault = FALSE;
+    priv->numa_node = -1;
+    priv->file_name = NULL;
+    priv->slots = NULL;
+    priv->n_blocks_base = 0;
+    priv->chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) chunk_free);
+    priv->fd = -1;
+    priv->file_header = NULL;
+    priv->alloc_kind = ALLOC_NONE;
+    priv->alloc_base = NULL;
+    priv->alloc_size = 0;
+    priv->locked_size = 0;
+    priv->constructed = FALSE;
+    priv->reader.policy = UCA_RING_BUFFER_CURSOR_DROP_OLDEST;
+    priv->reader.name = NULL;
+    priv->reader.n_skipped = 0;
+    priv->cursors = g_ptr_array_new ();
+    priv->n_cursors = 0;
+    g_mutex_init (&priv->cursor_lock);
+    uca_ring_buffer_reset (buffer);
 }
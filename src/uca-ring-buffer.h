@@ -16,6 +16,34 @@ G_BEGIN_DECLS
 typedef struct _UcaRingBuffer           UcaRingBuffer;
 typedef struct _UcaRingBufferClass      UcaRingBufferClass;
 typedef struct _UcaRingBufferPrivate    UcaRingBufferPrivate;
+typedef struct _UcaRingBufferCursor     UcaRingBufferCursor;
+
+/**
+ * UcaRingBufferCursorPolicy:
+ * @UCA_RING_BUFFER_CURSOR_DROP_OLDEST: The producer may overwrite the oldest
+ *  unread block of the cursor, like for the default consumer
+ * @UCA_RING_BUFFER_CURSOR_LATEST: Like @UCA_RING_BUFFER_CURSOR_DROP_OLDEST, but
+ *  borrowing skips to the newest block
+ * @UCA_RING_BUFFER_CURSOR_LOSSLESS: The producer never overwrites unread blocks
+ *  of the cursor and fails to write instead
+ *
+ * Since: 2.5
+ */
+typedef enum {
+    UCA_RING_BUFFER_CURSOR_DROP_OLDEST,
+    UCA_RING_BUFFER_CURSOR_LATEST,
+    UCA_RING_BUFFER_CURSOR_LOSSLESS
+} UcaRingBufferCursorPolicy;
+
+/**
+ * UCA_RING_BUFFER_MAX_CURSORS:
+ *
+ * Number of cursors a #UcaRingBuffer accepts in addition to the default
+ * consumer.
+ *
+ * Since: 2.5
+ */
+#define UCA_RING_BUFFER_MAX_CURSORS 64
 
 struct _UcaRingBuffer {
     /*< private >*/
@@ -37,11 +65,47 @@ UCA_API guint           uca_ring_buffer_get_num_blocks      (UcaRingBuffer *buff
 UCA_API gboolean        uca_ring_buffer_available           (UcaRingBuffer *buffer);
 UCA_API void            uca_ring_buffer_proceed             (UcaRingBuffer *buffer);
 UCA_API gpointer        uca_ring_buffer_get_read_pointer    (UcaRingBuffer *buffer);
+UCA_API gpointer        uca_ring_buffer_borrow_read_pointer (UcaRingBuffer *buffer);
+UCA_API void            uca_ring_buffer_release_read_pointer
+                                                            (UcaRingBuffer *buffer,
+                                                             gpointer       data);
+UCA_API gboolean        uca_ring_buffer_is_writable         (UcaRingBuffer *buffer);
+UCA_API gboolean        uca_ring_buffer_is_full             (UcaRingBuffer *buffer);
+UCA_API guint64         uca_ring_buffer_get_num_dropped     (UcaRingBuffer *buffer);
 UCA_API gpointer        uca_ring_buffer_get_write_pointer   (UcaRingBuffer *buffer);
+UCA_API gpointer        uca_ring_buffer_get_write_pointer_ahead
+                                                            (UcaRingBuffer *buffer,
+                                                             guint          n);
 UCA_API void            uca_ring_buffer_write_advance       (UcaRingBuffer *buffer);
 UCA_API gpointer        uca_ring_buffer_get_pointer         (UcaRingBuffer *buffer,
                                                              guint          index);
 UCA_API gpointer        uca_ring_buffer_peek_pointer        (UcaRingBuffer *buffer);
+UCA_API gpointer        uca_ring_buffer_get_metadata        (UcaRingBuffer *buffer,
+                                                             gconstpointer  block);
+UCA_API guint           uca_ring_buffer_get_capacity        (UcaRingBuffer *buffer);
+UCA_API guint           uca_ring_buffer_get_fill_level      (UcaRingBuffer *buffer);
+UCA_API gboolean        uca_ring_buffer_grow                (UcaRingBuffer *buffer,
+                                                             guint          n_blocks);
+UCA_API gboolean        uca_ring_buffer_shrink              (UcaRingBuffer *buffer);
+UCA_API UcaRingBufferCursor *
+                        uca_ring_buffer_add_cursor          (UcaRingBuffer *buffer,
+                                                             const gchar   *name,
+                                                             UcaRingBufferCursorPolicy policy);
+UCA_API UcaRingBufferCursor *
+                        uca_ring_buffer_get_cursor          (UcaRingBuffer *buffer,
+                                                             const gchar   *name);
+UCA_API void            uca_ring_buffer_remove_cursor       (UcaRingBuffer *buffer,
+                                                             UcaRingBufferCursor *cursor);
+UCA_API const gchar *   uca_ring_buffer_cursor_get_name     (UcaRingBufferCursor *cursor);
+UCA_API gboolean        uca_ring_buffer_cursor_available    (UcaRingBuffer *buffer,
+                                                             UcaRingBufferCursor *cursor);
+UCA_API gpointer        uca_ring_buffer_cursor_borrow       (UcaRingBuffer *buffer,
+                                                             UcaRingBufferCursor *cursor);
+UCA_API void            uca_ring_buffer_cursor_release      (UcaRingBuffer *buffer,
+                                                             UcaRingBufferCursor *cursor,
+                                                             gpointer       data);
+UCA_API guint64         uca_ring_buffer_cursor_get_num_skipped
+                                                            (UcaRingBufferCursor *cursor);
 
 UCA_API GType           uca_ring_buffer_get_type (void);
 
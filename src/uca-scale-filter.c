@@ -0,0 +1,225 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-scale-filter
+ * @Short_description: Linear intensity scaling
+ * @Title: UcaScaleFilter
+ *
+ * #UcaScaleFilter maps every pixel value v to (v - offset) * gain, rounded and
+ * clamped to the range of the pixel type. The mapping is tabulated once per
+ * recording, so changes of #UcaScaleFilter:offset and #UcaScaleFilter:gain
+ * take effect with the next recording.
+ */
+
+#include "uca-scale-filter.h"
+
+#define UCA_SCALE_FILTER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UCA_TYPE_SCALE_FILTER, UcaScaleFilterPrivate))
+
+static void uca_scale_filter_iface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UcaScaleFilter, uca_scale_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER,
+                                                uca_scale_filter_iface_init))
+
+enum {
+    PROP_0,
+    PROP_OFFSET,
+    PROP_GAIN,
+    N_PROPERTIES
+};
+
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+struct _UcaScaleFilterPrivate {
+    gdouble offset;
+    gdouble gain;
+    guint16 *table;
+    guint table_pixel_size;
+};
+
+static gboolean
+uca_scale_filter_setup (UcaFilter *filter, guint width, guint height, guint pixel_size, GError **error)
+{
+    UcaScaleFilterPrivate *priv;
+    guint n_values;
+    gdouble max;
+
+    priv = UCA_SCALE_FILTER (filter)->priv;
+
+    if (pixel_size != 1 && pixel_size != 2) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_UNSUPPORTED,
+                     "Scale filter only supports 8 and 16 bit pixels");
+        return FALSE;
+    }
+
+    /* A lookup table is cheaper than floating point math even for 16 bits */
+    n_values = 1 << (8 * pixel_size);
+    max = n_values - 1;
+
+    g_free (priv->table);
+    priv->table = g_new (guint16, n_values);
+    priv->table_pixel_size = pixel_size;
+
+    for (guint i = 0; i < n_values; i++) {
+        gdouble value = CLAMP ((i - priv->offset) * priv->gain, 0.0, max);
+
+        priv->table[i] = (guint16) (value + 0.5);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+uca_scale_filter_process (UcaFilter *filter, gpointer data, guint width, guint height,
+                          guint pixel_size, GError **error)
+{
+    UcaScaleFilterPrivate *priv;
+    gsize n_pixels;
+
+    priv = UCA_SCALE_FILTER (filter)->priv;
+    n_pixels = (gsize) width * height;
+
+    if (priv->table == NULL || priv->table_pixel_size != pixel_size) {
+        g_set_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_NOT_SET_UP,
+                     "Scale filter was not set up for %u byte pixels", pixel_size);
+        return FALSE;
+    }
+
+    if (pixel_size == 1) {
+        guint8 *pixels = data;
+
+        for (gsize i = 0; i < n_pixels; i++)
+            pixels[i] = (guint8) priv->table[pixels[i]];
+    }
+    else {
+        guint16 *pixels = data;
+
+        for (gsize i = 0; i < n_pixels; i++)
+            pixels[i] = priv->table[pixels[i]];
+    }
+
+    return TRUE;
+}
+
+/**
+ * uca_scale_filter_new:
+ * @offset: Value subtracted from every pixel
+ * @gain: Factor applied after subtracting @offset
+ *
+ * Create a new linear scaling filter.
+ *
+ * Return value: (transfer full): A new #UcaFilter
+ * Since: 2.5
+ */
+UcaFilter *
+uca_scale_filter_new (gdouble offset, gdouble gain)
+{
+    return g_object_new (UCA_TYPE_SCALE_FILTER, "offset", offset, "gain", gain, NULL);
+}
+
+static void
+uca_scale_filter_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
+{
+    UcaScaleFilterPrivate *priv = UCA_SCALE_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_OFFSET:
+            g_value_set_double (value, priv->offset);
+            break;
+        case PROP_GAIN:
+            g_value_set_double (value, priv->gain);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_scale_filter_set_property (GObject *object, guint property_id, const GValue *value, GParamSpec *pspec)
+{
+    UcaScaleFilterPrivate *priv = UCA_SCALE_FILTER (object)->priv;
+
+    switch (property_id) {
+        case PROP_OFFSET:
+            priv->offset = g_value_get_double (value);
+            break;
+        case PROP_GAIN:
+            priv->gain = g_value_get_double (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+uca_scale_filter_finalize (GObject *object)
+{
+    UcaScaleFilterPrivate *priv = UCA_SCALE_FILTER (object)->priv;
+
+    g_free (priv->table);
+
+    G_OBJECT_CLASS (uca_scale_filter_parent_class)->finalize (object);
+}
+
+static void
+uca_scale_filter_iface_init (UcaFilterInterface *iface)
+{
+    iface->setup = uca_scale_filter_setup;
+    iface->process = uca_scale_filter_process;
+}
+
+static void
+uca_scale_filter_class_init (UcaScaleFilterClass *klass)
+{
+    GObjectClass *oclass;
+
+    oclass = G_OBJECT_CLASS (klass);
+    oclass->get_property = uca_scale_filter_get_property;
+    oclass->set_property = uca_scale_filter_set_property;
+    oclass->finalize = uca_scale_filter_finalize;
+
+    properties[PROP_OFFSET] =
+        g_param_spec_double ("offset",
+                             "Offset",
+                             "Value subtracted from every pixel",
+                             -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                             G_PARAM_READWRITE);
+
+    properties[PROP_GAIN] =
+        g_param_spec_double ("gain",
+                             "Gain",
+                             "Factor applied after subtracting the offset",
+                             -G_MAXDOUBLE, G_MAXDOUBLE, 1.0,
+                             G_PARAM_READWRITE);
+
+    for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
+        g_object_class_install_property (oclass, i, properties[i]);
+
+    g_type_class_add_private (klass, sizeof (UcaScaleFilterPrivate));
+}
+
+static void
+uca_scale_filter_init (UcaScaleFilter *filter)
+{
+    filter->priv = UCA_SCALE_FILTER_GET_PRIVATE (filter);
+    filter->priv->offset = 0.0;
+    filter->priv->gain = 1.0;
+    filter->priv->table = NULL;
+}
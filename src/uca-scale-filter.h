@@ -0,0 +1,56 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef UCA_SCALE_FILTER_H
+#define UCA_SCALE_FILTER_H
+
+#include <glib-object.h>
+#include "uca-api.h"
+#include "uca-filter.h"
+
+#define UCA_TYPE_SCALE_FILTER             (uca_scale_filter_get_type())
+#define UCA_SCALE_FILTER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UCA_TYPE_SCALE_FILTER, UcaScaleFilter))
+#define UCA_IS_SCALE_FILTER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UCA_TYPE_SCALE_FILTER))
+#define UCA_SCALE_FILTER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UCA_TYPE_SCALE_FILTER, UcaScaleFilterClass))
+#define UCA_IS_SCALE_FILTER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UCA_TYPE_SCALE_FILTER))
+#define UCA_SCALE_FILTER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UCA_TYPE_SCALE_FILTER, UcaScaleFilterClass))
+
+G_BEGIN_DECLS
+
+typedef struct _UcaScaleFilter           UcaScaleFilter;
+typedef struct _UcaScaleFilterClass      UcaScaleFilterClass;
+typedef struct _UcaScaleFilterPrivate    UcaScaleFilterPrivate;
+
+struct _UcaScaleFilter {
+    /*< private >*/
+    GObject parent;
+
+    UcaScaleFilterPrivate *priv;
+};
+
+struct _UcaScaleFilterClass {
+    /*< private >*/
+    GObjectClass parent;
+};
+
+UCA_API UcaFilter * uca_scale_filter_new      (gdouble offset,
+                                               gdouble gain);
+UCA_API GType       uca_scale_filter_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,1329 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+/**
+ * SECTION:uca-transform
+ * @Short_description: Mirror, rotate, pack, bin, correct, accumulate and analyse frames
+ * @Title: Frame transforms
+ *
+ * Every combination of a horizontal mirror and a rotation by a multiple of 90
+ * degrees is a transposition followed by reversing the rows, the columns or
+ * both. Without transposition, each row is copied or reversed as a whole.
+ * Transposition walks the frame in tiles small enough to keep source and
+ * destination in the cache and uses SSE2 to transpose 8x8 blocks of 16-bit and
+ * 16x16 blocks of 8-bit pixels where available.
+ *
+ * Packed pixels are stored as a little-endian bit stream without padding, so
+ * that the first pixel occupies the lowest bits of the first byte. This is the
+ * layout of the GenICam Mono10p and Mono12p formats. Packing and unpacking use
+ * SSSE3 byte shuffles if the CPU supports them.
+ *
+ * Binning sums the pixels of each block into a row of 32-bit accumulators, one
+ * source row at a time, and saturates the sums when storing the output row.
+ * Horizontal sums of two and four pixels are computed with SSE2.
+ *
+ * Flat-field correction multiplies the dark-subtracted pixels by a fixed-point
+ * gain. SSE2 assembles the 32-bit products from 16-bit multiplications of eight
+ * pixels at a time.
+ *
+ * Accumulation widens pixels to 32 bits with SSE2 unpacks and adds them to a
+ * row of sums, which lets a frame absorb thousands of frames without overflow.
+ *
+ * Frame statistics keep minimum, maximum, sums and the saturated pixel count
+ * in SSE2 registers and count the histogram of the same pixels while they are
+ * in the cache, so every frame is read only once.
+ */
+
+#include <string.h>
+#include "uca-transform.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+
+/* SSSE3 is not part of the x86-64 baseline, so it is selected at run-time */
+#if defined(HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define HAVE_SSSE3_DISPATCH
+#define SSSE3_FUNCTION __attribute__ ((target ("ssse3")))
+#endif
+
+/* Source tile edge for transposition, larger tiles thrash the L1 cache sets */
+#define TILE_SIZE   32
+
+#ifdef HAVE_SSE2
+static inline __m128i
+reverse_epi16 (__m128i v)
+{
+    v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+    v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+    return _mm_shuffle_epi32 (v, _MM_SHUFFLE (1, 0, 3, 2));
+}
+
+static inline __m128i
+reverse_epi8 (__m128i v)
+{
+    return reverse_epi16 (_mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8)));
+}
+#endif
+
+static void
+reverse_row_8 (const guint8 *src, guint8 *dst, guint width)
+{
+    guint x = 0;
+
+    /* dst points past the last pixel and is filled backwards */
+    dst += width;
+
+#ifdef HAVE_SSE2
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x));
+        _mm_storeu_si128 ((__m128i *) (dst - x - 16), reverse_epi8 (v));
+    }
+#endif
+
+    for (; x < width; x++)
+        *(dst - x - 1) = src[x];
+}
+
+static void
+reverse_row_16 (const guint16 *src, guint16 *dst, guint width)
+{
+    guint x = 0;
+
+    dst += width;
+
+#ifdef HAVE_SSE2
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x));
+        _mm_storeu_si128 ((__m128i *) (dst - x - 8), reverse_epi16 (v));
+    }
+#endif
+
+    for (; x < width; x++)
+        *(dst - x - 1) = src[x];
+}
+
+/*
+ * Copy rows without transposing. Rows are reversed for flip_h and their order
+ * is reversed for flip_v.
+ */
+static void
+copy_rows (const guint8 *src, guint8 *dst, guint width, guint height, guint pixel_size,
+           gboolean flip_h, gboolean flip_v)
+{
+    gsize stride = (gsize) width * pixel_size;
+
+    for (guint y = 0; y < height; y++) {
+        const guint8 *src_row = src + y * stride;
+        guint8 *dst_row = dst + (flip_v ? height - 1 - y : y) * stride;
+
+        if (!flip_h)
+            memcpy (dst_row, src_row, stride);
+        else if (pixel_size == 1)
+            reverse_row_8 (src_row, dst_row, width);
+        else
+            reverse_row_16 ((const guint16 *) src_row, (guint16 *) dst_row, width);
+    }
+}
+
+/*
+ * The transposed frame is @height pixels wide. Source pixel (x, y) is stored
+ * in row x and column y of the destination, counted from the end if flip_v or
+ * flip_h is set.
+ */
+typedef struct {
+    guint width;
+    guint height;
+    gboolean flip_h;
+    gboolean flip_v;
+} Transpose;
+
+static inline gsize
+dst_row (const Transpose *t, guint x)
+{
+    return (gsize) (t->flip_v ? t->width - 1 - x : x) * t->height;
+}
+
+static inline guint
+dst_column (const Transpose *t, guint y)
+{
+    return t->flip_h ? t->height - 1 - y : y;
+}
+
+/*
+ * First destination column of the n source rows starting at y. With flip_h the
+ * rows end up in reverse order, so they are read from the last one.
+ */
+static inline guint
+dst_block_column (const Transpose *t, guint y, guint n)
+{
+    return t->flip_h ? t->height - y - n : y;
+}
+
+static inline guint
+src_block_row (const Transpose *t, guint y, guint n, guint i)
+{
+    return t->flip_h ? y + n - 1 - i : y + i;
+}
+
+#ifdef HAVE_SSE2
+static inline void
+transpose_block_8 (const Transpose *t, const guint8 *src, guint8 *dst, guint x, guint y)
+{
+    __m128i a[16];
+    __m128i b[16];
+    guint column;
+
+    for (guint i = 0; i < 16; i++)
+        a[i] = _mm_loadu_si128 ((const __m128i *) (src + (gsize) src_block_row (t, y, 16, i) * t->width + x));
+
+    /* Four rounds of interleaving rows i and i + 8 transpose a 16x16 block */
+    for (guint round = 0; round < 4; round++) {
+        __m128i *in = round % 2 == 0 ? a : b;
+        __m128i *out = round % 2 == 0 ? b : a;
+
+        for (guint i = 0; i < 8; i++) {
+            out[2 * i] = _mm_unpacklo_epi8 (in[i], in[i + 8]);
+            out[2 * i + 1] = _mm_unpackhi_epi8 (in[i], in[i + 8]);
+        }
+    }
+
+    column = dst_block_column (t, y, 16);
+
+    for (guint i = 0; i < 16; i++)
+        _mm_storeu_si128 ((__m128i *) (dst + dst_row (t, x + i) + column), a[i]);
+}
+
+static inline void
+transpose_block_16 (const Transpose *t, const guint16 *src, guint16 *dst, guint x, guint y)
+{
+    __m128i a[8];
+    __m128i b[8];
+    guint column;
+
+    for (guint i = 0; i < 8; i++)
+        a[i] = _mm_loadu_si128 ((const __m128i *) (src + (gsize) src_block_row (t, y, 8, i) * t->width + x));
+
+    for (guint round = 0; round < 3; round++) {
+        __m128i *in = round % 2 == 0 ? a : b;
+        __m128i *out = round % 2 == 0 ? b : a;
+
+        for (guint i = 0; i < 4; i++) {
+            out[2 * i] = _mm_unpacklo_epi16 (in[i], in[i + 4]);
+            out[2 * i + 1] = _mm_unpackhi_epi16 (in[i], in[i + 4]);
+        }
+    }
+
+    /* An odd number of rounds leaves the result in b */
+    column = dst_block_column (t, y, 8);
+
+    for (guint i = 0; i < 8; i++)
+        _mm_storeu_si128 ((__m128i *) (dst + dst_row (t, x + i) + column), b[i]);
+}
+#endif
+
+/*
+ * Transpose the tile [x0, x1) x [y0, y1) in blocks and the remaining pixels at
+ * its right and bottom edge one by one.
+ */
+static void
+transpose_tile_8 (const Transpose *t, const guint8 *src, guint8 *dst,
+                  guint x0, guint x1, guint y0, guint y1)
+{
+    guint xb = x0;
+    guint yb = y0;
+
+#ifdef HAVE_SSE2
+    xb = x0 + (x1 - x0) / 16 * 16;
+    yb = y0 + (y1 - y0) / 16 * 16;
+
+    for (guint y = y0; y < yb; y += 16)
+        for (guint x = x0; x < xb; x += 16)
+            transpose_block_8 (t, src, dst, x, y);
+#endif
+
+    for (guint y = y0; y < y1; y++) {
+        const guint8 *src_row = src + (gsize) y * t->width;
+        guint column = dst_column (t, y);
+
+        for (guint x = y < yb ? xb : x0; x < x1; x++)
+            dst[dst_row (t, x) + column] = src_row[x];
+    }
+}
+
+static void
+transpose_tile_16 (const Transpose *t, const guint16 *src, guint16 *dst,
+                   guint x0, guint x1, guint y0, guint y1)
+{
+    guint xb = x0;
+    guint yb = y0;
+
+#ifdef HAVE_SSE2
+    xb = x0 + (x1 - x0) / 8 * 8;
+    yb = y0 + (y1 - y0) / 8 * 8;
+
+    for (guint y = y0; y < yb; y += 8)
+        for (guint x = x0; x < xb; x += 8)
+            transpose_block_16 (t, src, dst, x, y);
+#endif
+
+    for (guint y = y0; y < y1; y++) {
+        const guint16 *src_row = src + (gsize) y * t->width;
+        guint column = dst_column (t, y);
+
+        for (guint x = y < yb ? xb : x0; x < x1; x++)
+            dst[dst_row (t, x) + column] = src_row[x];
+    }
+}
+
+static void
+transpose (const guint8 *src, guint8 *dst, guint width, guint height, guint pixel_size,
+           gboolean flip_h, gboolean flip_v)
+{
+    Transpose t = { width, height, flip_h, flip_v };
+
+    for (guint y = 0; y < height; y += TILE_SIZE) {
+        guint y1 = MIN (y + TILE_SIZE, height);
+
+        for (guint x = 0; x < width; x += TILE_SIZE) {
+            guint x1 = MIN (x + TILE_SIZE, width);
+
+            if (pixel_size == 1)
+                transpose_tile_8 (&t, src, dst, x, x1, y, y1);
+            else
+                transpose_tile_16 (&t, (const guint16 *) src, (guint16 *) dst, x, x1, y, y1);
+        }
+    }
+}
+
+/**
+ * uca_transform_frame:
+ * @src: (type gulong): Frame to transform
+ * @dst: (type gulong): Location to store the transformed frame. Must not
+ *  overlap with @src.
+ * @width: Width of @src in pixels
+ * @height: Height of @src in pixels
+ * @pixel_size: Number of bytes per pixel, either 1 or 2
+ * @mirror: %TRUE to flip @src horizontally
+ * @rotate: Number of clockwise rotations by 90 degrees applied after
+ *  mirroring, between 0 and 3
+ *
+ * Mirror and rotate @src into @dst, as requested by #UcaCamera:mirror and
+ * #UcaCamera:rotate. If @rotate is odd, @dst is @height pixels wide and @width
+ * pixels high.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_frame (gconstpointer src, gpointer dst, guint width, guint height,
+                     guint pixel_size, gboolean mirror, guint rotate)
+{
+    g_return_if_fail (src != NULL && dst != NULL && src != dst);
+    g_return_if_fail (pixel_size == 1 || pixel_size == 2);
+    g_return_if_fail (rotate < 4);
+
+    switch (rotate) {
+        case 0:
+            copy_rows (src, dst, width, height, pixel_size, mirror, FALSE);
+            break;
+        case 1:
+            transpose (src, dst, width, height, pixel_size, TRUE, mirror);
+            break;
+        case 2:
+            copy_rows (src, dst, width, height, pixel_size, !mirror, TRUE);
+            break;
+        case 3:
+            transpose (src, dst, width, height, pixel_size, FALSE, !mirror);
+            break;
+    }
+}
+
+#ifdef HAVE_SSSE3_DISPATCH
+/*
+ * The SIMD loops process 8 pixels at a time but load and store 16 bytes, so
+ * they stop as soon as that would go beyond the end of the packed buffer. They
+ * return the number of pixels done, the scalar code handles the rest.
+ */
+SSSE3_FUNCTION static gsize
+unpack_12_ssse3 (const guint8 *src, guint16 *dst, gsize n_pixels, gsize n_bytes)
+{
+    const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i low = _mm_set1_epi32 (0x00000FFF);
+    const __m128i high = _mm_set1_epi32 (0x0FFF0000);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels && i / 2 * 3 + 16 <= n_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i / 2 * 3));
+
+        /* Every 32-bit lane holds two pixels in its lower 24 bits */
+        v = _mm_shuffle_epi8 (v, shuffle);
+        v = _mm_or_si128 (_mm_and_si128 (v, low), _mm_and_si128 (_mm_slli_epi32 (v, 4), high));
+        _mm_storeu_si128 ((__m128i *) (dst + i), v);
+    }
+
+    return i;
+}
+
+SSSE3_FUNCTION static gsize
+unpack_10_ssse3 (const guint8 *src, guint16 *dst, gsize n_pixels, gsize n_bytes)
+{
+    const __m128i shuffle = _mm_setr_epi8 (0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9);
+    const __m128i scale = _mm_setr_epi16 (64, 16, 4, 1, 64, 16, 4, 1);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels && i / 4 * 5 + 16 <= n_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i / 4 * 5));
+
+        /*
+         * Every 16-bit lane holds a pixel starting at bit 0, 2, 4 or 6. Shift
+         * it to the top and back down to drop the bits of its neighbours.
+         */
+        v = _mm_shuffle_epi8 (v, shuffle);
+        v = _mm_srli_epi16 (_mm_mullo_epi16 (v, scale), 6);
+        _mm_storeu_si128 ((__m128i *) (dst + i), v);
+    }
+
+    return i;
+}
+
+SSSE3_FUNCTION static gsize
+pack_12_ssse3 (const guint16 *src, guint8 *dst, gsize n_pixels, gsize n_bytes)
+{
+    const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i mask = _mm_set1_epi16 (0x0FFF);
+    const __m128i scale = _mm_setr_epi16 (1, 4096, 1, 4096, 1, 4096, 1, 4096);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels && i / 2 * 3 + 16 <= n_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+        /* Combine pixel pairs into 24-bit values and drop the fourth byte */
+        v = _mm_madd_epi16 (_mm_and_si128 (v, mask), scale);
+        _mm_storeu_si128 ((__m128i *) (dst + i / 2 * 3), _mm_shuffle_epi8 (v, shuffle));
+    }
+
+    return i;
+}
+
+SSSE3_FUNCTION static gsize
+pack_10_ssse3 (const guint16 *src, guint8 *dst, gsize n_pixels, gsize n_bytes)
+{
+    const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+    const __m128i mask = _mm_set1_epi16 (0x03FF);
+    const __m128i scale = _mm_setr_epi16 (1, 1024, 1, 1024, 1, 1024, 1, 1024);
+    const __m128i low = _mm_set_epi32 (0, 0x000FFFFF, 0, 0x000FFFFF);
+    const __m128i high = _mm_set_epi32 (0xFF, (gint) 0xFFF00000, 0xFF, (gint) 0xFFF00000);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels && i / 4 * 5 + 16 <= n_bytes; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+        /* Pixel pairs become 20-bit values, pairs of those 40-bit values */
+        v = _mm_madd_epi16 (_mm_and_si128 (v, mask), scale);
+        v = _mm_or_si128 (_mm_and_si128 (v, low), _mm_and_si128 (_mm_srli_epi64 (v, 12), high));
+        _mm_storeu_si128 ((__m128i *) (dst + i / 4 * 5), _mm_shuffle_epi8 (v, shuffle));
+    }
+
+    return i;
+}
+
+static gboolean
+have_ssse3 (void)
+{
+    return __builtin_cpu_supports ("ssse3");
+}
+#endif
+
+/*
+ * Unpack the remaining pixels starting at pixel i, which must begin on a byte
+ * boundary.
+ */
+static void
+unpack_bits (const guint8 *src, guint16 *dst, gsize i, gsize n_pixels, guint bits)
+{
+    guint32 mask = (1 << bits) - 1;
+    guint32 acc = 0;
+    guint n_acc = 0;
+
+    src += i * bits / 8;
+
+    for (; i < n_pixels; i++) {
+        while (n_acc < bits) {
+            acc |= (guint32) *src++ << n_acc;
+            n_acc += 8;
+        }
+
+        dst[i] = (guint16) (acc & mask);
+        acc >>= bits;
+        n_acc -= bits;
+    }
+}
+
+static void
+pack_bits (const guint16 *src, guint8 *dst, gsize i, gsize n_pixels, guint bits)
+{
+    guint32 mask = (1 << bits) - 1;
+    guint32 acc = 0;
+    guint n_acc = 0;
+
+    dst += i * bits / 8;
+
+    for (; i < n_pixels; i++) {
+        acc |= (src[i] & mask) << n_acc;
+        n_acc += bits;
+
+        while (n_acc >= 8) {
+            *dst++ = (guint8) acc;
+            acc >>= 8;
+            n_acc -= 8;
+        }
+    }
+
+    if (n_acc > 0)
+        *dst = (guint8) acc;
+}
+
+/**
+ * uca_transform_get_packed_size:
+ * @n_pixels: Number of pixels
+ * @bits: Number of bits per pixel
+ *
+ * Returns: The number of bytes needed to store @n_pixels packed pixels.
+ * Since: 2.5
+ */
+gsize
+uca_transform_get_packed_size (gsize n_pixels, guint bits)
+{
+    return (n_pixels * bits + 7) / 8;
+}
+
+/**
+ * uca_transform_unpack:
+ * @src: (type gulong): Packed pixels
+ * @dst: (type gulong): Location to store @n_pixels 16-bit pixels
+ * @n_pixels: Number of pixels
+ * @bits: Number of bits per packed pixel, either 8, 10, 12 or 16
+ *
+ * Expand packed pixels to one 16-bit word per pixel, for example a frame
+ * grabbed with #UcaCamera:pixel-format set to
+ * %UCA_CAMERA_PIXEL_FORMAT_MONO12P.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_unpack (gconstpointer src, guint16 *dst, gsize n_pixels, guint bits)
+{
+    const guint8 *bytes = src;
+    gsize n_bytes;
+    gsize i = 0;
+
+    g_return_if_fail (src != NULL && dst != NULL);
+    g_return_if_fail (bits == 8 || bits == 10 || bits == 12 || bits == 16);
+
+    n_bytes = uca_transform_get_packed_size (n_pixels, bits);
+
+    switch (bits) {
+        case 8:
+            for (; i < n_pixels; i++)
+                dst[i] = bytes[i];
+            break;
+        case 10:
+#ifdef HAVE_SSSE3_DISPATCH
+            if (have_ssse3 ())
+                i = unpack_10_ssse3 (bytes, dst, n_pixels, n_bytes);
+#endif
+            for (; i + 4 <= n_pixels; i += 4) {
+                const guint8 *b = bytes + i / 4 * 5;
+                guint64 w = b[0] | (guint64) b[1] << 8 | (guint64) b[2] << 16 |
+                            (guint64) b[3] << 24 | (guint64) b[4] << 32;
+
+                dst[i] = w & 0x3FF;
+                dst[i + 1] = (w >> 10) & 0x3FF;
+                dst[i + 2] = (w >> 20) & 0x3FF;
+                dst[i + 3] = (w >> 30) & 0x3FF;
+            }
+
+            unpack_bits (bytes, dst, i, n_pixels, bits);
+            break;
+        case 12:
+#ifdef HAVE_SSSE3_DISPATCH
+            if (have_ssse3 ())
+                i = unpack_12_ssse3 (bytes, dst, n_pixels, n_bytes);
+#endif
+            for (; i + 2 <= n_pixels; i += 2) {
+                const guint8 *b = bytes + i / 2 * 3;
+
+                dst[i] = b[0] | (b[1] & 0x0F) << 8;
+                dst[i + 1] = b[1] >> 4 | b[2] << 4;
+            }
+
+            unpack_bits (bytes, dst, i, n_pixels, bits);
+            break;
+        case 16:
+            memcpy (dst, src, n_bytes);
+            break;
+    }
+}
+
+/**
+ * uca_transform_pack:
+ * @src: (type gulong): 16-bit pixels
+ * @dst: (type gulong): Location to store the packed pixels, see
+ *  uca_transform_get_packed_size()
+ * @n_pixels: Number of pixels
+ * @bits: Number of bits per packed pixel, either 8, 10, 12 or 16
+ *
+ * Store the lower @bits bits of each pixel in @src as a packed bit stream. This
+ * is the inverse of uca_transform_unpack().
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_pack (const guint16 *src, gpointer dst, gsize n_pixels, guint bits)
+{
+    guint8 *bytes = dst;
+    gsize n_bytes;
+    gsize i = 0;
+
+    g_return_if_fail (src != NULL && dst != NULL);
+    g_return_if_fail (bits == 8 || bits == 10 || bits == 12 || bits == 16);
+
+    n_bytes = uca_transform_get_packed_size (n_pixels, bits);
+
+    switch (bits) {
+        case 8:
+            for (; i < n_pixels; i++)
+                bytes[i] = (guint8) src[i];
+            break;
+        case 10:
+#ifdef HAVE_SSSE3_DISPATCH
+            if (have_ssse3 ())
+                i = pack_10_ssse3 (src, bytes, n_pixels, n_bytes);
+#endif
+            for (; i + 4 <= n_pixels; i += 4) {
+                guint8 *b = bytes + i / 4 * 5;
+                guint64 w = (guint64) (src[i] & 0x3FF) |
+                            (guint64) (src[i + 1] & 0x3FF) << 10 |
+                            (guint64) (src[i + 2] & 0x3FF) << 20 |
+                            (guint64) (src[i + 3] & 0x3FF) << 30;
+
+                for (guint j = 0; j < 5; j++)
+                    b[j] = (guint8) (w >> (8 * j));
+            }
+
+            pack_bits (src, bytes, i, n_pixels, bits);
+            break;
+        case 12:
+#ifdef HAVE_SSSE3_DISPATCH
+            if (have_ssse3 ())
+                i = pack_12_ssse3 (src, bytes, n_pixels, n_bytes);
+#endif
+            for (; i + 2 <= n_pixels; i += 2) {
+                guint8 *b = bytes + i / 2 * 3;
+
+                b[0] = (guint8) src[i];
+                b[1] = (guint8) ((src[i] >> 8) & 0x0F) | (guint8) (src[i + 1] << 4);
+                b[2] = (guint8) (src[i + 1] >> 4);
+            }
+
+            pack_bits (src, bytes, i, n_pixels, bits);
+            break;
+        case 16:
+            memcpy (dst, src, n_bytes);
+            break;
+    }
+}
+
+#ifdef HAVE_SSE2
+/*
+ * The SIMD loops add the horizontal sums of 2 or 4 pixels to @acc and return
+ * the number of sums done, the scalar code handles the rest.
+ */
+static guint
+accumulate_row_8_sse2 (const guint8 *src, guint32 *acc, guint width, guint horizontal)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i low = _mm_set1_epi16 (0x00FF);
+    const __m128i ones = _mm_set1_epi16 (1);
+    guint x = 0;
+
+    if (horizontal == 2) {
+        for (; x + 8 <= width; x += 8) {
+            __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+            __m128i sum = _mm_add_epi16 (_mm_and_si128 (v, low), _mm_srli_epi16 (v, 8));
+            __m128i a0 = _mm_loadu_si128 ((const __m128i *) (acc + x));
+            __m128i a1 = _mm_loadu_si128 ((const __m128i *) (acc + x + 4));
+
+            _mm_storeu_si128 ((__m128i *) (acc + x), _mm_add_epi32 (a0, _mm_unpacklo_epi16 (sum, zero)));
+            _mm_storeu_si128 ((__m128i *) (acc + x + 4), _mm_add_epi32 (a1, _mm_unpackhi_epi16 (sum, zero)));
+        }
+    }
+    else if (horizontal == 4) {
+        for (; x + 4 <= width; x += 4) {
+            __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+            __m128i sum = _mm_add_epi16 (_mm_and_si128 (v, low), _mm_srli_epi16 (v, 8));
+            __m128i a = _mm_loadu_si128 ((const __m128i *) (acc + x));
+
+            /* Pairs of 16-bit sums are at most 1020, so the signed madd is fine */
+            _mm_storeu_si128 ((__m128i *) (acc + x), _mm_add_epi32 (a, _mm_madd_epi16 (sum, ones)));
+        }
+    }
+
+    return x;
+}
+
+static guint
+accumulate_row_16_sse2 (const guint16 *src, guint32 *acc, guint width, guint horizontal)
+{
+    const __m128i low = _mm_set1_epi32 (0xFFFF);
+    guint x = 0;
+
+    if (horizontal == 2) {
+        for (; x + 4 <= width; x += 4) {
+            __m128i v = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+            __m128i sum = _mm_add_epi32 (_mm_and_si128 (v, low), _mm_srli_epi32 (v, 16));
+            __m128i a = _mm_loadu_si128 ((const __m128i *) (acc + x));
+
+            _mm_storeu_si128 ((__m128i *) (acc + x), _mm_add_epi32 (a, sum));
+        }
+    }
+    else if (horizontal == 4) {
+        for (; x + 4 <= width; x += 4) {
+            __m128i v0 = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+            __m128i v1 = _mm_loadu_si128 ((const __m128i *) (src + x * 4 + 8));
+            __m128i s0 = _mm_add_epi32 (_mm_and_si128 (v0, low), _mm_srli_epi32 (v0, 16));
+            __m128i s1 = _mm_add_epi32 (_mm_and_si128 (v1, low), _mm_srli_epi32 (v1, 16));
+            __m128i a = _mm_loadu_si128 ((const __m128i *) (acc + x));
+
+            /* Add neighbouring pair sums of both vectors */
+            s0 = _mm_shuffle_epi32 (s0, _MM_SHUFFLE (3, 1, 2, 0));
+            s1 = _mm_shuffle_epi32 (s1, _MM_SHUFFLE (3, 1, 2, 0));
+            a = _mm_add_epi32 (a, _mm_add_epi32 (_mm_unpacklo_epi64 (s0, s1), _mm_unpackhi_epi64 (s0, s1)));
+            _mm_storeu_si128 ((__m128i *) (acc + x), a);
+        }
+    }
+
+    return x;
+}
+
+static guint
+store_row_8_sse2 (const guint32 *acc, guint8 *dst, guint width)
+{
+    guint x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i a0 = _mm_loadu_si128 ((const __m128i *) (acc + x));
+        __m128i a1 = _mm_loadu_si128 ((const __m128i *) (acc + x + 4));
+        __m128i v = _mm_packs_epi32 (a0, a1);
+
+        /* Both packs saturate, which clamps the sums to 255 */
+        _mm_storel_epi64 ((__m128i *) (dst + x), _mm_packus_epi16 (v, v));
+    }
+
+    return x;
+}
+
+static inline __m128i
+saturate_epi32_to_16 (__m128i a)
+{
+    /* Set all bits of sums that are too large and sign-extend the lower half */
+    a = _mm_or_si128 (a, _mm_cmpgt_epi32 (a, _mm_set1_epi32 (G_MAXUINT16)));
+    return _mm_srai_epi32 (_mm_slli_epi32 (a, 16), 16);
+}
+
+static guint
+store_row_16_sse2 (const guint32 *acc, guint16 *dst, guint width)
+{
+    guint x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i a0 = saturate_epi32_to_16 (_mm_loadu_si128 ((const __m128i *) (acc + x)));
+        __m128i a1 = saturate_epi32_to_16 (_mm_loadu_si128 ((const __m128i *) (acc + x + 4)));
+
+        _mm_storeu_si128 ((__m128i *) (dst + x), _mm_packs_epi32 (a0, a1));
+    }
+
+    return x;
+}
+#endif
+
+static void
+accumulate_row_8 (const guint8 *src, guint32 *acc, guint width, guint horizontal)
+{
+    guint x = 0;
+
+#ifdef HAVE_SSE2
+    x = accumulate_row_8_sse2 (src, acc, width, horizontal);
+#endif
+
+    for (src += x * horizontal; x < width; x++) {
+        for (guint i = 0; i < horizontal; i++)
+            acc[x] += *src++;
+    }
+}
+
+static void
+accumulate_row_16 (const guint16 *src, guint32 *acc, guint width, guint horizontal)
+{
+    guint x = 0;
+
+#ifdef HAVE_SSE2
+    x = accumulate_row_16_sse2 (src, acc, width, horizontal);
+#endif
+
+    for (src += x * horizontal; x < width; x++) {
+        for (guint i = 0; i < horizontal; i++)
+            acc[x] += *src++;
+    }
+}
+
+static void
+store_row_8 (const guint32 *acc, guint8 *dst, guint width)
+{
+    guint x = 0;
+
+#ifdef HAVE_SSE2
+    x = store_row_8_sse2 (acc, dst, width);
+#endif
+
+    for (; x < width; x++)
+        dst[x] = (guint8) MIN (acc[x], G_MAXUINT8);
+}
+
+static void
+store_row_16 (const guint32 *acc, guint16 *dst, guint width)
+{
+    guint x = 0;
+
+#ifdef HAVE_SSE2
+    x = store_row_16_sse2 (acc, dst, width);
+#endif
+
+    for (; x < width; x++)
+        dst[x] = (guint16) MIN (acc[x], G_MAXUINT16);
+}
+
+/**
+ * uca_transform_bin:
+ * @src: (type gulong): First pixel of the region to bin
+ * @src_stride: Distance between two rows of @src in bytes
+ * @dst: (type gulong): Location to store @width times @height binned pixels
+ * @width: Width of the binned frame
+ * @height: Height of the binned frame
+ * @horizontal: Number of pixels to bin horizontally, at most 64
+ * @vertical: Number of pixels to bin vertically, at most 64
+ * @pixel_size: Number of bytes per pixel of @src, either 1 or 2
+ * @widen: Store 8-bit sums in 16 bits
+ *
+ * Sum blocks of @horizontal times @vertical pixels. Sums that do not fit into
+ * the output pixels saturate. If @widen is %TRUE, 8-bit frames are binned into
+ * 16-bit pixels so that nothing is lost. There is no wider format for 16-bit
+ * frames, which therefore always saturate.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_bin (gconstpointer src, gsize src_stride, gpointer dst, guint width, guint height,
+                   guint horizontal, guint vertical, guint pixel_size, gboolean widen)
+{
+    guint32 *acc;
+    guint dst_pixel_size;
+
+    g_return_if_fail (src != NULL && dst != NULL);
+    g_return_if_fail (horizontal >= 1 && horizontal <= 64 && vertical >= 1 && vertical <= 64);
+    g_return_if_fail (pixel_size == 1 || pixel_size == 2);
+
+    dst_pixel_size = widen ? 2 : pixel_size;
+    acc = g_new (guint32, width);
+
+    for (guint y = 0; y < height; y++) {
+        guint8 *dst_row = (guint8 *) dst + (gsize) y * width * dst_pixel_size;
+
+        memset (acc, 0, width * sizeof (guint32));
+
+        for (guint i = 0; i < vertical; i++) {
+            const guint8 *row = (const guint8 *) src + ((gsize) y * vertical + i) * src_stride;
+
+            if (pixel_size == 1)
+                accumulate_row_8 (row, acc, width, horizontal);
+            else
+                accumulate_row_16 ((const guint16 *) row, acc, width, horizontal);
+        }
+
+        if (dst_pixel_size == 1)
+            store_row_8 (acc, dst_row, width);
+        else
+            store_row_16 (acc, (guint16 *) dst_row, width);
+    }
+
+    g_free (acc);
+}
+
+#ifdef HAVE_SSE2
+/*
+ * Correct eight pixels given as 16-bit lanes. The 32-bit products are
+ * assembled from the low and high halves of the 16-bit multiplications.
+ */
+static inline void
+correct_8_sse2 (__m128i raw, const guint16 *dark, const guint16 *gain,
+                __m128i round, __m128i shift, __m128i max, __m128i *lo, __m128i *hi)
+{
+    const __m128i bias = _mm_set1_epi32 (G_MININT32);
+    __m128i d = _mm_subs_epu16 (raw, _mm_loadu_si128 ((const __m128i *) dark));
+    __m128i g = _mm_loadu_si128 ((const __m128i *) gain);
+    __m128i p_lo = _mm_mullo_epi16 (d, g);
+    __m128i p_hi = _mm_mulhi_epu16 (d, g);
+    __m128i v0 = _mm_srl_epi32 (_mm_add_epi32 (_mm_unpacklo_epi16 (p_lo, p_hi), round), shift);
+    __m128i v1 = _mm_srl_epi32 (_mm_add_epi32 (_mm_unpackhi_epi16 (p_lo, p_hi), round), shift);
+
+    /* There is no unsigned 32-bit comparison, so both sides are biased */
+    __m128i m0 = _mm_cmpgt_epi32 (_mm_xor_si128 (v0, bias), _mm_xor_si128 (max, bias));
+    __m128i m1 = _mm_cmpgt_epi32 (_mm_xor_si128 (v1, bias), _mm_xor_si128 (max, bias));
+
+    *lo = _mm_or_si128 (_mm_andnot_si128 (m0, v0), _mm_and_si128 (m0, max));
+    *hi = _mm_or_si128 (_mm_andnot_si128 (m1, v1), _mm_and_si128 (m1, max));
+}
+
+static gsize
+correct_8_pixels_sse2 (const guint8 *src, guint8 *dst, const guint16 *dark, const guint16 *gain,
+                       gsize n_pixels, guint shift)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i round = _mm_set1_epi32 (shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i count = _mm_cvtsi32_si128 ((int) shift);
+    const __m128i max = _mm_set1_epi32 (G_MAXUINT8);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels; i += 8) {
+        __m128i raw = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (src + i)), zero);
+        __m128i lo, hi, v;
+
+        correct_8_sse2 (raw, dark + i, gain + i, round, count, max, &lo, &hi);
+        v = _mm_packs_epi32 (lo, hi);
+        _mm_storel_epi64 ((__m128i *) (dst + i), _mm_packus_epi16 (v, v));
+    }
+
+    return i;
+}
+
+static gsize
+correct_16_pixels_sse2 (const guint16 *src, guint16 *dst, const guint16 *dark, const guint16 *gain,
+                        gsize n_pixels, guint shift)
+{
+    const __m128i round = _mm_set1_epi32 (shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i count = _mm_cvtsi32_si128 ((int) shift);
+    const __m128i max = _mm_set1_epi32 (G_MAXUINT16);
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels; i += 8) {
+        __m128i raw = _mm_loadu_si128 ((const __m128i *) (src + i));
+        __m128i lo, hi;
+
+        correct_8_sse2 (raw, dark + i, gain + i, round, count, max, &lo, &hi);
+
+        /* Sign-extend the lower halves so that the signed pack keeps them */
+        lo = _mm_srai_epi32 (_mm_slli_epi32 (lo, 16), 16);
+        hi = _mm_srai_epi32 (_mm_slli_epi32 (hi, 16), 16);
+        _mm_storeu_si128 ((__m128i *) (dst + i), _mm_packs_epi32 (lo, hi));
+    }
+
+    return i;
+}
+#endif
+
+static inline guint32
+correct_pixel (guint32 raw, guint32 dark, guint32 gain, guint32 round, guint shift, guint32 max)
+{
+    guint32 value;
+
+    value = ((raw > dark ? raw - dark : 0) * gain + round) >> shift;
+    return MIN (value, max);
+}
+
+/**
+ * uca_transform_correct:
+ * @src: (type gulong): Pixels to correct
+ * @dst: (type gulong): Location to store @n_pixels corrected pixels, may be
+ *  @src
+ * @dark: Dark value of every pixel
+ * @gain: Fixed-point gain of every pixel with @shift fractional bits
+ * @n_pixels: Number of pixels
+ * @shift: Number of fractional bits of @gain, at most 16
+ * @pixel_size: Number of bytes per pixel, either 1 or 2
+ *
+ * Compute (@src - @dark) * @gain for every pixel. Differences below zero are
+ * clamped to zero, results are rounded and saturate at the maximum of the pixel
+ * type. All arithmetic is done on integers.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_correct (gconstpointer src, gpointer dst, const guint16 *dark, const guint16 *gain,
+                       gsize n_pixels, guint shift, guint pixel_size)
+{
+    guint32 round;
+    gsize i = 0;
+
+    g_return_if_fail (src != NULL && dst != NULL && dark != NULL && gain != NULL);
+    g_return_if_fail (shift <= 16);
+    g_return_if_fail (pixel_size == 1 || pixel_size == 2);
+
+    round = shift > 0 ? 1 << (shift - 1) : 0;
+
+    if (pixel_size == 1) {
+        const guint8 *s = src;
+        guint8 *d = dst;
+
+#ifdef HAVE_SSE2
+        i = correct_8_pixels_sse2 (s, d, dark, gain, n_pixels, shift);
+#endif
+
+        for (; i < n_pixels; i++)
+            d[i] = (guint8) correct_pixel (s[i], dark[i], gain[i], round, shift, G_MAXUINT8);
+    }
+    else {
+        const guint16 *s = src;
+        guint16 *d = dst;
+
+#ifdef HAVE_SSE2
+        i = correct_16_pixels_sse2 (s, d, dark, gain, n_pixels, shift);
+#endif
+
+        for (; i < n_pixels; i++)
+            d[i] = (guint16) correct_pixel (s[i], dark[i], gain[i], round, shift, G_MAXUINT16);
+    }
+}
+
+#ifdef HAVE_SSE2
+static gsize
+accumulate_8_sse2 (const guint8 *src, guint32 *sums, gsize n_pixels)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    gsize i = 0;
+
+    for (; i + 16 <= n_pixels; i += 16) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+        __m128i lo = _mm_unpacklo_epi8 (v, zero);
+        __m128i hi = _mm_unpackhi_epi8 (v, zero);
+        __m128i *s = (__m128i *) (sums + i);
+
+        _mm_storeu_si128 (s + 0, _mm_add_epi32 (_mm_loadu_si128 (s + 0), _mm_unpacklo_epi16 (lo, zero)));
+        _mm_storeu_si128 (s + 1, _mm_add_epi32 (_mm_loadu_si128 (s + 1), _mm_unpackhi_epi16 (lo, zero)));
+        _mm_storeu_si128 (s + 2, _mm_add_epi32 (_mm_loadu_si128 (s + 2), _mm_unpacklo_epi16 (hi, zero)));
+        _mm_storeu_si128 (s + 3, _mm_add_epi32 (_mm_loadu_si128 (s + 3), _mm_unpackhi_epi16 (hi, zero)));
+    }
+
+    return i;
+}
+
+static gsize
+accumulate_16_sse2 (const guint16 *src, guint32 *sums, gsize n_pixels)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+        __m128i *s = (__m128i *) (sums + i);
+
+        _mm_storeu_si128 (s + 0, _mm_add_epi32 (_mm_loadu_si128 (s + 0), _mm_unpacklo_epi16 (v, zero)));
+        _mm_storeu_si128 (s + 1, _mm_add_epi32 (_mm_loadu_si128 (s + 1), _mm_unpackhi_epi16 (v, zero)));
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * uca_transform_accumulate:
+ * @src: (type gulong): Pixels to add
+ * @sums: Location of @n_pixels sums to add @src to
+ * @n_pixels: Number of pixels
+ * @pixel_size: Number of bytes per pixel of @src, either 1 or 2
+ *
+ * Add every pixel of @src to the corresponding 32-bit sum. Sums wrap around on
+ * overflow, which takes more than 65537 frames of 16-bit pixels.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_accumulate (gconstpointer src, guint32 *sums, gsize n_pixels, guint pixel_size)
+{
+    gsize i = 0;
+
+    g_return_if_fail (src != NULL && sums != NULL);
+    g_return_if_fail (pixel_size == 1 || pixel_size == 2);
+
+    if (pixel_size == 1) {
+        const guint8 *pixels = src;
+
+#ifdef HAVE_SSE2
+        i = accumulate_8_sse2 (pixels, sums, n_pixels);
+#endif
+
+        for (; i < n_pixels; i++)
+            sums[i] += pixels[i];
+    }
+    else {
+        const guint16 *pixels = src;
+
+#ifdef HAVE_SSE2
+        i = accumulate_16_sse2 (pixels, sums, n_pixels);
+#endif
+
+        for (; i < n_pixels; i++)
+            sums[i] += pixels[i];
+    }
+}
+
+/*
+ * Consecutive pixels are counted in separate histograms, so that runs of equal
+ * values do not wait for the previous increment of the same bin.
+ */
+#define N_HISTOGRAMS    4
+
+static inline void
+add_pixel (UcaFrameStatistics *statistics, guint32 *bins, guint value, guint saturation, guint shift)
+{
+    statistics->min = MIN (statistics->min, value);
+    statistics->max = MAX (statistics->max, value);
+    statistics->sum += value;
+    statistics->sum_squares += (guint64) value * value;
+    statistics->n_saturated += value >= saturation;
+    bins[MIN (value >> shift, UCA_FRAME_STATISTICS_N_BINS - 1)]++;
+}
+
+#ifdef HAVE_SSE2
+static inline guint64
+sum_epi64 (__m128i v)
+{
+    guint64 lanes[2];
+
+    _mm_storeu_si128 ((__m128i *) lanes, v);
+    return lanes[0] + lanes[1];
+}
+
+static gsize
+statistics_8_sse2 (const guint8 *src, gsize n_pixels, guint saturation,
+                   UcaFrameStatistics *statistics, guint32 *bins)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i one = _mm_set1_epi8 (1);
+    const __m128i threshold = _mm_set1_epi8 ((gchar) saturation);
+    __m128i min = _mm_set1_epi8 ((gchar) 0xff);
+    __m128i max = zero;
+    __m128i sum = zero;
+    __m128i squares = zero;
+    __m128i saturated = zero;
+    guint8 lanes[16];
+    gsize i = 0;
+
+    for (; i + 16 <= n_pixels; i += 16) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+        __m128i lo = _mm_unpacklo_epi8 (v, zero);
+        __m128i hi = _mm_unpackhi_epi8 (v, zero);
+        __m128i sq = _mm_add_epi32 (_mm_madd_epi16 (lo, lo), _mm_madd_epi16 (hi, hi));
+        __m128i mask = _mm_cmpeq_epi8 (_mm_max_epu8 (v, threshold), v);
+
+        min = _mm_min_epu8 (min, v);
+        max = _mm_max_epu8 (max, v);
+        sum = _mm_add_epi64 (sum, _mm_sad_epu8 (v, zero));
+        squares = _mm_add_epi64 (squares, _mm_unpacklo_epi32 (sq, zero));
+        squares = _mm_add_epi64 (squares, _mm_unpackhi_epi32 (sq, zero));
+        saturated = _mm_add_epi64 (saturated, _mm_sad_epu8 (_mm_and_si128 (mask, one), zero));
+
+        /* The pixels are still in L1, counting them here keeps this one pass */
+        for (guint k = 0; k < 16; k++)
+            bins[(k % N_HISTOGRAMS) * UCA_FRAME_STATISTICS_N_BINS + src[i + k]]++;
+    }
+
+    _mm_storeu_si128 ((__m128i *) lanes, min);
+
+    for (guint k = 0; k < 16; k++)
+        statistics->min = MIN (statistics->min, lanes[k]);
+
+    _mm_storeu_si128 ((__m128i *) lanes, max);
+
+    for (guint k = 0; k < 16; k++)
+        statistics->max = MAX (statistics->max, lanes[k]);
+
+    statistics->sum += sum_epi64 (sum);
+    statistics->sum_squares += sum_epi64 (squares);
+    statistics->n_saturated += sum_epi64 (saturated);
+
+    return i;
+}
+
+/*
+ * SSE2 only compares and multiplies signed 16-bit integers, so the pixels are
+ * biased by -32768 first. The squares of the biased values s = v - 32768 are
+ * corrected with v^2 = s^2 + 65536 * v - 2^30.
+ */
+static gsize
+statistics_16_sse2 (const guint16 *src, gsize n_pixels, guint saturation, guint shift,
+                    UcaFrameStatistics *statistics, guint32 *bins)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i one = _mm_set1_epi16 (1);
+    const __m128i bias = _mm_set1_epi16 ((gshort) 0x8000);
+    const __m128i threshold = _mm_set1_epi16 ((gshort) ((saturation - 1) ^ 0x8000));
+    __m128i min = _mm_set1_epi16 (0x7fff);
+    __m128i max = bias;
+    __m128i sum = zero;
+    __m128i squares = zero;
+    __m128i saturated = zero;
+    guint16 lanes[8];
+    guint64 vector_sum;
+    gsize i = 0;
+
+    for (; i + 8 <= n_pixels; i += 8) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i));
+        __m128i s = _mm_xor_si128 (v, bias);
+        __m128i pairs = _mm_add_epi32 (_mm_unpacklo_epi16 (v, zero), _mm_unpackhi_epi16 (v, zero));
+        __m128i sq = _mm_madd_epi16 (s, s);
+        __m128i mask = _mm_cmpgt_epi16 (s, threshold);
+
+        min = _mm_min_epi16 (min, s);
+        max = _mm_max_epi16 (max, s);
+        sum = _mm_add_epi64 (sum, _mm_unpacklo_epi32 (pairs, zero));
+        sum = _mm_add_epi64 (sum, _mm_unpackhi_epi32 (pairs, zero));
+        squares = _mm_add_epi64 (squares, _mm_unpacklo_epi32 (sq, zero));
+        squares = _mm_add_epi64 (squares, _mm_unpackhi_epi32 (sq, zero));
+        saturated = _mm_add_epi64 (saturated, _mm_sad_epu8 (_mm_and_si128 (mask, one), zero));
+
+        for (guint k = 0; k < 8; k++) {
+            guint bin = MIN (src[i + k] >> shift, UCA_FRAME_STATISTICS_N_BINS - 1);
+
+            bins[(k % N_HISTOGRAMS) * UCA_FRAME_STATISTICS_N_BINS + bin]++;
+        }
+    }
+
+    _mm_storeu_si128 ((__m128i *) lanes, _mm_xor_si128 (min, bias));
+
+    for (guint k = 0; k < 8; k++)
+        statistics->min = MIN (statistics->min, lanes[k]);
+
+    _mm_storeu_si128 ((__m128i *) lanes, _mm_xor_si128 (max, bias));
+
+    for (guint k = 0; k < 8; k++)
+        statistics->max = MAX (statistics->max, lanes[k]);
+
+    vector_sum = sum_epi64 (sum);
+    statistics->sum += vector_sum;
+    statistics->sum_squares += sum_epi64 (squares) + (vector_sum << 16) - ((guint64) i << 30);
+    statistics->n_saturated += sum_epi64 (saturated);
+
+    return i;
+}
+#endif
+
+/**
+ * uca_transform_statistics:
+ * @src: (type gulong): Frame to analyse
+ * @width: Width of @src in pixels
+ * @height: Height of @src in pixels
+ * @pixel_size: Number of bytes per pixel, either 1 or 2
+ * @bits: Number of significant bits per pixel, at most 8 * @pixel_size
+ * @step: Analyse only every @step-th pixel of every @step-th row
+ * @statistics: (out caller-allocates): Location to store the statistics
+ *
+ * Compute minimum, maximum, sums, saturated pixels and histogram of a frame in
+ * a single pass. Pixels of value 2^@bits - 1 and above count as saturated and
+ * the histogram spans the range of @bits bits. Values that do not fit, for
+ * example after flat-field correction, are counted in the last bin.
+ *
+ * Since: 2.5
+ */
+void
+uca_transform_statistics (gconstpointer src, guint width, guint height, guint pixel_size,
+                          guint bits, guint step, UcaFrameStatistics *statistics)
+{
+    guint32 bins[N_HISTOGRAMS * UCA_FRAME_STATISTICS_N_BINS];
+    guint saturation;
+    guint shift;
+
+    g_return_if_fail (src != NULL && statistics != NULL);
+    g_return_if_fail (pixel_size == 1 || pixel_size == 2);
+    g_return_if_fail (bits >= 1 && bits <= 8 * pixel_size);
+    g_return_if_fail (step >= 1);
+
+    saturation = (1 << bits) - 1;
+    shift = bits > 8 ? bits - 8 : 0;
+
+    memset (statistics, 0, sizeof (UcaFrameStatistics));
+    memset (bins, 0, sizeof (bins));
+    statistics->min = G_MAXUINT;
+    statistics->histogram_shift = shift;
+
+    if (step == 1) {
+        gsize n_pixels = (gsize) width * height;
+        gsize i = 0;
+
+        if (pixel_size == 1) {
+            const guint8 *pixels = src;
+
+#ifdef HAVE_SSE2
+            i = statistics_8_sse2 (pixels, n_pixels, saturation, statistics, bins);
+#endif
+
+            for (; i < n_pixels; i++)
+                add_pixel (statistics, bins + (i % N_HISTOGRAMS) * UCA_FRAME_STATISTICS_N_BINS,
+                           pixels[i], saturation, shift);
+        }
+        else {
+            const guint16 *pixels = src;
+
+#ifdef HAVE_SSE2
+            i = statistics_16_sse2 (pixels, n_pixels, saturation, shift, statistics, bins);
+#endif
+
+            for (; i < n_pixels; i++)
+                add_pixel (statistics, bins + (i % N_HISTOGRAMS) * UCA_FRAME_STATISTICS_N_BINS,
+                           pixels[i], saturation, shift);
+        }
+
+        statistics->n_pixels = n_pixels;
+    }
+    else {
+        /* Strided pixels do not fill vectors, but there are step^2 fewer */
+        for (guint y = 0; y < height; y += step) {
+            gsize row = (gsize) y * width;
+
+            for (guint x = 0; x < width; x += step) {
+                guint value;
+
+                if (pixel_size == 1)
+                    value = ((const guint8 *) src)[row + x];
+                else
+                    value = ((const guint16 *) src)[row + x];
+
+                add_pixel (statistics, bins + (x / step % N_HISTOGRAMS) * UCA_FRAME_STATISTICS_N_BINS,
+                           value, saturation, shift);
+                statistics->n_pixels++;
+            }
+        }
+    }
+
+    if (statistics->n_pixels == 0)
+        statistics->min = 0;
+
+    for (guint k = 0; k < N_HISTOGRAMS; k++)
+        for (guint j = 0; j < UCA_FRAME_STATISTICS_N_BINS; j++)
+            statistics->histogram[j] += bins[k * UCA_FRAME_STATISTICS_N_BINS + j];
+}
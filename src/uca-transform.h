@@ -0,0 +1,116 @@
+/* Copyright (C) 2011-2013 Matthias Vogelgesang <matthias.vogelgesang@kit.edu>
+   (Karlsruhe Institute of Technology)
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+   FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+   details.
+
+   You should have received a copy of the GNU Lesser General Public License along
+   with this library; if not, write to the Free Software Foundation, Inc., 51
+   Franklin St, Fifth Floor, Boston, MA 02110, USA */
+
+#ifndef UCA_TRANSFORM_H
+#define UCA_TRANSFORM_H
+
+#include <glib.h>
+#include "uca-api.h"
+
+G_BEGIN_DECLS
+
+/**
+ * UCA_FRAME_STATISTICS_N_BINS:
+ *
+ * Number of bins in #UcaFrameStatistics.histogram.
+ *
+ * Since: 2.5
+ */
+#define UCA_FRAME_STATISTICS_N_BINS 256
+
+/**
+ * UcaFrameStatistics:
+ * @n_pixels: Number of pixels that were analysed
+ * @min: Smallest pixel value
+ * @max: Largest pixel value
+ * @sum: Sum of all pixel values
+ * @sum_squares: Sum of the squares of all pixel values
+ * @n_saturated: Number of pixels at or above the largest value of the bit
+ *  depth
+ * @histogram_shift: Number of bits pixel values are shifted to the right to
+ *  find their bin
+ * @histogram: Number of pixels in each bin
+ *
+ * Statistics of a frame computed by uca_transform_statistics(). The mean is
+ * @sum / @n_pixels and the variance (@sum_squares - @sum * @sum / @n_pixels)
+ * / (@n_pixels - 1). Bin i of @histogram counts the pixels whose value shifted
+ * right by @histogram_shift is i. The last bin also counts all larger values.
+ *
+ * Since: 2.5
+ */
+typedef struct {
+    guint64 n_pixels;
+    guint min;
+    guint max;
+    guint64 sum;
+    guint64 sum_squares;
+    guint64 n_saturated;
+    guint histogram_shift;
+    guint32 histogram[UCA_FRAME_STATISTICS_N_BINS];
+} UcaFrameStatistics;
+
+UCA_API void    uca_transform_frame     (gconstpointer  src,
+                                         gpointer       dst,
+                                         guint          width,
+                                         guint          height,
+                                         guint          pixel_size,
+                                         gboolean       mirror,
+                                         guint          rotate);
+UCA_API gsize   uca_transform_get_packed_size
+                                        (gsize          n_pixels,
+                                         guint          bits);
+UCA_API void    uca_transform_unpack    (gconstpointer  src,
+                                         guint16       *dst,
+                                         gsize          n_pixels,
+                                         guint          bits);
+UCA_API void    uca_transform_pack      (const guint16 *src,
+                                         gpointer       dst,
+                                         gsize          n_pixels,
+                                         guint          bits);
+UCA_API void    uca_transform_bin       (gconstpointer  src,
+                                         gsize          src_stride,
+                                         gpointer       dst,
+                                         guint          width,
+                                         guint          height,
+                                         guint          horizontal,
+                                         guint          vertical,
+                                         guint          pixel_size,
+                                         gboolean       widen);
+UCA_API void    uca_transform_correct   (gconstpointer  src,
+                                         gpointer       dst,
+                                         const guint16 *dark,
+                                         const guint16 *gain,
+                                         gsize          n_pixels,
+                                         guint          shift,
+                                         guint          pixel_size);
+UCA_API void    uca_transform_accumulate
+                                        (gconstpointer  src,
+                                         guint32       *sums,
+                                         gsize          n_pixels,
+                                         guint          pixel_size);
+UCA_API void    uca_transform_statistics
+                                        (gconstpointer  src,
+                                         guint          width,
+                                         guint          height,
+                                         guint          pixel_size,
+                                         guint          bits,
+                                         guint          step,
+                                         UcaFrameStatistics *statistics);
+
+G_END_DECLS
+
+#endif
@@ -1,7 +1,10 @@
 
 #include <glib.h>
+#include <time.h>
 #include "uca-camera.h"
 #include "uca-plugin-manager.h"
+#include "uca-correction-filter.h"
+#include "uca-scale-filter.h"
 
 typedef struct {
     UcaPluginManager *manager;
@@ -129,96 +132,1542 @@ test_recording_async (Fixture *fixture, gconstpointer data)
     g_assert_cmpint (count, ==, 2);
 }
 
+typedef struct {
+    gint count;
+    gint running;
+    gint max_running;
+} WorkerStats;
+
+static void
+slow_grab_func (gpointer data, gpointer user_data)
+{
+    WorkerStats *stats = user_data;
+    gint running;
+    gint max_running;
+
+    running = g_atomic_int_add (&stats->running, 1) + 1;
+
+    do {
+        max_running = g_atomic_int_get (&stats->max_running);
+    } while (running > max_running &&
+             !g_atomic_int_compare_and_exchange (&stats->max_running, max_running, running));
+
+    g_usleep (G_USEC_PER_SEC / 100);
+    g_atomic_int_add (&stats->running, -1);
+    g_atomic_int_inc (&stats->count);
+}
+
+static WorkerStats
+record_with_workers (UcaCamera *camera, gboolean preserve_order)
+{
+    GError *error = NULL;
+    WorkerStats stats = { 0, 0, 0 };
+    guint64 dropped;
+    gint count;
+
+    uca_camera_set_grab_func (camera, slow_grab_func, &stats);
+
+    g_object_set (G_OBJECT (camera),
+                  "frames-per-second", 1000.0,
+                  "transfer-asynchronously", TRUE,
+                  "async-workers", 4,
+                  "async-preserve-order", preserve_order,
+                  "ring-policy", UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_usleep (G_USEC_PER_SEC / 10);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* All callbacks have finished once recording is stopped */
+    count = g_atomic_int_get (&stats.count);
+    g_usleep (G_USEC_PER_SEC / 50);
+    g_assert_cmpint (g_atomic_int_get (&stats.count), ==, count);
+    g_assert_cmpint (count, >, 0);
+
+    g_object_get (G_OBJECT (camera), "dropped-frames", &dropped, NULL);
+    g_assert_cmpuint (dropped, ==, 0);
+
+    return stats;
+}
+
+static void
+test_recording_async_workers (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    g_assert_cmpint (record_with_workers (camera, FALSE).max_running, >, 1);
+    g_assert_cmpint (record_with_workers (camera, TRUE).max_running, ==, 1);
+}
+
+static void
+test_recording_property (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    gboolean is_recording = FALSE;
+    uca_camera_start_recording (camera, NULL);
+    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
+    g_assert (is_recording == TRUE);
+    g_assert (uca_camera_is_recording (camera));
+
+    uca_camera_stop_recording (camera, NULL);
+    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
+    g_assert (is_recording == FALSE);
+    g_assert (!uca_camera_is_recording (camera));
+}
+
+static void
+test_recording_buffered (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gsize buffer_size;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer_size = width * height * (bitdepth <= 8 ? 1 : 2);
+    buffer = g_malloc0 (buffer_size);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 5,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 10; i++) {
+        g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+        g_assert_no_error (error);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_buffered_borrow (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 5,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 10; i++) {
+        gconstpointer frame = NULL;
+        gsize size = 0;
+
+        g_assert (uca_camera_grab_borrow (camera, &frame, &size, &error));
+        g_assert_no_error (error);
+        g_assert (frame != NULL);
+        g_assert_cmpuint (size, ==, width * height * (bitdepth <= 8 ? 1 : 2));
+        uca_camera_grab_release (camera, frame);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_buffered_release_order (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint64 last_sequence = 0;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 5,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 3; i++) {
+        gconstpointer frames[3];
+        UcaFrameInfo info;
+
+        for (int j = 0; j < 3; j++) {
+            g_assert (uca_camera_grab_borrow (camera, &frames[j], NULL, &error));
+            g_assert_no_error (error);
+            g_assert (uca_camera_get_frame_info (camera, frames[j], &info));
+
+            if (i > 0 || j > 0)
+                g_assert_cmpuint (info.sequence, >, last_sequence);
+
+            last_sequence = info.sequence;
+        }
+
+        /* Blocks released early are handed to the ring buffer with the oldest */
+        uca_camera_grab_release (camera, frames[1]);
+        uca_camera_grab_release (camera, frames[2]);
+        uca_camera_grab_release (camera, frames[0]);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_buffered_consumers (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    const gchar *consumers[] = {"disk", "display"};
+    gconstpointer frame = NULL;
+    GError *error = NULL;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 5,
+                  NULL);
+
+    g_assert (uca_camera_add_consumer (camera, "disk", UCA_RING_BUFFER_CURSOR_LOSSLESS));
+    g_assert (uca_camera_add_consumer (camera, "display", UCA_RING_BUFFER_CURSOR_LATEST));
+    g_assert (!uca_camera_add_consumer (camera, "disk", UCA_RING_BUFFER_CURSOR_LATEST));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (int i = 0; i < 10; i++) {
+        g_assert (uca_camera_grab_borrow (camera, &frame, NULL, &error));
+        g_assert_no_error (error);
+        uca_camera_grab_release (camera, frame);
+
+        for (guint j = 0; j < G_N_ELEMENTS (consumers); j++) {
+            g_assert (uca_camera_grab_borrow_from (camera, consumers[j], &frame, NULL, &error));
+            g_assert_no_error (error);
+            uca_camera_grab_release_from (camera, consumers[j], frame);
+        }
+    }
+
+    uca_camera_remove_consumer (camera, "display");
+    g_assert (!uca_camera_grab_borrow_from (camera, "display", &frame, NULL, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND);
+    g_clear_error (&error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (!uca_camera_grab_borrow_from (camera, "disk", &frame, NULL, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_RECORDING);
+    g_clear_error (&error);
+
+    uca_camera_remove_consumer (camera, "disk");
+}
+
+#ifdef G_OS_UNIX
+typedef struct {
+    GMainLoop *loop;
+    gpointer buffer;
+    guint n_frames;
+} SourceData;
+
+static gboolean
+on_frame_available (UcaCamera *camera, SourceData *data)
+{
+    GError *error = NULL;
+
+    g_assert (uca_camera_grab (camera, data->buffer, &error));
+    g_assert_no_error (error);
+
+    if (++data->n_frames < 5)
+        return TRUE;
+
+    g_main_loop_quit (data->loop);
+    return FALSE;
+}
+
+static gboolean
+on_source_timeout (gpointer user_data)
+{
+    g_assert_not_reached ();
+    return FALSE;
+}
+
+static void
+test_recording_buffered_source (Fixture *fixture, gconstpointer unused)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    SourceData data;
+    GSource *source;
+    GError *error = NULL;
+    guint width, height, bitdepth, timeout;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    g_object_set (G_OBJECT (camera), "buffered", TRUE, NULL);
+    g_assert_cmpint (uca_camera_get_fd (camera), >=, 0);
+
+    data.loop = g_main_loop_new (NULL, FALSE);
+    data.buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+    data.n_frames = 0;
+
+    source = uca_camera_create_source (camera);
+    g_source_set_callback (source, (GSourceFunc) on_frame_available, &data, NULL);
+    g_source_attach (source, NULL);
+    timeout = g_timeout_add_seconds (5, on_source_timeout, NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_main_loop_run (data.loop);
+    g_assert_cmpuint (data.n_frames, ==, 5);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_source_remove (timeout);
+    g_source_unref (source);
+    g_main_loop_unref (data.loop);
+    g_free (data.buffer);
+}
+#endif
+
+typedef struct {
+    UcaCamera *camera;
+    gint grabbed;
+} TriggeredGrab;
+
+static gpointer
+grab_triggered_frame_thread (TriggeredGrab *grab)
+{
+    GError *error = NULL;
+    gpointer buffer;
+
+    buffer = g_malloc0 (uca_camera_get_frame_size (grab->camera));
+    g_assert (uca_camera_grab (grab->camera, buffer, &error));
+    g_assert_no_error (error);
+    g_atomic_int_set (&grab->grabbed, TRUE);
+
+    g_free (buffer);
+    return NULL;
+}
+
+static gconstpointer
+borrow_first_frame (UcaCamera *camera)
+{
+    GError *error = NULL;
+    gconstpointer frame;
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_camera_grab_borrow (camera, &frame, NULL, &error));
+    g_assert_no_error (error);
+    uca_camera_grab_release (camera, frame);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    return frame;
+}
+
+static void
+test_recording_buffered_reuse (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    gconstpointer first;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    /* The ring buffer is kept as long as the geometry does not change */
+    first = borrow_first_frame (camera);
+    g_assert (borrow_first_frame (camera) == first);
+}
+
+static void
+test_recording_buffered_idle (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    TriggeredGrab grab;
+    GError *error = NULL;
+    GThread *consumer;
+    guint peak_fill;
+
+    grab.camera = camera;
+    grab.grabbed = FALSE;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  "fill-data", FALSE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /*
+     * Without a trigger the producer waits in the camera and the frame counter
+     * does not advance, so the consumer has nothing to return and must wait
+     * for the producer to signal a frame.
+     */
+    consumer = g_thread_new (NULL, (GThreadFunc) grab_triggered_frame_thread, &grab);
+
+    g_object_get (G_OBJECT (camera), "buffer-peak-fill", &peak_fill, NULL);
+    g_assert_cmpuint (peak_fill, ==, 0);
+    g_assert (!g_atomic_int_get (&grab.grabbed));
+
+    /* A single frame wakes it up */
+    uca_camera_trigger (camera, &error);
+    g_assert_no_error (error);
+    g_thread_join (consumer);
+    g_assert (grab.grabbed);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+grab_frame_infos (UcaCamera *camera)
+{
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    gchar *buffer;
+    UcaFrameInfo info;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint64 i = 0; i < 5; i++) {
+        g_assert (uca_camera_grab_full (camera, buffer, &info, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (info.sequence, ==, i);
+        g_assert (info.has_hardware_counter);
+        g_assert_cmpint (info.capture_time, >, 0);
+        g_assert_cmpint (info.dequeue_time, >=, info.capture_time);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_frame_info (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    g_object_set (G_OBJECT (camera),
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    grab_frame_infos (camera);
+
+    /* A large buffer keeps all frames, so the sequence has no gaps */
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 100,
+                  NULL);
+
+    grab_frame_infos (camera);
+}
+
+static void
+grab_many_frames (UcaCamera *camera)
+{
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    guint n_got = 0;
+    gchar *buffer;
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (8 * width * height * (bitdepth <= 8 ? 1 : 2));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (uca_camera_grab_many (camera, buffer, 8, &n_got, -1.0, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (n_got, ==, 8);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_grab_many (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    g_object_set (G_OBJECT (camera),
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    grab_many_frames (camera);
+
+    g_object_set (G_OBJECT (camera), "buffered", TRUE, NULL);
+    grab_many_frames (camera);
+}
+
+static void
+test_recording_grab_many_timeout (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint n_got = 1;
+    gpointer buffer;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "exposure-time", 0.5,
+                  "fill-data", FALSE,
+                  NULL);
+
+    buffer = g_malloc (4 * uca_camera_get_frame_size (camera));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* The buffer is never written because no frame arrives in time */
+    g_assert (!uca_camera_grab_many (camera, buffer, 4, &n_got, 0.05, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_TIMEOUT);
+    g_assert_cmpuint (n_got, ==, 0);
+    g_clear_error (&error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+test_recording_grab_timeout (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    gpointer buffer;
+
+    g_object_set (G_OBJECT (camera),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    buffer = g_malloc (uca_camera_get_frame_size (camera));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_assert (!uca_camera_grab_timeout (camera, buffer, 0.05, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_TIMEOUT);
+    g_clear_error (&error);
+
+    uca_camera_trigger (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_timeout (camera, buffer, 1.0, &error));
+    g_assert_no_error (error);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (buffer);
+}
+
+static void
+on_grab_finished (UcaCamera *camera, GAsyncResult *result, GMainLoop *loop)
+{
+    GError *error = NULL;
+
+    g_assert (!uca_camera_grab_finish (camera, result, &error));
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_error_free (error);
+    g_main_loop_quit (loop);
+}
+
+static gboolean
+cancel_grab (GCancellable *cancellable)
+{
+    g_cancellable_cancel (cancellable);
+    return FALSE;
+}
+
+static void
+test_recording_grab_async (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GCancellable *cancellable;
+    GMainLoop *loop;
+    GError *error = NULL;
+    gpointer buffer;
+
+    /* Without a trigger, only cancelling ends the grab */
+    g_object_set (G_OBJECT (camera),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  "fill-data", FALSE,
+                  NULL);
+
+    buffer = g_malloc (uca_camera_get_frame_size (camera));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    loop = g_main_loop_new (NULL, FALSE);
+    cancellable = g_cancellable_new ();
+    uca_camera_grab_async (camera, buffer, cancellable, (GAsyncReadyCallback) on_grab_finished, loop);
+    g_timeout_add (50, (GSourceFunc) cancel_grab, cancellable);
+    g_main_loop_run (loop);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Stopping also ends a buffered grab that waits for a trigger */
+    g_object_set (G_OBJECT (camera), "buffered", TRUE, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_unref (cancellable);
+    g_main_loop_unref (loop);
+    g_free (buffer);
+}
+
+static guint64
+record_with_policy (UcaCamera *camera, UcaCameraRingPolicy policy)
+{
+    GError *error = NULL;
+    guint64 dropped;
+    gconstpointer frame;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "ring-policy", policy,
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Let the acquisition thread run into a full ring buffer */
+    g_usleep (G_USEC_PER_SEC / 10);
+
+    g_assert (uca_camera_grab_borrow (camera, &frame, NULL, &error));
+    g_assert_no_error (error);
+    uca_camera_grab_release (camera, frame);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (camera), "dropped-frames", &dropped, NULL);
+    return dropped;
+}
+
+static void
+test_recording_buffered_policy (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+
+    g_assert_cmpuint (record_with_policy (camera, UCA_CAMERA_RING_POLICY_DROP_OLDEST), >, 0);
+    g_assert_cmpuint (record_with_policy (camera, UCA_CAMERA_RING_POLICY_DROP_NEWEST), >, 0);
+    g_assert_cmpuint (record_with_policy (camera, UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER), ==, 0);
+}
+
+static void
+test_recording_buffered_elastic (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    guint capacity, peak_fill;
+    gconstpointer frames[9];
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "max-buffer-memory", (guint64) 8 * width * height * (bitdepth <= 8 ? 1 : 2),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /*
+     * Borrowed frames keep their blocks, so the ring buffer fills by one with
+     * every triggered frame. It grows by two blocks whenever it is three
+     * quarters full before the next frame, which stops at the budget of eight.
+     */
+    for (guint i = 0; i < 8; i++) {
+        uca_camera_trigger (camera, &error);
+        g_assert_no_error (error);
+        g_assert (uca_camera_grab_borrow (camera, &frames[i], NULL, &error));
+        g_assert_no_error (error);
+    }
+
+    /*
+     * The peak is recorded after a frame is published, but certainly before
+     * the next frame is written into the block we hand back.
+     */
+    uca_camera_grab_release (camera, frames[0]);
+    uca_camera_trigger (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_borrow (camera, &frames[8], NULL, &error));
+    g_assert_no_error (error);
+
+    g_object_get (G_OBJECT (camera),
+                  "buffer-capacity", &capacity,
+                  "buffer-peak-fill", &peak_fill,
+                  NULL);
+
+    g_assert_cmpuint (capacity, ==, 8);
+    g_assert_cmpuint (peak_fill, ==, 8);
+
+    for (guint i = 1; i < G_N_ELEMENTS (frames); i++)
+        uca_camera_grab_release (camera, frames[i]);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+}
+
+static void
+test_recording_buffered_spill (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint width, height, bitdepth;
+    guint64 dropped;
+    gchar *buffer;
+    UcaFrameInfo info;
+
+    g_object_set (G_OBJECT (camera),
+                  "buffered", TRUE,
+                  "num-buffers", 2,
+                  "ring-policy", UCA_CAMERA_RING_POLICY_SPILL,
+                  "exposure-time", 0.01,
+                  "fill-data", FALSE,
+                  NULL);
+
+    g_object_get (G_OBJECT (camera),
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    buffer = g_malloc0 (width * height * (bitdepth <= 8 ? 1 : 2));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Fall behind so that most frames end up on disk */
+    g_usleep (G_USEC_PER_SEC / 10);
+
+    for (guint64 i = 0; i < 20; i++) {
+        g_assert (uca_camera_grab_full (camera, buffer, &info, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (info.sequence, ==, i);
+    }
+
+    /* Frames still on disk when recording stops count as dropped, so check before */
+    g_object_get (G_OBJECT (camera), "dropped-frames", &dropped, NULL);
+    g_assert_cmpuint (dropped, ==, 0);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+    g_free (buffer);
+}
+
+static void
+test_recording_multiple_cameras (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    TriggeredGrab grab;
+    GThread *thread;
+    GError *error = NULL;
+    gpointer buffer;
+
+    grab.camera = uca_plugin_manager_get_camera (fixture->manager, "mock", &error, NULL);
+    grab.grabbed = FALSE;
+    g_assert_no_error (error);
+
+    g_object_set (G_OBJECT (grab.camera),
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  "fill-data", FALSE,
+                  NULL);
+
+    g_object_set (G_OBJECT (camera),
+                  "exposure-time", 0.001,
+                  "fill-data", FALSE,
+                  NULL);
+
+    uca_camera_start_recording (grab.camera, &error);
+    g_assert_no_error (error);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* The first camera blocks in its grab until it is triggered */
+    thread = g_thread_new (NULL, (GThreadFunc) grab_triggered_frame_thread, &grab);
+    buffer = g_malloc0 (uca_camera_get_frame_size (camera));
+
+    /* If cameras serialized on each other, these would time out */
+    for (guint i = 0; i < 10; i++) {
+        g_assert (uca_camera_grab_timeout (camera, buffer, 10.0, &error));
+        g_assert_no_error (error);
+    }
+
+    g_assert (!g_atomic_int_get (&grab.grabbed));
+
+    uca_camera_trigger (grab.camera, &error);
+    g_assert_no_error (error);
+    g_thread_join (thread);
+    g_assert (g_atomic_int_get (&grab.grabbed));
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+    uca_camera_stop_recording (grab.camera, &error);
+    g_assert_no_error (error);
+
+    g_object_unref (grab.camera);
+    g_free (buffer);
+}
+
+static void
+test_base_properties (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    guint n_properties = 0;
+    GParamSpec **properties = g_object_class_list_properties (G_OBJECT_GET_CLASS (camera), &n_properties);
+    GValue val = {0};
+
+    for (guint i = 0; i < n_properties; i++) {
+        g_value_init (&val, properties[i]->value_type);
+        g_object_get_property (G_OBJECT (camera), properties[i]->name, &val);
+        g_value_unset (&val);
+    }
+
+    g_free (properties);
+}
+
+static void
+test_fps_property (Fixture *fixture, gconstpointer data)
+{
+    gdouble frames_per_second;
+    gdouble exposure_time = 0.5;
+
+    g_object_set (G_OBJECT (fixture->camera),
+                  "exposure-time", exposure_time,
+                  NULL);
+    g_object_get (G_OBJECT (fixture->camera),
+                  "frames-per-second", &frames_per_second,
+                  NULL);
+
+    /*
+     * The mock camera does not override the "frames-per-second" property, so we
+     * check the implementation from the base camera.
+     */
+    g_assert_cmpfloat (frames_per_second, ==, 1.0 / exposure_time);
+}
+
 static void
-test_recording_property (Fixture *fixture, gconstpointer data)
+test_accessors (Fixture *fixture, gconstpointer data)
 {
     UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    guint roi_width, roi_height, bitdepth;
+    guint width, height;
 
-    gboolean is_recording = FALSE;
+    g_object_set (camera,
+                  "roi-width", 128,
+                  "trigger-source", UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE,
+                  NULL);
+
+    g_object_get (camera,
+                  "roi-width", &roi_width,
+                  "roi-height", &roi_height,
+                  "sensor-bitdepth", &bitdepth,
+                  NULL);
+
+    uca_camera_get_roi (camera, NULL, NULL, &width, &height);
+    g_assert_cmpuint (width, ==, 128);
+    g_assert_cmpuint (width, ==, roi_width);
+    g_assert_cmpuint (height, ==, roi_height);
+    g_assert_cmpuint (uca_camera_get_bitdepth (camera), ==, bitdepth);
+    g_assert (uca_camera_get_trigger_source (camera) == UCA_CAMERA_TRIGGER_SOURCE_SOFTWARE);
+
+    g_assert (!uca_camera_is_recording (camera));
     uca_camera_start_recording (camera, NULL);
-    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
-    g_assert (is_recording == TRUE);
     g_assert (uca_camera_is_recording (camera));
-
     uca_camera_stop_recording (camera, NULL);
-    g_object_get (G_OBJECT (camera), "is-recording", &is_recording, NULL);
-    g_assert (is_recording == FALSE);
     g_assert (!uca_camera_is_recording (camera));
 }
 
 static void
-test_recording_buffered (Fixture *fixture, gconstpointer data)
+test_recording_buffered_binning (Fixture *fixture, gconstpointer data)
 {
     UcaCamera *camera = UCA_CAMERA (fixture->camera);
     GError *error = NULL;
-    guint width, height, bitdepth;
-    gsize buffer_size;
-    gchar *buffer;
-
-    g_object_get (G_OBJECT (camera),
-                  "roi-width", &width,
-                  "roi-height", &height,
-                  "sensor-bitdepth", &bitdepth,
+    gconstpointer frame = NULL;
+    UcaCameraPixelFormat format;
+    guint width, height;
+    gsize size = 0;
+
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
+                  "software-roi-x0", 2,
+                  "software-roi-width", 60,
+                  "software-horizontal-binning", 4,
+                  "software-vertical-binning", 2,
+                  "software-binning-mode", UCA_CAMERA_BINNING_MODE_WIDEN,
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
                   NULL);
 
-    buffer_size = width * height * (bitdepth <= 8 ? 1 : 2);
-    buffer = g_malloc0 (buffer_size);
+    /* 8-bit pixels are widened to 16 bit */
+    uca_camera_get_frame_geometry (camera, &width, &height, &format);
+    g_assert_cmpuint (width, ==, 15);
+    g_assert_cmpuint (height, ==, 16);
+    g_assert (format == UCA_CAMERA_PIXEL_FORMAT_MONO16);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, 15 * 16 * 2);
 
-    g_object_set (G_OBJECT (camera),
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_borrow (camera, &frame, &size, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (size, ==, 15 * 16 * 2);
+    uca_camera_grab_release (camera, frame);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* The region must fit into the frame */
+    g_object_set (camera, "software-roi-width", 64, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE);
+    g_assert (!uca_camera_is_recording (camera));
+    g_clear_error (&error);
+}
+
+/*
+ * Filter that fills frames with a constant after a random delay, so that
+ * frames finish out of order.
+ */
+typedef struct {
+    GObject parent;
+    guint8 value;
+} TestFilter;
+
+typedef struct {
+    GObjectClass parent;
+} TestFilterClass;
+
+static void test_filter_iface_init (UcaFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestFilter, test_filter, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UCA_TYPE_FILTER, test_filter_iface_init))
+
+static gboolean
+test_filter_process (UcaFilter *filter, gpointer data, guint width, guint height,
+                     guint pixel_size, GError **error)
+{
+    g_usleep (g_random_int_range (0, 2000));
+    memset (data, ((TestFilter *) filter)->value, (gsize) width * height * pixel_size);
+    return TRUE;
+}
+
+static void
+test_filter_iface_init (UcaFilterInterface *iface)
+{
+    iface->process = test_filter_process;
+}
+
+static void
+test_filter_class_init (TestFilterClass *klass)
+{
+}
+
+static void
+test_filter_init (TestFilter *filter)
+{
+    filter->value = 0x42;
+}
+
+static void
+test_recording_filters (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    UcaFrameInfo info;
+    UcaFilter *fill;
+    UcaFilter *scale;
+    guint8 *frame;
+
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
                   "buffered", TRUE,
                   "num-buffers", 5,
+                  "ring-policy", UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER,
+                  "filter-workers", 4,
+                  "exposure-time", 0.001,
                   NULL);
 
+    fill = g_object_new (test_filter_get_type (), NULL);
+    scale = uca_scale_filter_new (2.0, 0.5);
+    uca_camera_add_filter (camera, fill);
+    uca_camera_add_filter (camera, scale);
+    frame = g_malloc (uca_camera_get_frame_size (camera));
+
+    /* Frames are filtered in parallel but delivered in order */
     uca_camera_start_recording (camera, &error);
     g_assert_no_error (error);
 
-    for (int i = 0; i < 10; i++) {
-        g_assert (uca_camera_grab (camera, (gpointer) buffer, &error));
+    for (guint64 i = 0; i < 50; i++) {
+        g_assert (uca_camera_grab_full (camera, frame, &info, &error));
         g_assert_no_error (error);
+        g_assert_cmpuint (info.sequence, ==, i);
+        g_assert_cmpuint (frame[0], ==, 0x20);
+        g_assert_cmpuint (frame[64 * 32 - 1], ==, 0x20);
     }
 
     uca_camera_stop_recording (camera, &error);
     g_assert_no_error (error);
 
-    g_free (buffer);
+    /* Unbuffered grabs run the filters themselves */
+    uca_camera_clear_filters (camera);
+    uca_camera_add_filter (camera, fill);
+    g_object_set (camera, "buffered", FALSE, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab (camera, frame, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (frame[0], ==, 0x42);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (frame);
+    g_object_unref (fill);
+    g_object_unref (scale);
 }
 
+static void
+test_correction_filter (Fixture *fixture, gconstpointer data)
+{
+    const guint width = 16;
+    const guint height = 8;
+    const gsize n_pixels = width * height;
+    UcaCorrectionFilter *correction;
+    GError *error = NULL;
+    gfloat *dark;
+    gfloat *flat;
+    gfloat *result;
+    guint8 *defects;
+    guint16 *frame;
+
+    dark = g_new (gfloat, n_pixels);
+    flat = g_new (gfloat, n_pixels);
+    result = g_new (gfloat, n_pixels);
+    defects = g_new0 (guint8, n_pixels);
+    frame = g_new (guint16, n_pixels);
+
+    /* Every raw pixel is halfway between dark and flat */
+    for (gsize i = 0; i < n_pixels; i++) {
+        dark[i] = 100.0f;
+        flat[i] = i % 2 ? 2100.0f : 1100.0f;
+        frame[i] = i % 2 ? 1100 : 600;
+    }
+
+    /*
+     * A known defect, a hot pixel, a dead pixel and a nearly dead pixel whose
+     * gain would leave too few fractional bits for all others
+     */
+    defects[3 * width + 3] = 1;
+    dark[5] = 1000.0f;
+    flat[2 * width + 7] = 50.0f;
+    flat[6 * width + 10] = 101.0f;
+    frame[3 * width + 3] = 0xFFFF;
+    frame[5] = 0;
+    frame[2 * width + 7] = 0;
+    frame[6 * width + 10] = 101;
+
+    correction = UCA_CORRECTION_FILTER (uca_correction_filter_new ());
+    g_object_set (correction, "hot-pixel-threshold", 500, NULL);
+
+    uca_correction_filter_set_dark (correction, dark, 8, 8);
+    g_assert (!uca_filter_setup (UCA_FILTER (correction), width, height, 2, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_REFERENCE);
+    g_clear_error (&error);
+
+    uca_correction_filter_set_dark (correction, dark, width, height);
+    uca_correction_filter_set_flat (correction, flat, width, height);
+    uca_correction_filter_set_defects (correction, defects, width, height);
+    g_assert (uca_filter_setup (UCA_FILTER (correction), width, height, 2, &error));
+    g_assert_no_error (error);
+
+    g_assert (uca_correction_filter_correct_float (correction, frame, result, width, height, 2, &error));
+    g_assert_no_error (error);
+    g_assert (uca_filter_process (UCA_FILTER (correction), frame, width, height, 2, &error));
+    g_assert_no_error (error);
+
+    /*
+     * The automatic scale is the mean of flat minus dark over the 63 intact
+     * even and 61 intact odd pixels, which is 1491.94.
+     */
+    for (gsize i = 0; i < n_pixels; i++) {
+        g_assert_cmpuint (frame[i], >=, 745);
+        g_assert_cmpuint (frame[i], <=, 747);
+        g_assert_cmpfloat (result[i], >, 745.9f);
+        g_assert_cmpfloat (result[i], <, 746.1f);
+    }
+
+    /* Frames of another geometry are refused */
+    g_assert (!uca_filter_process (UCA_FILTER (correction), frame, width, height, 1, &error));
+    g_assert_error (error, UCA_FILTER_ERROR, UCA_FILTER_ERROR_NOT_SET_UP);
+    g_clear_error (&error);
+
+    g_object_unref (correction);
+    g_free (dark);
+    g_free (flat);
+    g_free (result);
+    g_free (defects);
+    g_free (frame);
+}
 
 static void
-test_base_properties (Fixture *fixture, gconstpointer data)
+test_recording_correction (Fixture *fixture, gconstpointer data)
 {
     UcaCamera *camera = UCA_CAMERA (fixture->camera);
-    guint n_properties = 0;
-    GParamSpec **properties = g_object_class_list_properties (G_OBJECT_GET_CLASS (camera), &n_properties);
-    GValue val = {0};
+    UcaCameraPixelFormat format;
+    UcaCorrectionFilter *correction;
+    UcaFilter *fill;
+    GError *error = NULL;
+    guint width, height;
+    gsize n_pixels;
+    gfloat *average;
+    guint8 *frame;
+
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
+                  "exposure-time", 0.001,
+                  NULL);
 
-    for (guint i = 0; i < n_properties; i++) {
-        g_value_init (&val, properties[i]->value_type);
-        g_object_get_property (G_OBJECT (camera), properties[i]->name, &val);
-        g_value_unset (&val);
+    uca_camera_get_frame_geometry (camera, &width, &height, &format);
+    n_pixels = (gsize) width * height;
+    average = g_new (gfloat, n_pixels);
+    frame = g_malloc (uca_camera_get_frame_size (camera));
+
+    /* Deterministic frames for the reference */
+    fill = g_object_new (test_filter_get_type (), NULL);
+    uca_camera_add_filter (camera, fill);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_average (camera, average, 4, &error));
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (gsize i = 0; i < n_pixels; i++)
+        g_assert_cmpfloat (average[i], ==, format == UCA_CAMERA_PIXEL_FORMAT_MONO8 ? 0x42 : 0x4242);
+
+    /* Subtracting a slightly lower dark leaves 0x10 */
+    for (gsize i = 0; i < n_pixels; i++)
+        average[i] -= 0x10;
+
+    correction = UCA_CORRECTION_FILTER (uca_correction_filter_new ());
+    uca_correction_filter_set_dark (correction, average, width, height);
+    uca_camera_add_filter (camera, UCA_FILTER (correction));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab (camera, frame, &error));
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    if (format == UCA_CAMERA_PIXEL_FORMAT_MONO8)
+        g_assert_cmpuint (frame[0], ==, 0x10);
+    else
+        g_assert_cmpuint (((guint16 *) frame)[n_pixels - 1], ==, 0x10);
+
+    g_object_unref (correction);
+    g_object_unref (fill);
+    g_free (average);
+    g_free (frame);
+}
+
+/*
+ * Mean of the region that the mock camera fills with noise around half of the
+ * 8-bit range.
+ */
+static gdouble
+noise_mean (gconstpointer frame, guint width, guint height, guint pixel_size)
+{
+    gdouble sum = 0.0;
+    guint n = 0;
+
+    for (guint y = height / 3; y < height * 2 / 3; y++) {
+        for (guint x = width / 3; x < width * 2 / 3; x++) {
+            gsize i = (gsize) y * width + x;
+
+            sum += pixel_size == 1 ? ((const guint8 *) frame)[i] : ((const guint32 *) frame)[i];
+            n++;
+        }
     }
 
-    g_free (properties);
+    return sum / n;
 }
 
 static void
-test_fps_property (Fixture *fixture, gconstpointer data)
+test_recording_accumulate (Fixture *fixture, gconstpointer data)
 {
-    gdouble frames_per_second;
-    gdouble exposure_time = 0.5;
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    UcaCameraPixelFormat format;
+    GError *error = NULL;
+    UcaFrameInfo info;
+    guint64 first_counter = 0;
+    guint8 *frame;
 
-    g_object_set (G_OBJECT (fixture->camera),
-                  "exposure-time", exposure_time,
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
+                  "buffered", TRUE,
+                  "num-buffers", 4,
+                  "ring-policy", UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER,
+                  "accumulate-frames", 4,
+                  "accumulate-mode", UCA_CAMERA_ACCUMULATE_MODE_SUM,
+                  "exposure-time", 0.001,
                   NULL);
-    g_object_get (G_OBJECT (fixture->camera),
-                  "frames-per-second", &frames_per_second,
+
+    uca_camera_get_frame_geometry (camera, NULL, NULL, &format);
+    g_assert (format == UCA_CAMERA_PIXEL_FORMAT_MONO32);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, 64 * 32 * 4);
+    frame = g_malloc (uca_camera_get_frame_size (camera));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint64 i = 0; i < 5; i++) {
+        gdouble mean;
+
+        g_assert (uca_camera_grab_full (camera, frame, &info, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (info.sequence, ==, i);
+        g_assert_cmpuint (info.n_accumulated, ==, 4);
+
+        if (i == 0)
+            first_counter = info.hardware_counter;
+
+        /* Every stored frame starts four camera frames later */
+        g_assert_cmpuint (info.hardware_counter - first_counter, ==, 4 * i);
+
+        mean = noise_mean (frame, 64, 32, 4) / 4;
+        g_assert_cmpfloat (mean, >, 120.0);
+        g_assert_cmpfloat (mean, <, 136.0);
+    }
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Means keep the pixel format */
+    g_object_set (camera, "buffered", FALSE, "accumulate-mode", UCA_CAMERA_ACCUMULATE_MODE_MEAN, NULL);
+    uca_camera_get_frame_geometry (camera, NULL, NULL, &format);
+    g_assert (format == UCA_CAMERA_PIXEL_FORMAT_MONO8);
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_full (camera, frame, &info, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (info.n_accumulated, ==, 4);
+    g_assert_cmpfloat (noise_mean (frame, 64, 32, 1), >, 120.0);
+    g_assert_cmpfloat (noise_mean (frame, 64, 32, 1), <, 136.0);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (frame);
+}
+
+static void
+check_statistics (const UcaFrameInfo *info, const guint8 *frame, guint width, guint height, guint step)
+{
+    const UcaFrameStatistics *statistics = &info->statistics;
+    guint64 sum = 0, n_pixels = 0, n_counted = 0;
+    guint min = G_MAXUINT, max = 0;
+
+    g_assert (info->has_statistics);
+
+    for (guint y = 0; y < height; y += step) {
+        for (guint x = 0; x < width; x += step) {
+            guint value = frame[y * width + x];
+
+            min = MIN (min, value);
+            max = MAX (max, value);
+            sum += value;
+            n_pixels++;
+        }
+    }
+
+    for (guint i = 0; i < UCA_FRAME_STATISTICS_N_BINS; i++)
+        n_counted += statistics->histogram[i];
+
+    g_assert_cmpuint (statistics->n_pixels, ==, n_pixels);
+    g_assert_cmpuint (statistics->min, ==, min);
+    g_assert_cmpuint (statistics->max, ==, max);
+    g_assert_cmpuint (statistics->sum, ==, sum);
+    g_assert_cmpuint (statistics->histogram_shift, ==, 0);
+    g_assert_cmpuint (n_counted, ==, n_pixels);
+    g_assert_cmpuint (statistics->histogram[255], ==, statistics->n_saturated);
+}
+
+static void
+test_recording_statistics (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    UcaFrameInfo info;
+    gconstpointer borrowed;
+    guint8 *frame;
+
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
+                  "buffered", TRUE,
+                  "num-buffers", 4,
+                  "ring-policy", UCA_CAMERA_RING_POLICY_BLOCK_PRODUCER,
+                  "statistics", TRUE,
+                  "exposure-time", 0.001,
                   NULL);
 
-    /*
-     * The mock camera does not override the "frames-per-second" property, so we
-     * check the implementation from the base camera.
-     */
-    g_assert_cmpfloat (frames_per_second, ==, 1.0 / exposure_time);
+    frame = g_malloc (uca_camera_get_frame_size (camera));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+
+    for (guint i = 0; i < 3; i++) {
+        g_assert (uca_camera_grab_full (camera, frame, &info, &error));
+        g_assert_no_error (error);
+        check_statistics (&info, frame, 64, 32, 1);
+    }
+
+    /* Borrowed frames carry their statistics as well */
+    g_assert (uca_camera_grab_borrow (camera, &borrowed, NULL, &error));
+    g_assert_no_error (error);
+    g_assert (uca_camera_get_frame_info (camera, borrowed, &info));
+    check_statistics (&info, borrowed, 64, 32, 1);
+    uca_camera_grab_release (camera, borrowed);
+
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_object_set (camera, "buffered", FALSE, "statistics-step", 3, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_full (camera, frame, &info, &error));
+    g_assert_no_error (error);
+    check_statistics (&info, frame, 64, 32, 3);
+    g_assert_cmpuint (info.statistics.n_pixels, ==, 22 * 11);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    /* Without statistics, nothing is attached */
+    g_object_set (camera, "statistics", FALSE, NULL);
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    g_assert (uca_camera_grab_full (camera, frame, &info, &error));
+    g_assert_no_error (error);
+    g_assert (!info.has_statistics);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    g_free (frame);
+}
+
+static void
+test_recording_pixel_format (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GError *error = NULL;
+    guint16 *unpacked;
+    gpointer frame;
+    guint bitdepth;
+
+    g_object_set (camera,
+                  "roi-width", 64,
+                  "roi-height", 32,
+                  "pixel-format", UCA_CAMERA_PIXEL_FORMAT_MONO12P,
+                  "buffered", TRUE,
+                  "exposure-time", 0.001,
+                  NULL);
+
+    g_object_get (camera, "sensor-bitdepth", &bitdepth, NULL);
+    g_assert_cmpuint (bitdepth, ==, 12);
+    g_assert (uca_camera_get_pixel_format (camera) == UCA_CAMERA_PIXEL_FORMAT_MONO12P);
+    g_assert_cmpuint (uca_camera_get_bitdepth (camera), ==, 12);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, 64 * 32 * 3 / 2);
+
+    /* Frames must be delivered packed */
+    frame = g_malloc0 (uca_camera_get_frame_size (camera));
+    unpacked = g_malloc0 (64 * 32 * sizeof (guint16));
+
+    uca_camera_start_recording (camera, &error);
+    g_assert_no_error (error);
+    uca_camera_grab (camera, frame, &error);
+    g_assert_no_error (error);
+    uca_camera_stop_recording (camera, &error);
+    g_assert_no_error (error);
+
+    uca_transform_unpack (frame, unpacked, 64 * 32, 12);
+
+    for (guint i = 0; i < 64 * 32; i++)
+        g_assert_cmpuint (unpacked[i], <=, 0xFFF);
+
+    g_object_set (camera, "pixel-format", UCA_CAMERA_PIXEL_FORMAT_MONO10P, NULL);
+    g_assert_cmpuint (uca_camera_get_frame_size (camera), ==, 64 * 32 * 5 / 4);
+
+    g_free (frame);
+    g_free (unpacked);
+}
+
+static void
+free_value (GValue *value)
+{
+    g_value_unset (value);
+    g_free (value);
+}
+
+static void
+insert_uint (GHashTable *properties, const gchar *name, guint number)
+{
+    GValue *value;
+
+    value = g_new0 (GValue, 1);
+    g_value_init (value, G_TYPE_UINT);
+    g_value_set_uint (value, number);
+    g_hash_table_insert (properties, (gpointer) name, value);
+}
+
+static void
+insert_double (GHashTable *properties, const gchar *name, gdouble number)
+{
+    GValue *value;
+
+    value = g_new0 (GValue, 1);
+    g_value_init (value, G_TYPE_DOUBLE);
+    g_value_set_double (value, number);
+    g_hash_table_insert (properties, (gpointer) name, value);
+}
+
+static void
+on_property_count (gpointer instance, GParamSpec *pspec, gpointer user_data)
+{
+    (*(guint *) user_data)++;
+}
+
+static void
+test_batch_properties (Fixture *fixture, gconstpointer data)
+{
+    UcaCamera *camera = UCA_CAMERA (fixture->camera);
+    GHashTable *properties;
+    GError *error = NULL;
+    guint x, y, width, height;
+    gdouble exposure_time;
+    guint n_notified = 0;
+
+    properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) free_value);
+    insert_double (properties, "exposure-time", 0.02);
+    insert_uint (properties, "roi-x0", 64);
+    insert_uint (properties, "roi-y0", 32);
+    insert_uint (properties, "roi-width", 128);
+    insert_uint (properties, "roi-height", 256);
+    insert_uint (properties, "num-buffers", 8);
+
+    g_signal_connect (camera, "notify::roi-width", (GCallback) on_property_count, &n_notified);
+
+    g_assert (uca_camera_apply_properties (camera, properties, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (n_notified, ==, 1);
+
+    g_object_get (camera,
+                  "exposure-time", &exposure_time,
+                  "roi-x0", &x,
+                  "roi-y0", &y,
+                  "roi-width", &width,
+                  "roi-height", &height,
+                  NULL);
+
+    g_assert_cmpfloat (exposure_time, ==, 0.02);
+    g_assert_cmpuint (x, ==, 64);
+    g_assert_cmpuint (y, ==, 32);
+    g_assert_cmpuint (width, ==, 128);
+    g_assert_cmpuint (height, ==, 256);
+
+    /* An invalid configuration leaves the previous one in place */
+    insert_double (properties, "exposure-time", 0.5);
+    insert_uint (properties, "roi-x0", 4000);
+    g_assert (!uca_camera_apply_properties (camera, properties, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_INVALID_VALUE);
+    g_clear_error (&error);
+
+    g_object_get (camera, "exposure-time", &exposure_time, "roi-x0", &x, NULL);
+    g_assert_cmpfloat (exposure_time, ==, 0.02);
+    g_assert_cmpuint (x, ==, 64);
+    g_assert_cmpuint (n_notified, ==, 1);
+
+    insert_uint (properties, "does-not-exist", 1);
+    g_assert (!uca_camera_apply_properties (camera, properties, &error));
+    g_assert_error (error, UCA_CAMERA_ERROR, UCA_CAMERA_ERROR_NOT_FOUND);
+    g_clear_error (&error);
+
+    g_hash_table_destroy (properties);
 }
 
 static void
@@ -338,10 +1787,37 @@ int main (int argc, char *argv[])
         {"/recording", test_recording},
         {"/recording/signal", test_recording_signal},
         {"/recording/asynchronous", test_recording_async},
+        {"/recording/asynchronous/workers", test_recording_async_workers},
         {"/recording/buffered", test_recording_buffered},
+        {"/recording/buffered/borrow", test_recording_buffered_borrow},
+        {"/recording/buffered/release-order", test_recording_buffered_release_order},
+        {"/recording/buffered/consumers", test_recording_buffered_consumers},
+#ifdef G_OS_UNIX
+        {"/recording/buffered/source", test_recording_buffered_source},
+#endif
+        {"/recording/buffered/idle", test_recording_buffered_idle},
+        {"/recording/buffered/reuse", test_recording_buffered_reuse},
+        {"/recording/buffered/policy", test_recording_buffered_policy},
+        {"/recording/buffered/elastic", test_recording_buffered_elastic},
+        {"/recording/buffered/spill", test_recording_buffered_spill},
+        {"/recording/buffered/binning", test_recording_buffered_binning},
+        {"/recording/buffered/filters", test_recording_filters},
+        {"/recording/correction", test_recording_correction},
+        {"/recording/buffered/accumulate", test_recording_accumulate},
+        {"/recording/buffered/statistics", test_recording_statistics},
+        {"/filters/correction", test_correction_filter},
+        {"/recording/frame-info", test_recording_frame_info},
+        {"/recording/grab-many", test_recording_grab_many},
+        {"/recording/grab-many/timeout", test_recording_grab_many_timeout},
+        {"/recording/grab-timeout", test_recording_grab_timeout},
+        {"/recording/grab-async", test_recording_grab_async},
+        {"/recording/multiple-cameras", test_recording_multiple_cameras},
+        {"/recording/pixel-format", test_recording_pixel_format},
         {"/properties/base", test_base_properties},
         {"/properties/recording", test_recording_property},
         {"/properties/frames-per-second", test_fps_property},
+        {"/properties/accessors", test_accessors},
+        {"/properties/batch", test_batch_properties},
         {"/properties/units", test_property_units},
         {"/properties/units/overwrite", test_overwriting_units},
         {"/properties/can-be-written", test_can_be_written},
@@ -1,4 +1,6 @@
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
 #include "uca-ring-buffer.h"
 
 
@@ -86,6 +88,398 @@ test_overwrite (void)
     g_assert (data[0] == 0xDEADBEEF);
 }
 
+static void
+test_borrow (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *borrowed;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xBADF00D;
+    uca_ring_buffer_write_advance (buffer);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 0xDEADBEEF;
+    uca_ring_buffer_write_advance (buffer);
+
+    borrowed = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (borrowed[0] == 0xBADF00D);
+
+    /* The next write location is the borrowed block */
+    g_assert (!uca_ring_buffer_is_writable (buffer));
+
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+    g_assert (uca_ring_buffer_is_writable (buffer));
+
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert (data[0] == 0xDEADBEEF);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_write_ahead (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 3);
+
+    /* Fill the blocks out of order and publish them in order */
+    data = uca_ring_buffer_get_write_pointer_ahead (buffer, 2);
+    data[0] = 3;
+    data = uca_ring_buffer_get_write_pointer_ahead (buffer, 0);
+    data[0] = 1;
+    data = uca_ring_buffer_get_write_pointer_ahead (buffer, 1);
+    data[0] = 2;
+
+    /* Unread blocks are never dropped */
+    g_assert (uca_ring_buffer_get_write_pointer_ahead (buffer, 3) == NULL);
+
+    for (guint i = 0; i < 3; i++)
+        uca_ring_buffer_write_advance (buffer);
+
+    g_assert (uca_ring_buffer_get_write_pointer_ahead (buffer, 0) == NULL);
+
+    for (guint i = 1; i <= 3; i++) {
+        data = uca_ring_buffer_get_read_pointer (buffer);
+        g_assert (data[0] == i);
+    }
+
+    g_assert (uca_ring_buffer_get_write_pointer_ahead (buffer, 2) != NULL);
+    g_assert (uca_ring_buffer_get_num_dropped (buffer) == 0);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_grow (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+    guint32 *borrowed;
+
+    buffer = uca_ring_buffer_new (512, 2);
+
+    for (guint i = 0; i < 2; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    borrowed = uca_ring_buffer_borrow_read_pointer (buffer);
+    g_assert (uca_ring_buffer_is_full (buffer));
+    g_assert (uca_ring_buffer_grow (buffer, 2));
+    g_assert_cmpuint (uca_ring_buffer_get_capacity (buffer), ==, 4);
+    g_assert_cmpuint (uca_ring_buffer_get_fill_level (buffer), ==, 2);
+
+    /* Two more blocks fit without dropping anything */
+    for (guint i = 2; i < 4; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        g_assert (data != borrowed);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    g_assert_cmpuint (uca_ring_buffer_get_num_dropped (buffer), ==, 0);
+    g_assert_cmpuint (borrowed[0], ==, 0);
+    uca_ring_buffer_release_read_pointer (buffer, borrowed);
+
+    /* Blocks can only be released once the buffer is empty */
+    g_assert (!uca_ring_buffer_shrink (buffer));
+
+    for (guint i = 1; i < 4; i++) {
+        data = uca_ring_buffer_get_read_pointer (buffer);
+        g_assert_cmpuint (data[0], ==, i);
+    }
+
+    g_assert (uca_ring_buffer_shrink (buffer));
+    g_assert_cmpuint (uca_ring_buffer_get_capacity (buffer), ==, 2);
+
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    data[0] = 4;
+    uca_ring_buffer_write_advance (buffer);
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert_cmpuint (data[0], ==, 4);
+
+    g_object_unref (buffer);
+}
+
+static void
+test_cursors (void)
+{
+    UcaRingBuffer *buffer;
+    UcaRingBufferCursor *lossless;
+    UcaRingBufferCursor *latest;
+    UcaRingBufferCursor *cursor = NULL;
+    guint32 *data;
+
+    buffer = uca_ring_buffer_new (512, 2);
+    lossless = uca_ring_buffer_add_cursor (buffer, "disk", UCA_RING_BUFFER_CURSOR_LOSSLESS);
+    latest = uca_ring_buffer_add_cursor (buffer, "display", UCA_RING_BUFFER_CURSOR_LATEST);
+
+    g_assert (lossless != NULL && latest != NULL);
+    g_assert (uca_ring_buffer_add_cursor (buffer, "disk", UCA_RING_BUFFER_CURSOR_LATEST) == NULL);
+    g_assert (uca_ring_buffer_get_cursor (buffer, "display") == latest);
+    g_assert_cmpstr (uca_ring_buffer_cursor_get_name (latest), ==, "display");
+
+    for (guint i = 0; i < 2; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    /* Each consumer sees the frames independently */
+    data = uca_ring_buffer_get_read_pointer (buffer);
+    g_assert_cmpuint (data[0], ==, 0);
+
+    data = uca_ring_buffer_cursor_borrow (buffer, latest);
+    g_assert_cmpuint (data[0], ==, 1);
+    g_assert_cmpuint (uca_ring_buffer_cursor_get_num_skipped (latest), ==, 1);
+    uca_ring_buffer_cursor_release (buffer, latest, data);
+    g_assert (!uca_ring_buffer_cursor_available (buffer, latest));
+
+    /* The lossless cursor has not read anything, so nothing may be overwritten */
+    g_assert (!uca_ring_buffer_is_writable (buffer));
+    g_assert (uca_ring_buffer_get_write_pointer (buffer) == NULL);
+
+    data = uca_ring_buffer_cursor_borrow (buffer, lossless);
+    g_assert_cmpuint (data[0], ==, 0);
+    uca_ring_buffer_cursor_release (buffer, lossless, data);
+
+    /* Block 0 is free now, block 1 is still needed by two consumers */
+    data = uca_ring_buffer_get_write_pointer (buffer);
+    g_assert (data != NULL);
+    data[0] = 2;
+    uca_ring_buffer_write_advance (buffer);
+    g_assert (uca_ring_buffer_get_write_pointer (buffer) == NULL);
+
+    for (guint i = 1; i < 3; i++) {
+        data = uca_ring_buffer_cursor_borrow (buffer, lossless);
+        g_assert_cmpuint (data[0], ==, i);
+        uca_ring_buffer_cursor_release (buffer, lossless, data);
+    }
+
+    g_assert_cmpuint (uca_ring_buffer_cursor_get_num_skipped (lossless), ==, 0);
+
+    /* Only the default consumer's unread block is left and may be dropped */
+    g_assert (uca_ring_buffer_get_write_pointer (buffer) != NULL);
+    uca_ring_buffer_write_advance (buffer);
+    g_assert_cmpuint (uca_ring_buffer_get_num_dropped (buffer), ==, 1);
+
+    uca_ring_buffer_remove_cursor (buffer, lossless);
+    g_assert (uca_ring_buffer_get_cursor (buffer, "disk") == NULL);
+
+    /* Cursors beyond the maximum are rejected instead of blocking the producer */
+    for (guint i = 1; i < UCA_RING_BUFFER_MAX_CURSORS; i++) {
+        gchar *name = g_strdup_printf ("cursor-%u", i);
+
+        cursor = uca_ring_buffer_add_cursor (buffer, name, UCA_RING_BUFFER_CURSOR_DROP_OLDEST);
+        g_assert (cursor != NULL);
+        g_free (name);
+    }
+
+    g_assert (uca_ring_buffer_add_cursor (buffer, "overflow", UCA_RING_BUFFER_CURSOR_LATEST) == NULL);
+
+    for (guint i = 0; i < 3; i++) {
+        g_assert (uca_ring_buffer_get_write_pointer (buffer) != NULL);
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    /* Blocks are dropped for the default consumer and all cursors at once */
+    g_assert_cmpuint (uca_ring_buffer_cursor_get_num_skipped (cursor), ==, 1);
+    g_object_unref (buffer);
+}
+
+static void
+test_allocation (void)
+{
+    UcaRingBuffer *buffer;
+    guint32 *data;
+
+    buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                           "block-size", (guint64) 4096,
+                           "num-blocks", 3,
+                           "alignment", 4096,
+                           "huge-pages", TRUE,
+                           "prefault", TRUE,
+                           NULL);
+
+    for (guint i = 0; i < 3; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        g_assert_cmpuint (GPOINTER_TO_SIZE (data) % 4096, ==, 0);
+        data[1023] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    for (guint i = 0; i < 3; i++) {
+        data = uca_ring_buffer_get_read_pointer (buffer);
+        g_assert_cmpuint (data[1023], ==, i);
+    }
+
+    g_object_unref (buffer);
+}
+
+#ifdef G_OS_UNIX
+static void
+test_file (void)
+{
+    UcaRingBuffer *buffer;
+    gchar *filename;
+    gchar *contents;
+    gsize length;
+    guint64 header[5];
+    guint32 *data;
+    gint fd;
+
+    fd = g_file_open_tmp ("uca-ring-XXXXXX", &filename, NULL);
+    g_assert (fd >= 0);
+    g_close (fd, NULL);
+
+    buffer = g_object_new (UCA_TYPE_RING_BUFFER,
+                           "block-size", (guint64) 4096,
+                           "num-blocks", 2,
+                           "file-name", filename,
+                           NULL);
+
+    /* Write three frames, the first one is overwritten */
+    for (guint i = 0; i < 3; i++) {
+        data = uca_ring_buffer_get_write_pointer (buffer);
+        data[0] = i;
+        uca_ring_buffer_write_advance (buffer);
+    }
+
+    g_object_unref (buffer);
+
+    /* The data must be readable after the buffer is gone */
+    g_assert (g_file_get_contents (filename, &contents, &length, NULL));
+    g_assert (length >= sizeof (header));
+    memcpy (header, contents, sizeof (header));
+
+    g_assert (memcmp (contents, "UCARING1", 8) == 0);
+    g_assert_cmpuint (header[1], ==, 4096);
+    g_assert_cmpuint (header[2], ==, 2);
+    g_assert_cmpuint (header[3], ==, 3);
+    g_assert_cmpuint (length, ==, header[4] + 2 * 4096);
+
+    data = (guint32 *) (contents + header[4]);
+    g_assert_cmpuint (data[0], ==, 2);
+    g_assert_cmpuint (data[1024], ==, 1);
+
+    g_free (contents);
+    g_unlink (filename);
+    g_free (filename);
+}
+#endif
+
+typedef struct {
+    UcaRingBuffer *buffer;
+    guint n_frames;
+    guint n_words;
+} StressData;
+
+static gpointer
+produce_frames (StressData *data)
+{
+    for (guint i = 0; i < data->n_frames; i++) {
+        guint32 *frame;
+
+        while ((frame = uca_ring_buffer_get_write_pointer (data->buffer)) == NULL)
+            g_thread_yield ();
+
+        for (guint j = 0; j < data->n_words; j++)
+            frame[j] = i;
+
+        uca_ring_buffer_write_advance (data->buffer);
+    }
+
+    return NULL;
+}
+
+static guint
+consume_frames (StressData *data)
+{
+    guint n_read = 0;
+    gint64 last = -1;
+
+    /* The newest frame is never dropped, so we always see the last one */
+    while (last < (gint64) data->n_frames - 1) {
+        guint32 *frame;
+
+        frame = uca_ring_buffer_borrow_read_pointer (data->buffer);
+
+        if (frame == NULL) {
+            g_thread_yield ();
+            continue;
+        }
+
+        g_assert_cmpint ((gint64) frame[0], >, last);
+
+        for (guint j = 1; j < data->n_words; j++)
+            g_assert_cmpuint (frame[j], ==, frame[0]);
+
+        last = frame[0];
+        n_read++;
+        uca_ring_buffer_release_read_pointer (data->buffer, frame);
+    }
+
+    return n_read;
+}
+
+static void
+test_stress (void)
+{
+    StressData data;
+    GThread *producer;
+    guint n_read;
+
+    data.n_words = 256;
+    data.n_frames = 200000;
+    data.buffer = uca_ring_buffer_new (data.n_words * sizeof (guint32), 4);
+
+    producer = g_thread_new (NULL, (GThreadFunc) produce_frames, &data);
+    n_read = consume_frames (&data);
+    g_thread_join (producer);
+
+    g_assert_cmpuint (n_read, >, 0);
+    g_assert_cmpuint (n_read, <=, data.n_frames);
+    g_assert (!uca_ring_buffer_available (data.buffer));
+
+    g_object_unref (data.buffer);
+}
+
+static void
+test_throughput (void)
+{
+    StressData data;
+    GThread *producer;
+    GTimer *timer;
+    gdouble elapsed;
+    guint n_read;
+
+    if (!g_test_perf ())
+        return;
+
+    data.n_words = 16;
+    data.n_frames = 10000000;
+    data.buffer = uca_ring_buffer_new (data.n_words * sizeof (guint32), 64);
+
+    timer = g_timer_new ();
+    producer = g_thread_new (NULL, (GThreadFunc) produce_frames, &data);
+    n_read = consume_frames (&data);
+    g_thread_join (producer);
+    elapsed = g_timer_elapsed (timer, NULL);
+
+    g_test_maximized_result (data.n_frames / elapsed, "%.0f frames/s written", data.n_frames / elapsed);
+    g_test_message ("%u of %u frames read in %.3f s", n_read, data.n_frames, elapsed);
+
+    g_timer_destroy (timer);
+    g_object_unref (data.buffer);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -99,6 +493,16 @@ main (int argc, char *argv[])
     g_test_add_func ("/ringbuffer/new/func", test_new_func);
     g_test_add_func ("/ringbuffer/functionality ", test_ring);
     g_test_add_func ("/ringbuffer/overwrite ", test_overwrite);
+    g_test_add_func ("/ringbuffer/borrow", test_borrow);
+    g_test_add_func ("/ringbuffer/write-ahead", test_write_ahead);
+    g_test_add_func ("/ringbuffer/grow", test_grow);
+    g_test_add_func ("/ringbuffer/cursors", test_cursors);
+    g_test_add_func ("/ringbuffer/allocation", test_allocation);
+#ifdef G_OS_UNIX
+    g_test_add_func ("/ringbuffer/file", test_file);
+#endif
+    g_test_add_func ("/ringbuffer/stress", test_stress);
+    g_test_add_func ("/ringbuffer/throughput", test_throughput);
 
     return g_test_run ();
 }
@@ -0,0 +1,370 @@
+#include <glib.h>
+#include <string.h>
+#include "uca-transform.h"
+
+
+/*
+ * Reference implementation that moves every pixel to its mirrored and then
+ * rotated position one at a time.
+ */
+static void
+transform_reference (const guint8 *src, guint8 *dst, guint width, guint height,
+                     guint pixel_size, gboolean mirror, guint rotate)
+{
+    guint dst_width = rotate % 2 ? height : width;
+
+    for (guint y = 0; y < height; y++) {
+        for (guint x = 0; x < width; x++) {
+            guint w = width;
+            guint h = height;
+            guint dx = mirror ? width - 1 - x : x;
+            guint dy = y;
+
+            for (guint i = 0; i < rotate; i++) {
+                guint tmp = dx;
+
+                dx = h - 1 - dy;
+                dy = tmp;
+                tmp = w;
+                w = h;
+                h = tmp;
+            }
+
+            memcpy (dst + ((gsize) dy * dst_width + dx) * pixel_size,
+                    src + ((gsize) y * width + x) * pixel_size,
+                    pixel_size);
+        }
+    }
+}
+
+static void
+test_rotate_small (void)
+{
+    /* 3x2 frame, rotated clockwise it becomes 2x3 */
+    const guint8 src[] = { 1, 2, 3,
+                           4, 5, 6 };
+    const guint8 rotated[] = { 4, 1,
+                               5, 2,
+                               6, 3 };
+    const guint8 mirrored[] = { 3, 2, 1,
+                                6, 5, 4 };
+    guint8 dst[6];
+
+    uca_transform_frame (src, dst, 3, 2, 1, FALSE, 1);
+    g_assert (memcmp (dst, rotated, sizeof (dst)) == 0);
+
+    uca_transform_frame (src, dst, 3, 2, 1, TRUE, 0);
+    g_assert (memcmp (dst, mirrored, sizeof (dst)) == 0);
+}
+
+static void
+test_all_transforms (void)
+{
+    /* Sizes around the SIMD block and cache tile edges */
+    static const guint sizes[][2] = {
+        { 1, 1 }, { 7, 3 }, { 8, 8 }, { 16, 16 }, { 37, 21 }, { 70, 50 }, { 130, 67 }, { 200, 3 },
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+            gsize size = (gsize) sizes[i][0] * sizes[i][1] * pixel_size;
+            guint8 *src = g_malloc (size);
+            guint8 *expected = g_malloc (size);
+            guint8 *result = g_malloc (size);
+
+            for (gsize j = 0; j < size; j++)
+                src[j] = (guint8) g_test_rand_int ();
+
+            for (guint mirror = 0; mirror < 2; mirror++) {
+                for (guint rotate = 0; rotate < 4; rotate++) {
+                    transform_reference (src, expected, sizes[i][0], sizes[i][1], pixel_size, mirror, rotate);
+                    uca_transform_frame (src, result, sizes[i][0], sizes[i][1], pixel_size, mirror, rotate);
+                    g_assert (memcmp (expected, result, size) == 0);
+                }
+            }
+
+            g_free (src);
+            g_free (expected);
+            g_free (result);
+        }
+    }
+}
+
+static void
+test_unpack_known (void)
+{
+    /* 0x123, 0x456 and 0x0AB, 0x3CD, 0x001, 0x2EF as Mono12p and Mono10p */
+    const guint8 packed12[] = { 0x23, 0x61, 0x45 };
+    const guint8 packed10[] = { 0xAB, 0x34, 0x1F, 0xC0, 0xBB };
+    const guint16 pixels10[] = { 0x0AB, 0x3CD, 0x001, 0x2EF };
+    guint16 dst[4];
+    guint8 bytes[5];
+
+    uca_transform_unpack (packed12, dst, 2, 12);
+    g_assert_cmpuint (dst[0], ==, 0x123);
+    g_assert_cmpuint (dst[1], ==, 0x456);
+
+    uca_transform_pack (dst, bytes, 2, 12);
+    g_assert (memcmp (bytes, packed12, sizeof (packed12)) == 0);
+
+    uca_transform_unpack (packed10, dst, 4, 10);
+    g_assert (memcmp (dst, pixels10, sizeof (pixels10)) == 0);
+
+    uca_transform_pack (pixels10, bytes, 4, 10);
+    g_assert (memcmp (bytes, packed10, sizeof (packed10)) == 0);
+}
+
+static void
+test_pack_round_trip (void)
+{
+    /* Lengths around the SIMD block size and with partial trailing bytes */
+    static const gsize lengths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 33, 1000, 1283 };
+    static const guint bits[] = { 8, 10, 12, 16 };
+
+    for (guint i = 0; i < G_N_ELEMENTS (lengths); i++) {
+        for (guint j = 0; j < G_N_ELEMENTS (bits); j++) {
+            gsize n_pixels = lengths[i];
+            gsize size = uca_transform_get_packed_size (n_pixels, bits[j]);
+            guint16 *src = g_malloc (n_pixels * 2);
+            guint16 *result = g_malloc (n_pixels * 2);
+            guint8 *packed = g_malloc (size);
+
+            for (gsize k = 0; k < n_pixels; k++)
+                src[k] = (guint16) (g_test_rand_int () & ((1 << bits[j]) - 1));
+
+            uca_transform_pack (src, packed, n_pixels, bits[j]);
+            uca_transform_unpack (packed, result, n_pixels, bits[j]);
+            g_assert (memcmp (src, result, n_pixels * 2) == 0);
+
+            g_free (src);
+            g_free (result);
+            g_free (packed);
+        }
+    }
+}
+
+static void
+test_bin (void)
+{
+    static const guint factors[][2] = {
+        { 1, 1 }, { 2, 2 }, { 4, 4 }, { 2, 1 }, { 1, 3 }, { 3, 2 }, { 4, 2 }, { 5, 7 },
+    };
+    const guint src_width = 77;
+    const guint src_height = 45;
+
+    for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+        gsize stride = src_width * pixel_size;
+        guint8 *src = g_malloc (stride * src_height);
+
+        for (gsize i = 0; i < stride * src_height; i++)
+            src[i] = (guint8) g_test_rand_int ();
+
+        for (guint i = 0; i < G_N_ELEMENTS (factors); i++) {
+            for (guint widen = 0; widen < 2; widen++) {
+                /* Crop one pixel at the top left to test the stride */
+                guint horizontal = factors[i][0];
+                guint vertical = factors[i][1];
+                guint width = (src_width - 1) / horizontal;
+                guint height = (src_height - 1) / vertical;
+                guint dst_pixel_size = widen ? 2 : pixel_size;
+                guint max = dst_pixel_size == 1 ? 0xFF : 0xFFFF;
+                guint8 *dst = g_malloc ((gsize) width * height * dst_pixel_size);
+
+                uca_transform_bin (src + stride + pixel_size, stride, dst, width, height,
+                                   horizontal, vertical, pixel_size, widen);
+
+                for (guint y = 0; y < height; y++) {
+                    for (guint x = 0; x < width; x++) {
+                        guint sum = 0;
+                        guint value;
+
+                        for (guint v = 0; v < vertical; v++) {
+                            for (guint h = 0; h < horizontal; h++) {
+                                gsize offset = (1 + y * vertical + v) * stride + (1 + x * horizontal + h) * pixel_size;
+
+                                sum += pixel_size == 1 ? src[offset] : *(guint16 *) (src + offset);
+                            }
+                        }
+
+                        value = dst_pixel_size == 1 ? dst[y * width + x] : ((guint16 *) dst)[y * width + x];
+                        g_assert_cmpuint (value, ==, MIN (sum, max));
+                    }
+                }
+
+                g_free (dst);
+            }
+        }
+
+        g_free (src);
+    }
+}
+
+static void
+test_correct (void)
+{
+    static const guint shifts[] = { 0, 1, 8, 15, 16 };
+    const gsize n_pixels = 1027;
+    guint16 *dark = g_malloc (n_pixels * 2);
+    guint16 *gain = g_malloc (n_pixels * 2);
+
+    for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+        guint8 *src = g_malloc (n_pixels * pixel_size);
+        guint8 *dst = g_malloc (n_pixels * pixel_size);
+        guint max = pixel_size == 1 ? 0xFF : 0xFFFF;
+
+        for (gsize i = 0; i < n_pixels * pixel_size; i++)
+            src[i] = (guint8) g_test_rand_int ();
+
+        for (gsize i = 0; i < n_pixels; i++) {
+            dark[i] = (guint16) (g_test_rand_int () & max);
+            gain[i] = (guint16) g_test_rand_int ();
+        }
+
+        /* Extreme gains and darks at the start, in the SIMD part */
+        gain[0] = 0xFFFF;
+        dark[0] = 0;
+        gain[1] = 0;
+        dark[2] = (guint16) max;
+
+        for (guint i = 0; i < G_N_ELEMENTS (shifts); i++) {
+            guint shift = shifts[i];
+
+            uca_transform_correct (src, dst, dark, gain, n_pixels, shift, pixel_size);
+
+            for (gsize k = 0; k < n_pixels; k++) {
+                guint64 raw = pixel_size == 1 ? src[k] : ((guint16 *) src)[k];
+                guint64 expected = raw > dark[k] ? (raw - dark[k]) * gain[k] : 0;
+                guint value = pixel_size == 1 ? dst[k] : ((guint16 *) dst)[k];
+
+                if (shift > 0)
+                    expected = (expected + (1 << (shift - 1))) >> shift;
+
+                g_assert_cmpuint (value, ==, MIN (expected, max));
+            }
+        }
+
+        /* In place */
+        memcpy (dst, src, n_pixels * pixel_size);
+        uca_transform_correct (dst, dst, dark, gain, n_pixels, 12, pixel_size);
+        uca_transform_correct (src, src, dark, gain, n_pixels, 12, pixel_size);
+        g_assert (memcmp (src, dst, n_pixels * pixel_size) == 0);
+
+        g_free (src);
+        g_free (dst);
+    }
+
+    g_free (dark);
+    g_free (gain);
+}
+
+static void
+test_accumulate (void)
+{
+    const gsize n_pixels = 1037;
+    guint32 *sums = g_malloc (n_pixels * sizeof (guint32));
+    guint32 *expected = g_malloc (n_pixels * sizeof (guint32));
+
+    for (guint pixel_size = 1; pixel_size <= 2; pixel_size++) {
+        guint8 *src = g_malloc (n_pixels * pixel_size);
+
+        for (gsize i = 0; i < n_pixels; i++)
+            sums[i] = expected[i] = G_MAXUINT32 - 0x10000 * 3 + (guint32) g_test_rand_int () % 1000;
+
+        for (guint frame = 0; frame < 3; frame++) {
+            for (gsize i = 0; i < n_pixels * pixel_size; i++)
+                src[i] = (guint8) g_test_rand_int ();
+
+            /* The last sum must stay untouched */
+            uca_transform_accumulate (src, sums, n_pixels - 1, pixel_size);
+
+            for (gsize i = 0; i < n_pixels - 1; i++)
+                expected[i] += pixel_size == 1 ? src[i] : ((guint16 *) src)[i];
+        }
+
+        g_assert (memcmp (sums, expected, n_pixels * sizeof (guint32)) == 0);
+        g_free (src);
+    }
+
+    g_free (sums);
+    g_free (expected);
+}
+
+static void
+test_statistics (void)
+{
+    const guint width = 61;
+    const guint height = 37;
+    const guint bits[] = { 8, 12, 16 };
+    UcaFrameStatistics statistics;
+
+    for (guint b = 0; b < G_N_ELEMENTS (bits); b++) {
+        guint pixel_size = bits[b] > 8 ? 2 : 1;
+        guint max = (1 << bits[b]) - 1;
+        guint8 *src = g_malloc ((gsize) width * height * pixel_size);
+
+        /* Exceed the bit depth now and then to hit saturation and the last bin */
+        for (gsize i = 0; i < (gsize) width * height; i++) {
+            guint value = (guint) g_test_rand_int () % (max + 1);
+
+            if (pixel_size == 2 && i % 97 == 0)
+                value = bits[b] < 16 ? max + 1 + i % 7 : max;
+
+            if (pixel_size == 1)
+                src[i] = (guint8) value;
+            else
+                ((guint16 *) src)[i] = (guint16) value;
+        }
+
+        for (guint step = 1; step <= 3; step++) {
+            guint32 histogram[UCA_FRAME_STATISTICS_N_BINS] = { 0, };
+            guint shift = bits[b] > 8 ? bits[b] - 8 : 0;
+            guint64 sum = 0, sum_squares = 0, n_saturated = 0, n_pixels = 0;
+            guint min = G_MAXUINT, vmax = 0;
+
+            for (guint y = 0; y < height; y += step) {
+                for (guint x = 0; x < width; x += step) {
+                    gsize i = (gsize) y * width + x;
+                    guint value = pixel_size == 1 ? src[i] : ((guint16 *) src)[i];
+
+                    min = MIN (min, value);
+                    vmax = MAX (vmax, value);
+                    sum += value;
+                    sum_squares += (guint64) value * value;
+                    n_saturated += value >= max;
+                    histogram[MIN (value >> shift, UCA_FRAME_STATISTICS_N_BINS - 1)]++;
+                    n_pixels++;
+                }
+            }
+
+            uca_transform_statistics (src, width, height, pixel_size, bits[b], step, &statistics);
+
+            g_assert_cmpuint (statistics.n_pixels, ==, n_pixels);
+            g_assert_cmpuint (statistics.min, ==, min);
+            g_assert_cmpuint (statistics.max, ==, vmax);
+            g_assert_cmpuint (statistics.sum, ==, sum);
+            g_assert_cmpuint (statistics.sum_squares, ==, sum_squares);
+            g_assert_cmpuint (statistics.n_saturated, ==, n_saturated);
+            g_assert_cmpuint (statistics.histogram_shift, ==, shift);
+            g_assert (memcmp (statistics.histogram, histogram, sizeof (histogram)) == 0);
+        }
+
+        g_free (src);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/transform/small", test_rotate_small);
+    g_test_add_func ("/transform/all", test_all_transforms);
+    g_test_add_func ("/transform/unpack", test_unpack_known);
+    g_test_add_func ("/transform/pack", test_pack_round_trip);
+    g_test_add_func ("/transform/bin", test_bin);
+    g_test_add_func ("/transform/correct", test_correct);
+    g_test_add_func ("/transform/accumulate", test_accumulate);
+    g_test_add_func ("/transform/statistics", test_statistics);
+
+    return g_test_run ();
+}